@@ -16,6 +16,8 @@
 #include "wlan_util.h"
 #include "conf.h"
 #include "log.h"
+#include "probes.h"
+#include "counters.h"
 
 uint32_t uwifi_channel_get_remaining_dwell_time(struct uwifi_interface* intf)
 {
@@ -239,11 +241,19 @@ bool uwifi_channel_change(struct uwifi_interface* intf, struct uwifi_chan_spec*
 
 	uint32_t the_time = plat_time_usec();
 
+	UWIFI_PROBE2(chan_switch_start, spec->freq, spec->width);
+	UWIFI_TIME_START(start);
+
 	if (!ifctrl_iwset_freq(intf->ifname, spec->freq, spec->width, spec->center_freq)) {
+		UWIFI_COUNT(UWIFI_CNT_CHAN_SWITCH_FAIL);
+		UWIFI_PROBE4(chan_switch_end, intf->channel_idx, spec->freq,
+			     plat_time_usec() - the_time, 0);
 		LOG_ERR("Failed to set %s after %dms", uwifi_channel_get_string(spec),
 			(the_time - intf->last_channelchange) / 1000);
 		return false;
 	}
+	UWIFI_HIST_SINCE(UWIFI_HIST_CHAN_SWITCH, start);
+	UWIFI_COUNT(UWIFI_CNT_CHAN_SWITCHES);
 
 	LOG_DBG("Set %s after %dms", uwifi_channel_get_string(spec),
 		(the_time - intf->last_channelchange) / 1000);
@@ -252,6 +262,8 @@ bool uwifi_channel_change(struct uwifi_interface* intf, struct uwifi_chan_spec*
 	intf->channel = *spec;
 	intf->max_phy_rate = wlan_max_phy_rate(spec->width, channel_get_band_from_idx(&intf->channels, intf->channel_idx).streams_rx);
 	intf->last_channelchange = the_time;
+	UWIFI_PROBE4(chan_switch_end, intf->channel_idx, spec->freq,
+		     plat_time_usec() - the_time, 1);
 	return true;
 }
 
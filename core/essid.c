@@ -16,6 +16,42 @@
 #include "util.h"
 #include "essid.h"
 #include "log.h"
+#include "probes.h"
+#include "counters.h"
+
+#if UWIFI_STATIC_TABLES
+/* fixed pool with a stack of free indices */
+static struct essid_info essid_pool[UWIFI_MAX_ESSIDS];
+static uint8_t essid_free_idx[UWIFI_MAX_ESSIDS];
+static int essid_num_free = -1;
+
+static struct essid_info* essid_alloc(void)
+{
+	if (essid_num_free < 0) {
+		for (int i = 0; i < UWIFI_MAX_ESSIDS; i++)
+			essid_free_idx[i] = UWIFI_MAX_ESSIDS - 1 - i;
+		essid_num_free = UWIFI_MAX_ESSIDS;
+	}
+	if (essid_num_free == 0)
+		return NULL;
+	return &essid_pool[essid_free_idx[--essid_num_free]];
+}
+
+static void essid_free(struct essid_info* e)
+{
+	essid_free_idx[essid_num_free++] = e - essid_pool;
+}
+#else
+static struct essid_info* essid_alloc(void)
+{
+	return malloc(sizeof(struct essid_info));
+}
+
+static void essid_free(struct essid_info* e)
+{
+	free(e);
+}
+#endif
 
 static void update_essid_split_status(struct essid_info* e)
 {
@@ -64,33 +100,26 @@ void uwifi_essids_remove_node(struct uwifi_node* n)
 	if (e->num_nodes == 0) {
 		LOG_DBG("ESSID empty, delete");
 		cc_list_del(&e->list);
-		free(e);
+		uwifi_ssid_unref(e->ssids, e->id);
+		essid_free(e);
+		UWIFI_COUNT(UWIFI_CNT_ESSIDS_DELETED);
 	} else {
 		LOG_DBG("ESSID remove mark 1");
 		update_essid_split_status(e);
 	}
 }
 
-void uwifi_essids_update(struct cc_list_head* essids, struct uwifi_packet* p,
-			 struct uwifi_node* n)
+static void essid_add_node(struct cc_list_head* essids, struct uwifi_ssid_table* ssids,
+			   struct uwifi_node* n, uint16_t id)
 {
 	struct essid_info* e;
 
-	if (n == NULL || p == NULL || p->phy_flags & PHY_FLAG_BADFCS ||
-	    p->wlan_essid[0] == '\0')
-		return; /* ignore */
-
-	/* only check beacons and probe response frames */
-	if (p->wlan_type != WLAN_FRAME_BEACON &&
-	    p->wlan_type != WLAN_FRAME_PROBE_RESP)
-		return;
-
-	LOG_DBG("ESSID check '%s' node " MAC_FMT " bssid " MAC_FMT,
-		p->wlan_essid, MAC_PAR(n->wlan_src), MAC_PAR(p->wlan_bssid));
+	LOG_DBG("ESSID check %d node " MAC_FMT " bssid " MAC_FMT,
+		id, MAC_PAR(n->wlan_src), MAC_PAR(n->wlan_bssid));
 
 	/* find essid if already recorded */
 	cc_list_for_each(essids, e, list) {
-		if (strncmp(e->essid, p->wlan_essid, WLAN_MAX_SSID_LEN) == 0) {
+		if (e->ssids == ssids && e->id == id) {
 			LOG_DBG("ESSID found");
 			break;
 		}
@@ -99,38 +128,102 @@ void uwifi_essids_update(struct cc_list_head* essids, struct uwifi_packet* p,
 	/* if not add new essid */
 	if (&e->list == &essids->n) {
 		LOG_DBG("ESSID not found, adding new");
-		e = malloc(sizeof(struct essid_info));
+		e = essid_alloc();
+		if (e == NULL) {
+			/* with static tables, new ESSIDs are ignored when full */
+			LOG_DBG("ESSID table full");
+			return;
+		}
 		memset(e, 0, sizeof(struct essid_info));
-		strncpy(e->essid, p->wlan_essid, WLAN_MAX_SSID_LEN);
-		e->essid[WLAN_MAX_SSID_LEN-1] = '\0';
-		      cc_list_head_init(&e->nodes);
+		e->ssids = ssids;
+		e->id = id;
+		uwifi_ssid_ref(ssids, id);
+		cc_list_head_init(&e->nodes);
 		cc_list_add_tail(essids, &e->list);
+		UWIFI_COUNT(UWIFI_CNT_ESSIDS_CREATED);
 	}
 
 	/* if node had another essid before, remove it there */
 	if (n->essid != NULL && n->essid != e) {
-		LOG_DBG("ESSID remove old '%s'", n->essid->essid);
+		LOG_DBG("ESSID remove old '%s'", uwifi_essid_name(n->essid));
 		uwifi_essids_remove_node(n);
 	}
 
 	/* new node */
 	if (n->essid == NULL) {
 		LOG_DBG("ESSID adding " MAC_FMT " to '%s'",
-			MAC_PAR(n->wlan_src), e->essid);
+			MAC_PAR(n->wlan_src), uwifi_essid_name(e));
 		cc_list_add_tail(&e->nodes, &n->essid_nodes);
 		e->num_nodes++;
 		n->essid = e;
+		UWIFI_PROBE3(essid_change, n->wlan_src, uwifi_essid_name(e), e->num_nodes);
 	}
 
 	update_essid_split_status(e);
 }
 
+void uwifi_essids_update(struct cc_list_head* essids, struct uwifi_ssid_table* ssids,
+			 struct uwifi_packet* p, struct uwifi_node* n)
+{
+	uint16_t id;
+
+	if (n == NULL || p == NULL || p->phy_flags & PHY_FLAG_BADFCS)
+		return; /* ignore */
+
+	/* held while it is used here */
+	id = uwifi_ssid_hold(ssids, p->wlan_essid_id, p->wlan_essid, p->wlan_essid_len);
+
+	switch (p->wlan_type) {
+	case WLAN_FRAME_PROBE_RESP:
+		uwifi_ssid_bssid_put(ssids, p->wlan_bssid, id);
+		break;
+
+	case WLAN_FRAME_BEACON:
+		if (id == 0) {
+			id = uwifi_ssid_bssid_hold(ssids, p->wlan_bssid);
+			if (id != 0)
+				LOG_DBG("ESSID hidden resolved %d", id);
+		}
+		break;
+
+	case WLAN_FRAME_PROBE_REQ:
+		/* directed probes show the preferred networks of the client */
+		if (id != 0) {
+			uwifi_ssid_count_probe(ssids, id);
+#if UWIFI_NODE_PROBED
+			uwifi_ssid_set_add(&n->probed, ssids, id);
+#endif
+		}
+		goto out;
+
+	case WLAN_FRAME_ASSOC_REQ:
+	case WLAN_FRAME_REASSOC_REQ:
+		/* sent by the STA, the AP is added now if it is known, otherwise
+		 * with its next beacon */
+		uwifi_ssid_bssid_put(ssids, p->wlan_bssid, id);
+		if (id != 0 && n->ap_node != NULL &&
+		    n->ap_node->essid == NULL &&
+		    memcmp(n->ap_node->wlan_src, p->wlan_bssid, WLAN_MAC_LEN) == 0)
+			essid_add_node(essids, ssids, n->ap_node, id);
+		goto out;
+
+	default:
+		goto out;
+	}
+
+	if (id != 0)
+		essid_add_node(essids, ssids, n, id);
+out:
+	uwifi_ssid_unref(ssids, id);
+}
+
 void uwifi_essids_free(struct cc_list_head* essids) {
 	struct essid_info *e, *f;
 
 	cc_list_for_each_safe(essids, e, f, list) {
-		LOG_DBG("ESSID free '%s'", e->essid);
+		LOG_DBG("ESSID free '%s'", uwifi_essid_name(e));
 		cc_list_del_from(essids, &e->list);
-		free(e);
+		uwifi_ssid_unref(e->ssids, e->id);
+		essid_free(e);
 	}
 }
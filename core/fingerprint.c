@@ -0,0 +1,125 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <string.h>
+
+#include "platform.h"
+#include "fingerprint.h"
+#include "wlan_parser.h"
+#include "log.h"
+
+#define FP_MASK		(UWIFI_FP_TABLE_SIZE - 1)
+
+void uwifi_fingerprint_init(struct uwifi_fp_table* t, unsigned int timeout_sec)
+{
+	memset(t, 0, sizeof(struct uwifi_fp_table));
+	t->timeout = timeout_sec * 1000000;
+}
+
+static inline uint32_t fp_mac_hash(const unsigned char* mac)
+{
+	uint32_t h = mac[2] << 24 | mac[3] << 16 | mac[4] << 8 | mac[5];
+
+	return ((h ^ mac[1]) * 2654435761u >> 16) & FP_MASK;
+}
+
+static void fp_set_last_mac(struct uwifi_fp_table* t, struct uwifi_fp_entry* e,
+			    const unsigned char* mac)
+{
+	memcpy(e->last_mac, mac, WLAN_MAC_LEN);
+	t->by_mac[fp_mac_hash(mac)] = e - t->entries + 1;
+}
+
+static inline bool fp_expired(const struct uwifi_fp_table* t,
+			      const struct uwifi_fp_entry* e, uint32_t now)
+{
+	return now - e->last_seen > t->timeout;
+}
+
+const struct uwifi_fp_entry* uwifi_fingerprint_find(const struct uwifi_fp_table* t,
+						     uint32_t fingerprint)
+{
+	uint32_t now = plat_time_usec();
+
+	for (int i = 0; i < UWIFI_FP_MAX_PROBE; i++) {
+		const struct uwifi_fp_entry* e = &t->entries[(fingerprint + i) & FP_MASK];
+		if (e->fingerprint == fingerprint && !fp_expired(t, e, now))
+			return e;
+	}
+	return NULL;
+}
+
+bool uwifi_fingerprint_group(struct uwifi_fp_table* t, struct uwifi_packet* p)
+{
+	struct uwifi_fp_entry *e, *victim = NULL;
+	uint32_t fp = p->wlan_fingerprint;
+	uint32_t now;
+
+	if (p->wlan_type != WLAN_FRAME_PROBE_REQ || fp == 0 ||
+	    !WLAN_MAC_IS_LOCAL(p->wlan_ta) || (p->phy_flags & PHY_FLAG_BADFCS))
+		return false;
+
+	now = plat_time_usec();
+	for (int i = 0; i < UWIFI_FP_MAX_PROBE; i++) {
+		e = &t->entries[(fp + i) & FP_MASK];
+		if (e->fingerprint == fp && !fp_expired(t, e, now))
+			goto found;
+		/* prefer free, then least recently seen */
+		if (victim == NULL || (victim->fingerprint != 0 &&
+		    (e->fingerprint == 0 ||
+		     now - e->last_seen > now - victim->last_seen)))
+			victim = e;
+	}
+
+	LOG_DBG("FP new %08x " MAC_FMT, fp, MAC_PAR(p->wlan_ta));
+	victim->fingerprint = fp;
+	victim->last_seen = now;
+	victim->num_macs = 1;
+	memcpy(victim->mac, p->wlan_ta, WLAN_MAC_LEN);
+	fp_set_last_mac(t, victim, p->wlan_ta);
+	return false;
+
+found:
+	e->last_seen = now;
+	if (memcmp(e->last_mac, p->wlan_ta, WLAN_MAC_LEN) != 0) {
+		fp_set_last_mac(t, e, p->wlan_ta);
+		if (e->num_macs < UINT16_MAX)
+			e->num_macs++;
+	}
+	if (memcmp(e->mac, p->wlan_ta, WLAN_MAC_LEN) == 0)
+		return false;
+
+	memcpy(p->wlan_ta, e->mac, WLAN_MAC_LEN);
+	return true;
+}
+
+bool uwifi_fingerprint_group_receiver(const struct uwifi_fp_table* t,
+				      struct uwifi_packet* p)
+{
+	const struct uwifi_fp_entry* e;
+	uint16_t idx;
+
+	if (!WLAN_MAC_IS_LOCAL(p->wlan_ra) || MAC_BCAST(p->wlan_ra) ||
+	    (p->phy_flags & PHY_FLAG_BADFCS))
+		return false;
+
+	idx = t->by_mac[fp_mac_hash(p->wlan_ra)];
+	if (idx == 0)
+		return false;
+	e = &t->entries[idx - 1];
+	if (e->fingerprint == 0 || fp_expired(t, e, plat_time_usec()) ||
+	    memcmp(e->last_mac, p->wlan_ra, WLAN_MAC_LEN) != 0 ||
+	    memcmp(e->mac, p->wlan_ra, WLAN_MAC_LEN) == 0)
+		return false;
+
+	LOG_DBG("FP receiver " MAC_FMT " is " MAC_FMT, MAC_PAR(p->wlan_ra),
+		MAC_PAR(e->mac));
+	memcpy(p->wlan_ra, e->mac, WLAN_MAC_LEN);
+	return true;
+}
@@ -0,0 +1,218 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <string.h>
+
+#include "framelog.h"
+#include "wlan_parser.h"
+
+enum col {
+	COL_TIME,
+	COL_TA,
+	COL_RA,
+	COL_TYPE,
+	COL_SIGNAL,
+	COL_RATE,
+	COL_LEN,
+	COL_FREQ,
+	COL_FLAGS,
+	COL_MAX
+};
+
+/* start of each column in a record, the last entry is the record length */
+static const uint8_t col_off[COL_MAX + 1] = { 0, 8, 14, 20, 22, 23, 25, 27, 29, 30 };
+
+static const uint8_t magic[4] = { 'U', 'W', 'F', 'L' };
+
+/* element @i of column @c in a block with space for @n records */
+static inline uint8_t* col_ptr(const uint8_t* raw, unsigned int n, enum col c,
+			       unsigned int i)
+{
+	return (uint8_t*)raw + n * col_off[c] + i * (col_off[c + 1] - col_off[c]);
+}
+
+static inline void put_le16(uint8_t* p, uint16_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static inline void put_le32(uint8_t* p, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+		p[i] = v >> (8 * i);
+}
+
+static inline void put_le64(uint8_t* p, uint64_t v)
+{
+	for (int i = 0; i < 8; i++)
+		p[i] = v >> (8 * i);
+}
+
+static inline uint16_t get_le16(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get_le32(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t get_le64(const uint8_t* p)
+{
+	uint64_t v = 0;
+	for (int i = 7; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+/*** writer ***/
+
+void uwifi_framelog_init(struct uwifi_framelog_writer* w, bool compress,
+			 uwifi_framelog_flush_cb flush, void* ctx)
+{
+	w->compress = compress;
+	w->flush = flush;
+	w->ctx = ctx;
+	w->num = 0;
+	w->last_time = 0;
+}
+
+bool uwifi_framelog_add(struct uwifi_framelog_writer* w, const struct uwifi_packet* p)
+{
+	const unsigned int n = UWIFI_FRAMELOG_BLOCK;
+	unsigned int i = w->num;
+	uint8_t flags = 0;
+
+	if (p->wlan_retry)
+		flags |= UWIFI_FRAMELOG_F_RETRY;
+	if (p->phy_flags & PHY_FLAG_BADFCS)
+		flags |= UWIFI_FRAMELOG_F_BADFCS;
+
+	put_le64(col_ptr(w->raw, n, COL_TIME, i), p->pkt_time - w->last_time);
+	memcpy(col_ptr(w->raw, n, COL_TA, i), p->wlan_ta, WLAN_MAC_LEN);
+	memcpy(col_ptr(w->raw, n, COL_RA, i), p->wlan_ra, WLAN_MAC_LEN);
+	put_le16(col_ptr(w->raw, n, COL_TYPE, i), p->wlan_type);
+	*col_ptr(w->raw, n, COL_SIGNAL, i) = (int8_t)p->phy_signal;
+	put_le16(col_ptr(w->raw, n, COL_RATE, i), p->phy_rate);
+	put_le16(col_ptr(w->raw, n, COL_LEN, i), p->wlan_len);
+	put_le16(col_ptr(w->raw, n, COL_FREQ, i), p->phy_freq);
+	*col_ptr(w->raw, n, COL_FLAGS, i) = flags;
+
+	w->last_time = p->pkt_time;
+	w->num++;
+
+	if (w->num == UWIFI_FRAMELOG_BLOCK)
+		return uwifi_framelog_flush(w);
+	return true;
+}
+
+bool uwifi_framelog_flush(struct uwifi_framelog_writer* w)
+{
+	uint8_t* data = w->out + UWIFI_FRAMELOG_HDR_LEN;
+	size_t raw_len = w->num * UWIFI_FRAMELOG_REC_LEN;
+	size_t len = 0;
+	uint8_t flags = 0;
+	bool ret;
+
+	if (w->num == 0)
+		return true;
+
+	/* move columns together when the block is not full */
+	if (w->num < UWIFI_FRAMELOG_BLOCK) {
+		for (int c = COL_TA; c < COL_MAX; c++)
+			memmove(col_ptr(w->raw, w->num, c, 0),
+				col_ptr(w->raw, UWIFI_FRAMELOG_BLOCK, c, 0),
+				w->num * (col_off[c + 1] - col_off[c]));
+	}
+
+	if (w->compress) {
+		len = uwifi_lz_compress(w->raw, raw_len, data,
+					sizeof(w->out) - UWIFI_FRAMELOG_HDR_LEN,
+					w->lz_table);
+		if (len > 0 && len < raw_len)
+			flags |= UWIFI_FRAMELOG_LZ;
+	}
+	if (!(flags & UWIFI_FRAMELOG_LZ)) {
+		memcpy(data, w->raw, raw_len);
+		len = raw_len;
+	}
+
+	memcpy(w->out, magic, sizeof(magic));
+	w->out[4] = UWIFI_FRAMELOG_VERSION;
+	w->out[5] = flags;
+	put_le16(w->out + 6, w->num);
+	put_le32(w->out + 8, len);
+
+	ret = w->flush(w->out, UWIFI_FRAMELOG_HDR_LEN + len, w->ctx);
+
+	/* blocks are independent, the first time is absolute */
+	w->num = 0;
+	w->last_time = 0;
+	return ret;
+}
+
+/*** reader ***/
+
+int uwifi_framelog_read(const uint8_t* buf, size_t len, struct uwifi_framelog_block* b)
+{
+	if (len < UWIFI_FRAMELOG_HDR_LEN)
+		return 0;
+	if (memcmp(buf, magic, sizeof(magic)) != 0 ||
+	    buf[4] != UWIFI_FRAMELOG_VERSION)
+		return -1;
+
+	uint8_t flags = buf[5];
+	unsigned int num = get_le16(buf + 6);
+	uint32_t data_len = get_le32(buf + 8);
+	size_t raw_len = num * UWIFI_FRAMELOG_REC_LEN;
+
+	if (num == 0 || num > UWIFI_FRAMELOG_BLOCK ||
+	    data_len > UWIFI_LZ_BOUND(UWIFI_FRAMELOG_RAW_LEN))
+		return -1;
+	if (len < UWIFI_FRAMELOG_HDR_LEN + data_len)
+		return 0;
+
+	const uint8_t* data = buf + UWIFI_FRAMELOG_HDR_LEN;
+	if (flags & UWIFI_FRAMELOG_LZ) {
+		if (uwifi_lz_decompress(data, data_len, b->raw, raw_len) != (int)raw_len)
+			return -1;
+	} else {
+		if (data_len != raw_len)
+			return -1;
+		memcpy(b->raw, data, raw_len);
+	}
+	b->num = num;
+
+	/* convert time deltas to absolute times */
+	uint64_t t = 0;
+	for (unsigned int i = 0; i < num; i++) {
+		uint8_t* p = col_ptr(b->raw, num, COL_TIME, i);
+		t += get_le64(p);
+		put_le64(p, t);
+	}
+	return UWIFI_FRAMELOG_HDR_LEN + data_len;
+}
+
+void uwifi_framelog_get(const struct uwifi_framelog_block* b, unsigned int i,
+			struct uwifi_framelog_rec* r)
+{
+	const unsigned int n = b->num;
+
+	r->time = get_le64(col_ptr(b->raw, n, COL_TIME, i));
+	memcpy(r->ta, col_ptr(b->raw, n, COL_TA, i), WLAN_MAC_LEN);
+	memcpy(r->ra, col_ptr(b->raw, n, COL_RA, i), WLAN_MAC_LEN);
+	r->type = get_le16(col_ptr(b->raw, n, COL_TYPE, i));
+	r->signal = (int8_t)*col_ptr(b->raw, n, COL_SIGNAL, i);
+	r->rate = get_le16(col_ptr(b->raw, n, COL_RATE, i));
+	r->len = get_le16(col_ptr(b->raw, n, COL_LEN, i));
+	r->freq = get_le16(col_ptr(b->raw, n, COL_FREQ, i));
+	r->flags = *col_ptr(b->raw, n, COL_FLAGS, i);
+}
@@ -0,0 +1,254 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <string.h>
+
+#include "platform.h"
+#include "interference.h"
+#include "node.h"
+#include "wlan_parser.h"
+#include "log.h"
+
+/* part of the weight seen on a 2.4 GHz channel 0..4 channels away, Q8 */
+static const uint16_t aci_24[5] = { 256, 186, 69, 10, 1 };
+
+/* 10^(i/10) in Q10 */
+static const uint16_t pow10_frac[10] = {
+	1024, 1289, 1623, 2043, 2572, 3238, 4077, 5132, 6461, 8134
+};
+
+/* linear power, 1 is -100 dBm, up to -10 dBm */
+static uint64_t sig_to_power(int dbm)
+{
+	uint64_t p = 1;
+
+	dbm = MAX(MIN(dbm, -10), -100) + 100;
+	for (int i = 0; i < dbm / 10; i++)
+		p *= 10;
+	return (p * pow10_frac[dbm % 10]) >> 10;
+}
+
+static uint32_t pkt_airtime(const struct uwifi_packet* p)
+{
+	unsigned int preamble;
+
+	if (p->pkt_duration)
+		return p->pkt_duration;
+	if (p->phy_rate == 0)
+		return 0;
+
+	/* DSSS/CCK long preamble or OFDM */
+	if (p->phy_rate == 10 || p->phy_rate == 20 || p->phy_rate == 55 ||
+	    p->phy_rate == 110)
+		preamble = 192;
+	else
+		preamble = 20;
+	return preamble + p->wlan_len * 80 / p->phy_rate;
+}
+
+/* first 20 MHz channel and number of channels occupied in 5 GHz */
+static int occupied_5g(int chan, enum uwifi_chan_width width, bool ht40plus,
+		       int* num)
+{
+	int start = chan >= 149 ? 149 : 36;
+
+	switch (width) {
+	case CHAN_WIDTH_40:
+		*num = 2;
+		/* the secondary channel is given by HT40+/-, also outside
+		 * the usual 40 MHz blocks */
+		return ht40plus ? chan : chan - 4;
+	case CHAN_WIDTH_80:
+	case CHAN_WIDTH_8080:
+		*num = 4;
+		break;
+	case CHAN_WIDTH_160:
+		*num = 8;
+		break;
+	default:
+		*num = 1;
+		return chan;
+	}
+	return start + (chan - start) / (4 * *num) * (4 * *num);
+}
+
+static inline void score_add(struct uwifi_interference* est, int chan,
+			     uint64_t w, bool add)
+{
+	if (chan <= 0 || chan >= UWIFI_INTF_MAX_CHAN)
+		return;
+	if (add)
+		est->score[chan] += w;
+	else
+		est->score[chan] -= w;
+}
+
+static void intf_apply(struct uwifi_interference* est, const struct uwifi_intf_ap* a,
+		       bool add)
+{
+	int first, num;
+
+	if (a->chan == 0 || a->weight == 0)
+		return;
+
+	if (a->chan <= 14) {
+		first = a->chan;
+		num = 1;
+		if (a->width >= CHAN_WIDTH_40) {
+			num = 2;
+			if (!a->ht40plus)
+				first -= 4;
+		}
+		for (int c = first; c <= first + 4 * (num - 1); c += 4)
+			for (int d = -4; d <= 4; d++)
+				score_add(est, c + d, a->weight * aci_24[d < 0 ? -d : d] >> 8, add);
+		return;
+	}
+
+	first = occupied_5g(a->chan, a->width, a->ht40plus, &num);
+	for (int i = 0; i < num; i++)
+		score_add(est, first + 4 * i, a->weight, add);
+}
+
+static void intf_node_remove(struct uwifi_node* n, void* ctx)
+{
+	struct uwifi_interference* est = ctx;
+
+	intf_apply(est, &n->intf, false);
+	memset(&n->intf, 0, sizeof(n->intf));
+}
+
+bool uwifi_interference_init(struct uwifi_interference* est,
+			     struct cc_list_head* nodes, uint32_t window)
+{
+	memset(est, 0, sizeof(struct uwifi_interference));
+	est->nodes = nodes;
+	est->window = window ? window : UWIFI_INTF_WINDOW;
+	return uwifi_nodes_add_remove_cb(nodes, intf_node_remove, est);
+}
+
+void uwifi_interference_free(struct uwifi_interference* est)
+{
+	uwifi_nodes_del_remove_cb(est->nodes, intf_node_remove, est);
+}
+
+/* replace the weight of @ap with its current values */
+static void intf_update_ap(struct uwifi_interference* est, struct uwifi_node* ap)
+{
+	struct uwifi_intf_ap* a = &ap->intf;
+
+	intf_apply(est, a, false);
+	a->chan = ap->wlan_channel < UWIFI_INTF_MAX_CHAN ? ap->wlan_channel : 0;
+	a->width = ap->wlan_chan_width;
+	a->ht40plus = ap->wlan_ht40plus;
+	/* no signal of the AP itself yet, e.g. it was only seen as receiver
+	 * or its statistics were reset by uwifi_nodes_reduce() */
+	if (ap->phy_sig_tavg.weight == 0)
+		a->weight = 0;
+	else
+		a->weight = (sig_to_power(uwifi_tewma_read(&ap->phy_sig_tavg)) *
+			     a->activity) >> 16;
+	intf_apply(est, a, true);
+}
+
+void uwifi_interference_update(struct uwifi_interference* est,
+			       struct uwifi_node* n, struct uwifi_packet* p)
+{
+	struct uwifi_node* ap;
+	struct uwifi_intf_ap* a;
+	uint32_t now, elapsed;
+
+	if (n == NULL || p->phy_flags & PHY_FLAG_BADFCS)
+		return;
+
+	/* account to the BSS */
+	if (n->wlan_mode & WLAN_MODE_AP)
+		ap = n;
+	else if (n->ap_node != NULL)
+		ap = n->ap_node;
+	else
+		return;
+
+	a = &ap->intf;
+	now = plat_time_usec();
+
+	if (a->window_start == 0) {
+		a->window_start = now;
+		/* until the first window is measured assume little activity */
+		a->activity = 1 << 12;
+	}
+	a->airtime += pkt_airtime(p);
+
+	elapsed = now - a->window_start;
+	if (elapsed >= est->window) {
+		uint32_t act = MIN((uint64_t)a->airtime << 16, (uint64_t)elapsed << 16) / elapsed;
+		a->activity = (a->activity * 3 + act) / 4;
+		a->airtime = 0;
+		a->window_start = now;
+		intf_update_ap(est, ap);
+	} else if (ap->wlan_channel != a->chan ||
+		   ap->wlan_chan_width != a->width ||
+		   ap->wlan_ht40plus != a->ht40plus) {
+		/* new AP or changed channel */
+		intf_update_ap(est, ap);
+	}
+}
+
+uint64_t uwifi_interference_score(const struct uwifi_interference* est,
+				  int chan, enum uwifi_chan_width width,
+				  bool ht40plus)
+{
+	uint64_t sum = 0;
+	int first, num;
+
+	if (chan <= 0 || chan >= UWIFI_INTF_MAX_CHAN)
+		return 0;
+
+	if (chan <= 14) {
+		sum = est->score[chan];
+		if (width >= CHAN_WIDTH_40) {
+			int sec = ht40plus ? chan + 4 : chan - 4;
+			if (sec > 0 && sec < UWIFI_INTF_MAX_CHAN)
+				sum += est->score[sec];
+		}
+		return sum;
+	}
+
+	first = occupied_5g(chan, width, ht40plus, &num);
+	for (int i = 0; i < num; i++)
+		if (first + 4 * i < UWIFI_INTF_MAX_CHAN)
+			sum += est->score[first + 4 * i];
+	return sum;
+}
+
+int uwifi_interference_best(const struct uwifi_interference* est,
+			    struct uwifi_channels* channels,
+			    enum uwifi_chan_width width)
+{
+	uint64_t best_score = UINT64_MAX;
+	int best = 0;
+
+	for (int i = 0; i < uwifi_channel_get_num_channels(channels); i++) {
+		struct uwifi_chan_freq* cf = &channels->chan[i];
+		bool plus;
+
+		if (cf->max_width < width)
+			continue;
+		if (width == CHAN_WIDTH_40 && !cf->ht40plus && !cf->ht40minus)
+			continue;
+		plus = cf->ht40plus;
+
+		uint64_t s = uwifi_interference_score(est, cf->chan, width, plus);
+		if (s < best_score) {
+			best_score = s;
+			best = cf->chan;
+		}
+	}
+	return best;
+}
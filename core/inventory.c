@@ -0,0 +1,195 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <string.h>
+
+#include "inventory.h"
+#include "node.h"
+
+enum role {
+	ROLE_NONE,
+	ROLE_AP,
+	ROLE_CLIENT,
+};
+
+static void hist_apply(struct uwifi_inv_hist* h, const struct uwifi_inv_node* c,
+		       int d)
+{
+	h->total += d;
+	h->std[c->std] += d;
+	h->width[c->width] += d;
+	h->nss[c->nss] += d;
+	h->band[c->band] += d;
+	h->sec[c->sec] += d;
+	h->std_nss[c->std][c->nss] += d;
+}
+
+/* add or subtract the current category of @n */
+static void inv_apply(struct uwifi_inventory* inv, struct uwifi_node* n, int d)
+{
+	struct uwifi_inv_node* c = &n->inv;
+	struct uwifi_inv_bss* b;
+
+	if (c->role == ROLE_AP) {
+		hist_apply(&inv->aps, c, d);
+	} else if (c->role == ROLE_CLIENT) {
+		hist_apply(&inv->clients, c, d);
+		/* not if the AP and its entry are gone meanwhile */
+		b = c->bss != 0 ? &inv->bss[c->bss - 1] : NULL;
+		if (b != NULL && b->ap != NULL && b->gen == c->gen)
+			hist_apply(&b->hist, c, d);
+	}
+}
+
+static void inv_bss_alloc(struct uwifi_inventory* inv, struct uwifi_node* n)
+{
+	for (int i = 0; i < UWIFI_INV_MAX_BSS; i++) {
+		struct uwifi_inv_bss* b = &inv->bss[i];
+		if (b->ap != NULL)
+			continue;
+		b->ap = n;
+		n->inv.bss = i + 1;
+		n->inv.gen = b->gen;
+		inv->bss_used++;
+		return;
+	}
+}
+
+/* entries of the clients become invalid by the generation */
+static void inv_bss_free(struct uwifi_inventory* inv, struct uwifi_node* n)
+{
+	struct uwifi_inv_bss* b = &inv->bss[n->inv.bss - 1];
+
+	memset(&b->hist, 0, sizeof(b->hist));
+	b->ap = NULL;
+	b->gen++;
+	inv->bss_used--;
+	n->inv.bss = 0;
+}
+
+static void inv_node_remove(struct uwifi_node* n, void* ctx)
+{
+	struct uwifi_inventory* inv = ctx;
+
+	inv_apply(inv, n, -1);
+	if (n->inv.role == ROLE_AP && n->inv.bss != 0)
+		inv_bss_free(inv, n);
+	n->inv.role = ROLE_NONE;
+	n->inv.bss = 0;
+}
+
+bool uwifi_inventory_init(struct uwifi_inventory* inv, struct cc_list_head* nodes)
+{
+	memset(inv, 0, sizeof(struct uwifi_inventory));
+	inv->nodes = nodes;
+	return uwifi_nodes_add_remove_cb(nodes, inv_node_remove, inv);
+}
+
+void uwifi_inventory_free(struct uwifi_inventory* inv)
+{
+	uwifi_nodes_del_remove_cb(inv->nodes, inv_node_remove, inv);
+}
+
+static enum uwifi_inv_band chan_band(unsigned int chan)
+{
+	if (chan == 0)
+		return UWIFI_INV_BAND_UNKNOWN;
+	return chan <= 14 ? UWIFI_INV_BAND_2GHZ : UWIFI_INV_BAND_5GHZ;
+}
+
+/* of an AP, from its beacons and probe responses */
+static enum uwifi_inv_sec ap_sec(const struct uwifi_node* n)
+{
+	if (n->wlan_rsn)
+		return UWIFI_INV_SEC_RSN;
+	if (n->wlan_wpa)
+		return UWIFI_INV_SEC_WPA;
+	if (n->wlan_wep)
+		return UWIFI_INV_SEC_WEP;
+	return UWIFI_INV_SEC_OPEN;
+}
+
+/* of a client, where the protected bit of its frames is only a guess */
+static enum uwifi_inv_sec client_sec(const struct uwifi_node* n, uint8_t last)
+{
+	/* the BSS decides, if a beacon of the AP was seen */
+	if (n->ap_node != NULL && n->ap_node->wlan_tsf != 0)
+		return ap_sec(n->ap_node);
+	/* RSN or WPA IE of the (re)association request */
+	if (n->wlan_rsn)
+		return UWIFI_INV_SEC_RSN;
+	if (n->wlan_wpa)
+		return UWIFI_INV_SEC_WPA;
+	/* unprotected EAPOL or null frames don't make it open again */
+	if (n->wlan_wep || last == UWIFI_INV_SEC_WEP)
+		return UWIFI_INV_SEC_WEP;
+	return UWIFI_INV_SEC_OPEN;
+}
+
+void uwifi_inventory_update(struct uwifi_inventory* inv, struct uwifi_node* n)
+{
+	struct uwifi_inv_node* c;
+	uint8_t role = ROLE_NONE;
+	uint8_t sec = UWIFI_INV_SEC_OPEN;
+	uint16_t bss = 0, gen = 0;
+	uint8_t nss;
+
+	if (n == NULL)
+		return;
+	c = &n->inv;
+
+	if (n->wlan_mode & WLAN_MODE_AP) {
+		role = ROLE_AP;
+		sec = ap_sec(n);
+	} else if (n->wlan_mode & (WLAN_MODE_STA | WLAN_MODE_PROBE)) {
+		role = ROLE_CLIENT;
+		sec = client_sec(n, c->sec);
+		/* counted in the BSS once the AP has an entry */
+		if (n->ap_node != NULL && n->ap_node->inv.role == ROLE_AP) {
+			bss = n->ap_node->inv.bss;
+			gen = n->ap_node->inv.gen;
+		}
+	}
+	nss = MIN(MAX(n->wlan_tx_streams, n->wlan_rx_streams), UWIFI_INV_MAX_NSS);
+
+	if (role != c->role ||
+	    (role == ROLE_CLIENT && (bss != c->bss || gen != c->gen)) ||
+	    n->wlan_std != c->std || n->wlan_chan_width != c->width ||
+	    nss != c->nss || chan_band(n->wlan_channel) != c->band ||
+	    sec != c->sec) {
+		inv_apply(inv, n, -1);
+		if (c->role == ROLE_AP && role != ROLE_AP && c->bss != 0)
+			inv_bss_free(inv, n);
+		else if (c->role != ROLE_AP && role == ROLE_AP)
+			c->bss = 0;
+		if (role != ROLE_AP) {
+			c->bss = bss;
+			c->gen = gen;
+		}
+		c->role = role;
+		c->std = MIN(n->wlan_std, UWIFI_INV_STDS - 1);
+		c->width = MIN(n->wlan_chan_width, UWIFI_INV_WIDTHS - 1);
+		c->nss = nss;
+		c->band = chan_band(n->wlan_channel);
+		c->sec = sec;
+		inv_apply(inv, n, 1);
+	}
+
+	/* APs get an entry for their clients as soon as one is free */
+	if (role == ROLE_AP && c->bss == 0 && inv->bss_used < UWIFI_INV_MAX_BSS)
+		inv_bss_alloc(inv, n);
+}
+
+const struct uwifi_inv_hist* uwifi_inventory_bss(const struct uwifi_inventory* inv,
+						 const struct uwifi_node* ap)
+{
+	if (ap->inv.role != ROLE_AP || ap->inv.bss == 0)
+		return NULL;
+	return &inv->bss[ap->inv.bss - 1].hist;
+}
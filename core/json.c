@@ -0,0 +1,335 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "json.h"
+#include "node.h"
+#include "essid.h"
+#include "channel.h"
+#include "conf.h"
+#include "wlan_util.h"
+
+static const char hex[] = "0123456789abcdef";
+
+/* write cursor, p is NULL after running out of space */
+struct jw {
+	char*	p;
+	char*	end;
+};
+
+static void jw_raw(struct jw* w, const char* s, size_t len)
+{
+	if (w->p == NULL || (size_t)(w->end - w->p) < len) {
+		w->p = NULL;
+		return;
+	}
+	memcpy(w->p, s, len);
+	w->p += len;
+}
+
+#define jw_lit(_w, _s)	jw_raw(_w, _s, sizeof(_s) - 1)
+
+static void jw_uint(struct jw* w, uint64_t v)
+{
+	char tmp[20];
+	char* t = tmp + sizeof(tmp);
+
+	do {
+		*--t = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	jw_raw(w, t, tmp + sizeof(tmp) - t);
+}
+
+static void jw_int(struct jw* w, int64_t v)
+{
+	if (v < 0) {
+		jw_lit(w, "-");
+		jw_uint(w, -(uint64_t)v);
+	} else {
+		jw_uint(w, v);
+	}
+}
+
+static void jw_bool(struct jw* w, bool b)
+{
+	if (b)
+		jw_lit(w, "true");
+	else
+		jw_lit(w, "false");
+}
+
+static void jw_mac(struct jw* w, const unsigned char* mac)
+{
+	char s[19];
+	char* t = s;
+
+	*t++ = '"';
+	for (int i = 0; i < WLAN_MAC_LEN; i++) {
+		*t++ = hex[mac[i] >> 4];
+		*t++ = hex[mac[i] & 0xf];
+		*t++ = i < WLAN_MAC_LEN - 1 ? ':' : '"';
+	}
+	jw_raw(w, s, sizeof(s));
+}
+
+/* quoted string, valid UTF-8 sequences are copied as they are, control
+ * characters, DEL and bytes which are not part of valid UTF-8 are sent as
+ * \u00XX (Latin-1), so the output is valid JSON for any SSID */
+static void jw_str(struct jw* w, const char* s, size_t len)
+{
+	const unsigned char* u = (const unsigned char*)s;
+	size_t i = 0;
+	int n;
+
+	jw_lit(w, "\"");
+	while (i < len) {
+		unsigned char c = u[i];
+		if (c == '"' || c == '\\') {
+			char e[2] = { '\\', c };
+			jw_raw(w, e, 2);
+		} else if (c >= 0x80 && (n = utf8_valid_len(u + i, len - i)) > 1) {
+			jw_raw(w, s + i, n);
+			i += n;
+			continue;
+		} else if (c < 0x20 || c >= 0x7f) {
+			char e[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+			jw_raw(w, e, 6);
+		} else {
+			jw_raw(w, (char*)&c, 1);
+		}
+		i++;
+	}
+	jw_lit(w, "\"");
+}
+
+static void jw_cstr(struct jw* w, const char* s)
+{
+	jw_str(w, s, strlen(s));
+}
+
+static void jw_ssid(struct jw* w, const struct uwifi_ssid* s)
+{
+	jw_str(w, s->ssid, s->len);
+}
+
+/*** records ***/
+
+typedef void (*json_writer)(struct jw* w, const void* obj);
+
+static void write_node(struct jw* w, const void* obj)
+{
+	const struct uwifi_node* n = obj;
+
+	jw_lit(w, "{\"type\":\"node\",\"mac\":");
+	jw_mac(w, n->wlan_src);
+	jw_lit(w, ",\"bssid\":");
+	jw_mac(w, n->wlan_bssid);
+	if (n->essid != NULL) {
+		jw_lit(w, ",\"essid\":");
+		jw_ssid(w, uwifi_essid_ssid(n->essid));
+	}
+	jw_lit(w, ",\"mode\":");
+	jw_cstr(w, wlan_mode_string(n->wlan_mode));
+	jw_lit(w, ",\"std\":");
+	jw_cstr(w, wlan_80211std_str(n->wlan_std));
+	jw_lit(w, ",\"chan\":");
+	jw_uint(w, n->wlan_channel);
+	jw_lit(w, ",\"width\":");
+	jw_cstr(w, uwifi_channel_width_string(n->wlan_chan_width));
+	jw_lit(w, ",\"pkts\":");
+	jw_uint(w, n->pkt_count);
+	jw_lit(w, ",\"rx_pkts\":");
+	jw_uint(w, n->rx_pkt_count);
+	jw_lit(w, ",\"retries\":");
+	jw_uint(w, n->wlan_retries_all);
+	jw_lit(w, ",\"sig\":");
+	jw_int(w, n->phy_sig_last);
+	jw_lit(w, ",\"sig_avg\":");
+	jw_int(w, -(long)ewma_read(&n->phy_sig_avg));
+	jw_lit(w, ",\"sig_max\":");
+	jw_int(w, n->phy_sig_max);
+#if UWIFI_NODE_STATS
+	if (n->phy_sig_stat.count > 0) {
+		jw_lit(w, ",\"sig_min\":");
+		jw_int(w, n->phy_sig_stat.min);
+		jw_lit(w, ",\"sig_stddev\":");
+		jw_uint(w, (uwifi_stat_stddev_q8(&n->phy_sig_stat) + 128) >> 8);
+		jw_lit(w, ",\"sig_tavg\":");
+		jw_int(w, uwifi_tewma_read(&n->phy_sig_tavg));
+	}
+#endif
+	jw_lit(w, ",\"noise\":");
+	jw_int(w, n->phy_noise_last);
+	jw_lit(w, ",\"rate\":");
+	jw_uint(w, n->phy_rate_last);
+	jw_lit(w, ",\"last_seen\":");
+	jw_uint(w, n->last_seen);
+	jw_lit(w, ",\"wep\":");
+	jw_bool(w, n->wlan_wep);
+	jw_lit(w, ",\"wpa\":");
+	jw_bool(w, n->wlan_wpa);
+	jw_lit(w, ",\"rsn\":");
+	jw_bool(w, n->wlan_rsn);
+	jw_lit(w, ",\"rx_only\":");
+	jw_bool(w, n->rx_only);
+	jw_lit(w, "}\n");
+}
+
+static void write_essid(struct jw* w, const void* obj)
+{
+	const struct essid_info* e = obj;
+
+	jw_lit(w, "{\"type\":\"essid\",\"essid\":");
+	jw_ssid(w, uwifi_essid_ssid(e));
+	jw_lit(w, ",\"nodes\":");
+	jw_uint(w, e->num_nodes);
+	jw_lit(w, ",\"split\":");
+	jw_bool(w, e->split);
+	jw_lit(w, "}\n");
+}
+
+static void write_channel(struct jw* w, const void* obj)
+{
+	const struct uwifi_interface* intf = obj;
+
+	jw_lit(w, "{\"type\":\"chan\",\"freq\":");
+	jw_uint(w, intf->channel.freq);
+	if (intf->channel_idx >= 0 && intf->channel_idx < intf->channels.num_channels) {
+		jw_lit(w, ",\"chan\":");
+		jw_int(w, intf->channels.chan[intf->channel_idx].chan);
+#if UWIFI_NODE_STATS
+		const struct uwifi_stat* s = &intf->chan_sig[intf->channel_idx];
+		if (s->count > 0) {
+			jw_lit(w, ",\"sig_min\":");
+			jw_int(w, s->min);
+			jw_lit(w, ",\"sig_max\":");
+			jw_int(w, s->max);
+			jw_lit(w, ",\"sig_mean\":");
+			jw_int(w, uwifi_stat_mean(s));
+			jw_lit(w, ",\"sig_stddev\":");
+			jw_uint(w, (uwifi_stat_stddev_q8(s) + 128) >> 8);
+		}
+#endif
+	}
+	jw_lit(w, ",\"width\":");
+	jw_cstr(w, uwifi_channel_width_string(intf->channel.width));
+	jw_lit(w, ",\"center_freq\":");
+	jw_uint(w, intf->channel.center_freq);
+	jw_lit(w, ",\"last_change\":");
+	jw_uint(w, intf->last_channelchange);
+	jw_lit(w, ",\"num_channels\":");
+	jw_int(w, intf->channels.num_channels);
+	jw_lit(w, ",\"scan\":");
+	jw_bool(w, intf->channel_scan);
+	jw_lit(w, "}\n");
+}
+
+static void write_packet(struct jw* w, const void* obj)
+{
+	const struct uwifi_packet* p = obj;
+
+	jw_lit(w, "{\"type\":\"pkt\",\"time\":");
+	jw_uint(w, p->pkt_time);
+	jw_lit(w, ",\"fc\":");
+	jw_cstr(w, wlan_get_packet_type_name(p->wlan_type));
+	jw_lit(w, ",\"ta\":");
+	jw_mac(w, p->wlan_ta);
+	jw_lit(w, ",\"ra\":");
+	jw_mac(w, p->wlan_ra);
+	jw_lit(w, ",\"bssid\":");
+	jw_mac(w, p->wlan_bssid);
+	if (p->wlan_essid_len > 0) {
+		jw_lit(w, ",\"essid\":");
+		jw_str(w, (const char*)p->wlan_essid, p->wlan_essid_len);
+	}
+	jw_lit(w, ",\"len\":");
+	jw_uint(w, p->wlan_len);
+	jw_lit(w, ",\"sig\":");
+	jw_int(w, p->phy_signal);
+	jw_lit(w, ",\"rate\":");
+	jw_uint(w, p->phy_rate);
+	jw_lit(w, ",\"freq\":");
+	jw_uint(w, p->phy_freq);
+	jw_lit(w, ",\"seq\":");
+	jw_uint(w, p->wlan_seqno);
+	jw_lit(w, ",\"retry\":");
+	jw_bool(w, p->wlan_retry);
+	jw_lit(w, ",\"badfcs\":");
+	jw_bool(w, p->phy_flags & PHY_FLAG_BADFCS);
+	jw_lit(w, "}\n");
+}
+
+static bool json_record(struct uwifi_json_out* out, json_writer fn, const void* obj)
+{
+	for (int i = 0; i < 2; i++) {
+		struct jw w = {
+			.p = out->buf + out->len,
+			.end = out->buf + out->size
+		};
+
+		fn(&w, obj);
+		if (w.p != NULL) {
+			out->len = w.p - out->buf;
+			return true;
+		}
+
+		/* did not fit: flush and try again with empty buffer */
+		if (out->len == 0 || !uwifi_json_flush(out))
+			return false;
+	}
+	return false;
+}
+
+/*** API ***/
+
+void uwifi_json_init(struct uwifi_json_out* out, char* buf, size_t size,
+		     uwifi_json_flush_cb flush, void* ctx)
+{
+	out->buf = buf;
+	out->size = size;
+	out->len = 0;
+	out->flush = flush;
+	out->ctx = ctx;
+}
+
+bool uwifi_json_flush(struct uwifi_json_out* out)
+{
+	bool ret;
+
+	if (out->flush == NULL)
+		return false;
+	if (out->len == 0)
+		return true;
+	ret = out->flush(out->buf, out->len, out->ctx);
+	out->len = 0;
+	return ret;
+}
+
+bool uwifi_json_node(struct uwifi_json_out* out, const struct uwifi_node* n)
+{
+	return json_record(out, write_node, n);
+}
+
+bool uwifi_json_essid(struct uwifi_json_out* out, const struct essid_info* e)
+{
+	return json_record(out, write_essid, e);
+}
+
+bool uwifi_json_channel(struct uwifi_json_out* out, const struct uwifi_interface* intf)
+{
+	return json_record(out, write_channel, intf);
+}
+
+bool uwifi_json_packet(struct uwifi_json_out* out, const struct uwifi_packet* p)
+{
+	return json_record(out, write_packet, p);
+}
@@ -16,6 +16,139 @@
 #include "node.h"
 #include "essid.h"
 #include "log.h"
+#include "probes.h"
+#include "counters.h"
+
+#if UWIFI_STATIC_TABLES
+/* fixed pool with a stack of free indices, shared by all node lists */
+static struct uwifi_node node_pool[UWIFI_MAX_NODES];
+static uint16_t node_free_idx[UWIFI_MAX_NODES];
+static int node_num_free = -1;
+
+static struct uwifi_node* node_pool_get(void)
+{
+	if (node_num_free < 0) {
+		for (int i = 0; i < UWIFI_MAX_NODES; i++)
+			node_free_idx[i] = UWIFI_MAX_NODES - 1 - i;
+		node_num_free = UWIFI_MAX_NODES;
+	}
+	if (node_num_free == 0)
+		return NULL;
+	return &node_pool[node_free_idx[--node_num_free]];
+}
+
+static void node_free(struct uwifi_node* n)
+{
+	node_free_idx[node_num_free++] = n - node_pool;
+}
+#else
+static struct uwifi_node* node_pool_get(void)
+{
+	return (struct uwifi_node*)malloc(sizeof(struct uwifi_node));
+}
+
+static void node_free(struct uwifi_node* n)
+{
+	free(n);
+}
+#endif
+
+static struct {
+	const struct cc_list_head* nodes;
+	uwifi_node_remove_cb	cb;
+	void*			ctx;
+} remove_cbs[UWIFI_NODE_MAX_REMOVE_CBS];
+
+bool uwifi_nodes_add_remove_cb(const struct cc_list_head* nodes,
+			       uwifi_node_remove_cb cb, void* ctx)
+{
+	for (int i = 0; i < UWIFI_NODE_MAX_REMOVE_CBS; i++) {
+		if (remove_cbs[i].cb == NULL) {
+			remove_cbs[i].nodes = nodes;
+			remove_cbs[i].cb = cb;
+			remove_cbs[i].ctx = ctx;
+			return true;
+		}
+	}
+	LOG_ERR("NODE too many remove callbacks");
+	return false;
+}
+
+void uwifi_nodes_del_remove_cb(const struct cc_list_head* nodes,
+			       uwifi_node_remove_cb cb, void* ctx)
+{
+	for (int i = 0; i < UWIFI_NODE_MAX_REMOVE_CBS; i++) {
+		if (remove_cbs[i].nodes == nodes && remove_cbs[i].cb == cb &&
+		    remove_cbs[i].ctx == ctx)
+			remove_cbs[i].cb = NULL;
+	}
+}
+
+static void node_call_remove_cbs(const struct cc_list_head* nodes,
+				 struct uwifi_node* n)
+{
+	for (int i = 0; i < UWIFI_NODE_MAX_REMOVE_CBS; i++) {
+		if (remove_cbs[i].cb != NULL && remove_cbs[i].nodes == nodes)
+			remove_cbs[i].cb(n, remove_cbs[i].ctx);
+	}
+}
+
+static struct uwifi_node* node_alloc(void)
+{
+	struct uwifi_node* n = node_pool_get();
+	if (n == NULL)
+		return NULL;
+
+	memset(n, 0, sizeof(struct uwifi_node));
+	ewma_init(&n->phy_sig_avg, 1024, 8);
+	ewma_init(&n->phy_snr_avg, 1024, 8);
+#if UWIFI_NODE_STATS
+	uwifi_tewma_init(&n->phy_sig_tavg, UWIFI_SIG_TAU);
+	for (int i = 0; i < UWIFI_MAX_CHAINS; i++) {
+		ewma_init(&n->phy_chain_sig_avg[i], 1024, 8);
+		ewma_init(&n->phy_chain_noise_avg[i], 1024, 8);
+	}
+#endif
+#if !UWIFI_STATIC_TABLES
+	cc_list_head_init(&n->on_channels);
+#endif
+	cc_list_head_init(&n->ap_nodes);
+	return n;
+}
+
+static void copy_chaininfo(struct uwifi_node* n, struct uwifi_packet* p)
+{
+	for (int i = 0; i < UWIFI_MAX_CHAINS; i++) {
+		if (p->phy_chains & BIT(i)) {
+			n->phy_chain_sig_last[i] = p->phy_chain_signal[i];
+#if UWIFI_NODE_STATS
+			ewma_add(&n->phy_chain_sig_avg[i], -p->phy_chain_signal[i]);
+			/* not all drivers report noise with the signal */
+			if (p->phy_chain_noise[i])
+				ewma_add(&n->phy_chain_noise_avg[i],
+					 -p->phy_chain_noise[i]);
+#endif
+		}
+	}
+	n->phy_chains |= p->phy_chains;
+}
+
+#if UWIFI_NODE_STATS
+/* time for phy_sig_tavg, packet time when the capture provides it, which
+ * differs from processing time for replayed or batched packets. Both have
+ * different bases, so a node always uses the same one */
+static uint32_t node_sig_time(struct uwifi_node* n, struct uwifi_packet* p)
+{
+	bool pkt = p->pkt_time != 0;
+
+	if (pkt != n->phy_sig_tavg_pkt) {
+		if (n->phy_sig_tavg.weight != 0)
+			uwifi_tewma_init(&n->phy_sig_tavg, UWIFI_SIG_TAU);
+		n->phy_sig_tavg_pkt = pkt;
+	}
+	return pkt ? (uint32_t)(p->pkt_time / 1000) : n->last_seen;
+}
+#endif
 
 static void copy_nodeinfo(struct uwifi_node* n, struct uwifi_packet* p)
 {
@@ -26,12 +159,13 @@ static void copy_nodeinfo(struct uwifi_node* n, struct uwifi_packet* p)
 		memcpy(n->wlan_bssid, p->wlan_bssid, WLAN_MAC_LEN);
 
 	n->last_seen = plat_time_usec();
-	n->pkt_count++;
+	uwifi_cnt_inc(n->pkt_count);
 	n->pkt_types |= p->pkt_types;
-	if (p->ip_src)
-		n->ip_src = p->ip_src;
 	if (p->wlan_mode)
 		n->wlan_mode |= p->wlan_mode;
+#if !UWIFI_STATIC_TABLES
+	if (p->ip_src)
+		n->ip_src = p->ip_src;
 	if (p->olsr_tc)
 		n->olsr_tc = p->olsr_tc;
 	if (p->olsr_neigh)
@@ -40,12 +174,15 @@ static void copy_nodeinfo(struct uwifi_node* n, struct uwifi_packet* p)
 //		n->olsr_count++;
 	if (p->bat_gw)
 		n->bat_gw = 1;
+#endif
 	if (p->wlan_ht40plus)
 		n->wlan_ht40plus = 1;
 	if (p->wlan_tx_streams)
 		n->wlan_tx_streams = p->wlan_tx_streams;
 	if (p->wlan_rx_streams)
 		n->wlan_rx_streams = p->wlan_rx_streams;
+	if (p->wlan_fingerprint)
+		n->wlan_fingerprint = p->wlan_fingerprint;
 
 	if ((p->wlan_type == WLAN_FRAME_BEACON) ||
 	    (p->wlan_type == WLAN_FRAME_PROBE_RESP)) {
@@ -63,15 +200,35 @@ static void copy_nodeinfo(struct uwifi_node* n, struct uwifi_packet* p)
 		n->wlan_channel = p->wlan_channel;
 	}
 
+	/* security the STA asks the AP for */
+	if ((p->wlan_type == WLAN_FRAME_ASSOC_REQ) ||
+	    (p->wlan_type == WLAN_FRAME_REASSOC_REQ)) {
+		n->wlan_wpa = p->wlan_wpa;
+		n->wlan_rsn = p->wlan_rsn;
+	}
+
 	n->phy_rate_last = p->phy_rate;
 	n->phy_sig_last = p->phy_signal;
 	ewma_add(&n->phy_sig_avg, -p->phy_signal);
 	n->phy_sig_sum += -p->phy_signal;
-	n->phy_sig_count += 1;
+	uwifi_cnt_inc(n->phy_sig_count);
+#if UWIFI_NODE_STATS
+	uwifi_stat_add(&n->phy_sig_stat, p->phy_signal);
+	uwifi_tewma_add(&n->phy_sig_tavg, p->phy_signal, node_sig_time(n, p));
+#endif
 
 	if (p->phy_signal > n->phy_sig_max || n->phy_sig_max == 0)
 		n->phy_sig_max = p->phy_signal;
 
+	if (p->phy_noise)
+		n->phy_noise_last = p->phy_noise;
+	if (p->phy_snr)
+		ewma_add(&n->phy_snr_avg, p->phy_snr);
+
+	/* most drivers don't report per-chain values */
+	if (p->phy_chains)
+		copy_chaininfo(n, p);
+
 	if ((p->wlan_type == WLAN_FRAME_DATA) ||
 	    (p->wlan_type == WLAN_FRAME_QDATA) ||
 	    (p->wlan_type == WLAN_FRAME_AUTH) ||
@@ -87,8 +244,8 @@ static void copy_nodeinfo(struct uwifi_node* n, struct uwifi_packet* p)
 
 	if (p->wlan_seqno != 0) {
 		if (p->wlan_retry && p->wlan_seqno == n->wlan_seqno) {
-			n->wlan_retries_all++;
-			n->wlan_retries_last++;
+			uwifi_cnt_inc(n->wlan_retries_all);
+			uwifi_cnt_inc(n->wlan_retries_last);
 		} else
 			n->wlan_retries_last = 0;
 		n->wlan_seqno = p->wlan_seqno;
@@ -109,6 +266,66 @@ static void copy_nodeinfo(struct uwifi_node* n, struct uwifi_packet* p)
 	p->wlan_retries = n->wlan_retries_last;
 }
 
+static void node_remove(struct cc_list_head* nodes, struct uwifi_node* n)
+{
+	struct uwifi_node *n2, *m2;
+//	struct chan_node *cn, *cn2;
+
+	node_call_remove_cbs(nodes, n);
+	cc_list_del_from(nodes, &n->list);
+	if (n->ap_node) {
+		cc_list_del_from(&n->ap_node->ap_nodes, &n->ap_list);
+		n->ap_node = NULL;
+	}
+	if (n->essid != NULL)
+		uwifi_essids_remove_node(n);
+#if UWIFI_NODE_PROBED
+	uwifi_ssid_set_clear(&n->probed);
+#endif
+//	list_for_each_safe(&n->on_channels, cn, cn2, node_list) {
+//		list_del(&cn->node_list);
+//		list_del(&cn->chan_list);
+//		cn->chan->num_nodes--;
+//		free(cn);
+//	}
+	/* clear AP list */
+	cc_list_for_each_safe(&n->ap_nodes, n2, m2, ap_list) {
+		cc_list_del_from(&n->ap_nodes, &n2->ap_list);
+		n2->ap_node = NULL;
+	}
+	node_free(n);
+}
+
+static struct uwifi_node* node_new(__attribute__((unused)) struct cc_list_head* nodes)
+{
+	struct uwifi_node* n = node_alloc();
+
+#if UWIFI_STATIC_TABLES
+	if (n == NULL) {
+		/* table is full: replace the node not seen for the longest time */
+		struct uwifi_node *o, *oldest = NULL;
+		uint32_t now = plat_time_usec();
+
+		cc_list_for_each(nodes, o, list) {
+			if (oldest == NULL ||
+			    now - o->last_seen > now - oldest->last_seen)
+				oldest = o;
+		}
+		if (oldest == NULL)
+			return NULL;
+		LOG_DBG("NODE table full, replacing " MAC_FMT,
+			MAC_PAR(oldest->wlan_src));
+		UWIFI_PROBE2(node_evict, oldest->wlan_src, now - oldest->last_seen);
+		UWIFI_COUNT(UWIFI_CNT_NODES_EVICTED);
+		node_remove(nodes, oldest);
+		n = node_alloc();
+	}
+#endif
+	if (n == NULL)
+		UWIFI_COUNT(UWIFI_CNT_NODES_ALLOC_FAIL);
+	return n;
+}
+
 struct uwifi_node* uwifi_node_update(struct uwifi_packet* p, struct cc_list_head* nodes)
 {
 	struct uwifi_node* n;
@@ -122,22 +339,24 @@ struct uwifi_node* uwifi_node_update(struct uwifi_packet* p, struct cc_list_head
 		return NULL;
 
 	/* find node by wlan source address */
+	UWIFI_TIME_START(start);
 	cc_list_for_each(nodes, n, list) {
 		if (memcmp(p->wlan_ta, n->wlan_src, WLAN_MAC_LEN) == 0) {
 			LOG_DBG("NODE found %p " MAC_FMT, n, MAC_PAR(p->wlan_ta));
 			break;
 		}
 	}
+	UWIFI_HIST_SINCE(UWIFI_HIST_NODE_LOOKUP, start);
 
 	/* not found */
 	if (&n->list == &nodes->n) {
-		n = (struct uwifi_node*)malloc(sizeof(struct uwifi_node));
-		memset(n, 0, sizeof(struct uwifi_node));
-		ewma_init(&n->phy_sig_avg, 1024, 8);
-		      cc_list_head_init(&n->on_channels);
-		      cc_list_head_init(&n->ap_nodes);
+		n = node_new(nodes);
+		if (n == NULL)
+			return NULL;
 		cc_list_add_tail(nodes, &n->list);
 		LOG_DBG("NODE adding %p " MAC_FMT, n, MAC_PAR(p->wlan_ta));
+		UWIFI_PROBE2(node_create, p->wlan_ta, 0);
+		UWIFI_COUNT(UWIFI_CNT_NODES_CREATED);
 	}
 
 	copy_nodeinfo(n, p);
@@ -152,7 +371,7 @@ static void copy_rx_nodeinfo(struct uwifi_node* n, struct uwifi_packet* p)
 		memcpy(n->wlan_bssid, p->wlan_bssid, WLAN_MAC_LEN);
 
 	n->last_seen = plat_time_usec();
-	n->rx_pkt_count++;
+	uwifi_cnt_inc(n->rx_pkt_count);
 	n->pkt_types |= p->pkt_types;
 
 	/* if packet sender was AP we know recipient is STA and vice versa */
@@ -196,22 +415,24 @@ struct uwifi_node* uwifi_node_update_receiver(struct uwifi_packet* p, struct cc_
 		return NULL;
 
 	/* find node by wlan source address */
+	UWIFI_TIME_START(start);
 	cc_list_for_each(nodes, n, list) {
 		if (memcmp(p->wlan_ra, n->wlan_src, WLAN_MAC_LEN) == 0) {
 			LOG_DBG("RX NODE found %p " MAC_FMT, n, MAC_PAR(p->wlan_ra));
 			break;
 		}
 	}
+	UWIFI_HIST_SINCE(UWIFI_HIST_NODE_LOOKUP, start);
 
 	/* not found */
 	if (&n->list == &nodes->n) {
-		n = (struct uwifi_node*)malloc(sizeof(struct uwifi_node));
-		memset(n, 0, sizeof(struct uwifi_node));
-		ewma_init(&n->phy_sig_avg, 1024, 8);
-		      cc_list_head_init(&n->on_channels);
-		      cc_list_head_init(&n->ap_nodes);
+		n = node_new(nodes);
+		if (n == NULL)
+			return NULL;
 		cc_list_add_tail(nodes, &n->list);
 		LOG_DBG("RX NODE adding %p " MAC_FMT, n, MAC_PAR(p->wlan_ra));
+		UWIFI_PROBE2(node_create, p->wlan_ra, 1);
+		UWIFI_COUNT(UWIFI_CNT_NODES_CREATED);
 		n->rx_only = true;
 	}
 
@@ -251,8 +472,7 @@ void uwifi_nodes_find_ap(struct uwifi_node* n, struct cc_list_head* nodes)
 void uwifi_nodes_timeout(struct cc_list_head* nodes, unsigned int timeout_sec,
 			 uint32_t* last_nodetimeout)
 {
-	struct uwifi_node *n, *m, *n2, *m2;
-//	struct chan_node *cn, *cn2;
+	struct uwifi_node *n, *m;
 	uint32_t the_time = plat_time_usec();
 
 	if ((the_time - *last_nodetimeout) < timeout_sec * 1000000)
@@ -263,25 +483,9 @@ void uwifi_nodes_timeout(struct cc_list_head* nodes, unsigned int timeout_sec,
 		if (the_time - n->last_seen > timeout_sec * 1000000) {
 			LOG_DBG("NODE timeout %p " MAC_FMT, n,
 				MAC_PAR(n->wlan_src));
-			cc_list_del_from(nodes, &n->list);
-			if (n->ap_node) {
-				cc_list_del_from(&n->ap_node->ap_nodes, &n->ap_list);
-				n->ap_node = NULL;
-			}
-			if (n->essid != NULL)
-				uwifi_essids_remove_node(n);
-//			list_for_each_safe(&n->on_channels, cn, cn2, node_list) {
-//				list_del(&cn->node_list);
-//				list_del(&cn->chan_list);
-//				cn->chan->num_nodes--;
-//				free(cn);
-//			}
-			/* clear AP list */
-			cc_list_for_each_safe(&n->ap_nodes, n2, m2, ap_list) {
-				cc_list_del_from(&n->ap_nodes, &n2->ap_list);
-				n2->ap_node = NULL;
-			}
-			free(n);
+			UWIFI_PROBE2(node_expire, n->wlan_src, the_time - n->last_seen);
+			UWIFI_COUNT(UWIFI_CNT_NODES_EXPIRED);
+			node_remove(nodes, n);
 		}
 	}
 	*last_nodetimeout = the_time;
@@ -297,7 +501,167 @@ void uwifi_nodes_free(struct cc_list_head* nodes)
 
 	cc_list_for_each_safe(nodes, ni, mi, list) {
 		LOG_DBG("NODE free %p " MAC_FMT, ni, MAC_PAR(ni->wlan_src));
+		node_call_remove_cbs(nodes, ni);
 		cc_list_del_from(nodes, &ni->list);
-		free(ni);
+#if UWIFI_NODE_PROBED
+		uwifi_ssid_set_clear(&ni->probed);
+#endif
+		node_free(ni);
+	}
+}
+
+void uwifi_node_merge(struct uwifi_node* dst,
+		      __attribute__((unused)) struct uwifi_ssid_table* ssids,
+		      const struct uwifi_node* src)
+{
+	/* time may wrap, so compare the difference */
+	bool newer = (int32_t)(src->last_seen - dst->last_seen) >= 0;
+
+	/* sums and counts */
+	uwifi_cnt_add(dst->pkt_count, src->pkt_count);
+	uwifi_cnt_add(dst->rx_pkt_count, src->rx_pkt_count);
+	uwifi_cnt_add(dst->phy_sig_count, src->phy_sig_count);
+	uwifi_cnt_add(dst->wlan_retries_all, src->wlan_retries_all);
+	dst->phy_sig_sum += src->phy_sig_sum;
+	dst->pkt_types |= src->pkt_types;
+	dst->phy_chains |= src->phy_chains;
+	dst->wlan_mode |= src->wlan_mode;
+	dst->rx_only = dst->rx_only && src->rx_only;
+
+	/* averages and distributions */
+	ewma_merge(&dst->phy_sig_avg, &src->phy_sig_avg, src->pkt_count);
+	ewma_merge(&dst->phy_snr_avg, &src->phy_snr_avg, src->pkt_count);
+#if UWIFI_NODE_STATS
+	for (int i = 0; i < UWIFI_MAX_CHAINS; i++) {
+		ewma_merge(&dst->phy_chain_sig_avg[i], &src->phy_chain_sig_avg[i],
+			   src->pkt_count);
+		ewma_merge(&dst->phy_chain_noise_avg[i], &src->phy_chain_noise_avg[i],
+			   src->pkt_count);
+	}
+	uwifi_stat_merge(&dst->phy_sig_stat, &src->phy_sig_stat);
+	if (dst->phy_sig_tavg_pkt == src->phy_sig_tavg_pkt) {
+		uwifi_tewma_merge(&dst->phy_sig_tavg, &src->phy_sig_tavg);
+	} else if (src->phy_sig_tavg.weight != 0) {
+		/* different time base, the times can't be compared */
+		dst->phy_sig_tavg = src->phy_sig_tavg;
+		dst->phy_sig_tavg_pkt = src->phy_sig_tavg_pkt;
+	}
+#endif
+
+	if (src->phy_sig_max != 0 &&
+	    (src->phy_sig_max > dst->phy_sig_max || dst->phy_sig_max == 0))
+		dst->phy_sig_max = src->phy_sig_max;
+	dst->wlan_chan_width = MAX(dst->wlan_chan_width, src->wlan_chan_width);
+	dst->wlan_std = MAX(dst->wlan_std, src->wlan_std);
+	dst->wlan_ht40plus |= src->wlan_ht40plus;
+	if (src->wlan_tx_streams)
+		dst->wlan_tx_streams = src->wlan_tx_streams;
+	if (src->wlan_rx_streams)
+		dst->wlan_rx_streams = src->wlan_rx_streams;
+	if (src->wlan_fingerprint)
+		dst->wlan_fingerprint = src->wlan_fingerprint;
+#if UWIFI_NODE_PROBED
+	uwifi_ssid_set_merge(&dst->probed, ssids, &src->probed);
+#endif
+	if (dst->wlan_channel == 0 || (newer && src->wlan_channel != 0))
+		dst->wlan_channel = src->wlan_channel;
+	if (MAC_NOT_EMPTY(src->wlan_bssid) &&
+	    (newer || MAC_EMPTY(dst->wlan_bssid)))
+		memcpy(dst->wlan_bssid, src->wlan_bssid, WLAN_MAC_LEN);
+
+#if !UWIFI_STATIC_TABLES
+	dst->bat_gw |= src->bat_gw;
+	if (src->ip_src)
+		dst->ip_src = src->ip_src;
+	if (src->olsr_neigh)
+		dst->olsr_neigh = src->olsr_neigh;
+	if (src->olsr_tc)
+		dst->olsr_tc = src->olsr_tc;
+	dst->olsr_count += src->olsr_count;
+#endif
+
+	if (!newer)
+		return;
+
+	/* last values */
+	dst->last_seen = src->last_seen;
+	if (src->pkt_count == 0)	/* only seen as receiver */
+		return;
+	dst->phy_rate_last = src->phy_rate_last;
+	dst->phy_sig_last = src->phy_sig_last;
+	if (src->phy_noise_last)
+		dst->phy_noise_last = src->phy_noise_last;
+	memcpy(dst->phy_chain_sig_last, src->phy_chain_sig_last,
+	       sizeof(dst->phy_chain_sig_last));
+	dst->wlan_retries_last = src->wlan_retries_last;
+	dst->wlan_seqno = src->wlan_seqno;
+	dst->wlan_wep = src->wlan_wep;
+	if (src->wlan_tsf) {
+		dst->wlan_tsf = src->wlan_tsf;
+		dst->wlan_bintval = src->wlan_bintval;
+		dst->wlan_wpa = src->wlan_wpa;
+		dst->wlan_rsn = src->wlan_rsn;
+	} else if (src->wlan_wpa || src->wlan_rsn) {
+		/* from a (re)association request */
+		dst->wlan_wpa = src->wlan_wpa;
+		dst->wlan_rsn = src->wlan_rsn;
+	}
+}
+
+/* clear what has been folded into the global view */
+static void node_reset_stats(struct uwifi_node* n)
+{
+	n->pkt_count = 0;
+	n->rx_pkt_count = 0;
+	n->phy_sig_count = 0;
+	n->phy_sig_sum = 0;
+	n->wlan_retries_all = 0;
+	ewma_init(&n->phy_sig_avg, 1024, 8);
+	ewma_init(&n->phy_snr_avg, 1024, 8);
+#if UWIFI_NODE_STATS
+	for (int i = 0; i < UWIFI_MAX_CHAINS; i++) {
+		ewma_init(&n->phy_chain_sig_avg[i], 1024, 8);
+		ewma_init(&n->phy_chain_noise_avg[i], 1024, 8);
+	}
+	uwifi_stat_init(&n->phy_sig_stat);
+	uwifi_tewma_init(&n->phy_sig_tavg, UWIFI_SIG_TAU);
+#endif
+#if UWIFI_NODE_PROBED
+	/* merged, the table of the shard only counts probes since the reduce */
+	uwifi_ssid_set_clear(&n->probed);
+#endif
+#if !UWIFI_STATIC_TABLES
+	n->olsr_count = 0;
+#endif
+}
+
+void uwifi_nodes_reduce(struct cc_list_head* global, struct uwifi_ssid_table* ssids,
+			struct cc_list_head* shard)
+{
+	struct uwifi_node *s, *g;
+
+	cc_list_for_each(shard, s, list) {
+		/* nothing new since last time */
+		if (s->pkt_count == 0 && s->rx_pkt_count == 0)
+			continue;
+
+		cc_list_for_each(global, g, list) {
+			if (memcmp(s->wlan_src, g->wlan_src, WLAN_MAC_LEN) == 0)
+				break;
+		}
+		if (&g->list == &global->n) {
+			g = node_new(global);
+			if (g == NULL)
+				return;
+			memcpy(g->wlan_src, s->wlan_src, WLAN_MAC_LEN);
+			g->rx_only = s->rx_only;
+			g->last_seen = s->last_seen;
+			cc_list_add_tail(global, &g->list);
+			LOG_DBG("NODE reduce adding %p " MAC_FMT, g, MAC_PAR(g->wlan_src));
+		}
+
+		uwifi_node_merge(g, ssids, s);
+		node_reset_stats(s);
+		uwifi_nodes_find_ap(g, global);
 	}
 }
@@ -0,0 +1,348 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <string.h>
+
+#include "ssid.h"
+#include "log.h"
+
+/* number of hash buckets, has to be a power of 2 */
+#define SSID_BUCKETS	UWIFI_MAX_SSIDS
+
+static inline struct uwifi_ssid* ssid_entry(struct uwifi_ssid_table* t, uint16_t id)
+{
+	return &t->ssids[id - 1];
+}
+
+static inline void ssid_lock(struct uwifi_ssid_table* t)
+{
+	if (t->lock != NULL)
+		t->lock(t->lock_ctx);
+}
+
+static inline void ssid_unlock(struct uwifi_ssid_table* t)
+{
+	if (t->unlock != NULL)
+		t->unlock(t->lock_ctx);
+}
+
+void uwifi_ssid_table_init(struct uwifi_ssid_table* t)
+{
+	memset(t, 0, sizeof(struct uwifi_ssid_table));
+	for (int i = 0; i < UWIFI_MAX_SSIDS; i++)
+		t->ssids[i].next = i + 2 <= UWIFI_MAX_SSIDS ? i + 2 : 0;
+	t->free = 1;
+}
+
+void uwifi_ssid_table_set_lock(struct uwifi_ssid_table* t, uwifi_ssid_lock_cb lock,
+			       uwifi_ssid_lock_cb unlock, void* ctx)
+{
+	t->lock = lock;
+	t->unlock = unlock;
+	t->lock_ctx = ctx;
+}
+
+static void ssid_unlink(struct uwifi_ssid_table* t, uint16_t id)
+{
+	struct uwifi_ssid* e = ssid_entry(t, id);
+	uint16_t* pp = &t->buckets[e->hash & (SSID_BUCKETS - 1)];
+
+	while (*pp != id)
+		pp = &ssid_entry(t, *pp)->next;
+	*pp = e->next;
+}
+
+/* reuse the next entry without references */
+static uint16_t ssid_reuse(struct uwifi_ssid_table* t)
+{
+	for (int i = 0; i < UWIFI_MAX_SSIDS; i++) {
+		uint16_t id = t->reclaim + 1;
+		t->reclaim = (t->reclaim + 1) % UWIFI_MAX_SSIDS;
+		if (ssid_entry(t, id)->ref == 0) {
+			LOG_DBG("SSID reuse %d '%s'", id, ssid_entry(t, id)->ssid);
+			ssid_unlink(t, id);
+			return id;
+		}
+	}
+	return 0;
+}
+
+/* both are zero padded, so all words can be compared */
+static inline bool ssid_equal(const uint64_t* a, const uint64_t* b)
+{
+	for (int i = 0; i < WLAN_MAX_SSID_LEN / 8; i++)
+		if (a[i] != b[i])
+			return false;
+	return true;
+}
+
+static inline unsigned int ssid_key(uint64_t* key, const void* ssid, unsigned int len)
+{
+	if (len > WLAN_MAX_SSID_LEN)
+		len = WLAN_MAX_SSID_LEN;
+	memset(key, 0, WLAN_MAX_SSID_LEN);
+	memcpy(key, ssid, len);
+	return len;
+}
+
+/* called with lock held */
+static uint16_t ssid_intern(struct uwifi_ssid_table* t, const uint64_t* key,
+			    unsigned int len)
+{
+	struct uwifi_ssid* e;
+	uint32_t h;
+	uint16_t id;
+
+	uint8_t l = len;
+	h = fnv1a(FNV1A_INIT, &l, 1);
+	h = fnv1a(h, key, len);
+
+	for (id = t->buckets[h & (SSID_BUCKETS - 1)]; id != 0; id = e->next) {
+		e = ssid_entry(t, id);
+		if (e->hash == h && e->len == len && ssid_equal(e->words, key))
+			return id;
+	}
+
+	if (t->free != 0) {
+		id = t->free;
+		t->free = ssid_entry(t, id)->next;
+	} else {
+		id = ssid_reuse(t);
+		if (id == 0) {
+			LOG_DBG("SSID table full");
+			return 0;
+		}
+	}
+
+	e = ssid_entry(t, id);
+	memset(e, 0, sizeof(struct uwifi_ssid));
+	e->hash = h;
+	e->len = len;
+	memcpy(e->words, key, WLAN_MAX_SSID_LEN);
+	e->next = t->buckets[h & (SSID_BUCKETS - 1)];
+	t->buckets[h & (SSID_BUCKETS - 1)] = id;
+	return id;
+}
+
+uint16_t uwifi_ssid_intern(struct uwifi_ssid_table* t, const void* ssid,
+			   unsigned int len)
+{
+	uint64_t key[WLAN_MAX_SSID_LEN / 8];
+	uint16_t id;
+
+	if (len == 0)
+		return 0;
+	len = ssid_key(key, ssid, len);
+
+	ssid_lock(t);
+	id = ssid_intern(t, key, len);
+	ssid_unlock(t);
+	return id;
+}
+
+uint16_t uwifi_ssid_hold(struct uwifi_ssid_table* t, uint16_t id,
+			 const void* ssid, unsigned int len)
+{
+	uint64_t key[WLAN_MAX_SSID_LEN / 8];
+	struct uwifi_ssid* e;
+
+	if (len == 0)
+		return 0;
+	len = ssid_key(key, ssid, len);
+
+	ssid_lock(t);
+	e = uwifi_ssid_get(t, id);
+	if (e == NULL || e->len != len || !ssid_equal(e->words, key))
+		id = ssid_intern(t, key, len);
+	if (id != 0)
+		ssid_entry(t, id)->ref++;
+	ssid_unlock(t);
+	return id;
+}
+
+struct uwifi_ssid* uwifi_ssid_get(struct uwifi_ssid_table* t, uint16_t id)
+{
+	if (id == 0 || id > UWIFI_MAX_SSIDS || ssid_entry(t, id)->len == 0)
+		return NULL;
+	return ssid_entry(t, id);
+}
+
+void uwifi_ssid_ref(struct uwifi_ssid_table* t, uint16_t id)
+{
+	ssid_lock(t);
+	struct uwifi_ssid* e = uwifi_ssid_get(t, id);
+	if (e != NULL)
+		e->ref++;
+	ssid_unlock(t);
+}
+
+void uwifi_ssid_unref(struct uwifi_ssid_table* t, uint16_t id)
+{
+	ssid_lock(t);
+	struct uwifi_ssid* e = uwifi_ssid_get(t, id);
+	if (e != NULL && e->ref > 0)
+		e->ref--;
+	ssid_unlock(t);
+}
+
+void uwifi_ssid_count_probe(struct uwifi_ssid_table* t, uint16_t id)
+{
+	ssid_lock(t);
+	struct uwifi_ssid* e = uwifi_ssid_get(t, id);
+	if (e != NULL)
+		e->probes++;
+	ssid_unlock(t);
+}
+
+/*** BSSID to SSID cache ***/
+
+static inline struct uwifi_ssid_bssid* ssid_bssid_entry(struct uwifi_ssid_table* t,
+							const unsigned char* bssid)
+{
+	uint32_t h = fnv1a(FNV1A_INIT, bssid, WLAN_MAC_LEN);
+	return &t->bssids[h & (UWIFI_SSID_CACHE_SIZE - 1)];
+}
+
+void uwifi_ssid_bssid_put(struct uwifi_ssid_table* t, const unsigned char* bssid,
+			  uint16_t id)
+{
+	struct uwifi_ssid_bssid* c;
+	struct uwifi_ssid* e;
+
+	if (id == 0 || MAC_EMPTY(bssid) || MAC_BCAST(bssid))
+		return;
+
+	ssid_lock(t);
+	c = ssid_bssid_entry(t, bssid);
+	if (c->id != id || memcmp(c->bssid, bssid, WLAN_MAC_LEN) != 0) {
+		e = uwifi_ssid_get(t, c->id);
+		if (e != NULL && e->ref > 0)
+			e->ref--;
+		e = uwifi_ssid_get(t, id);
+		if (e != NULL)
+			e->ref++;
+		memcpy(c->bssid, bssid, WLAN_MAC_LEN);
+		c->id = e != NULL ? id : 0;
+	}
+	ssid_unlock(t);
+}
+
+uint16_t uwifi_ssid_bssid_hold(struct uwifi_ssid_table* t, const unsigned char* bssid)
+{
+	struct uwifi_ssid_bssid* c;
+	uint16_t id = 0;
+
+	if (MAC_EMPTY(bssid))
+		return 0;
+
+	ssid_lock(t);
+	c = ssid_bssid_entry(t, bssid);
+	if (c->id != 0 && memcmp(c->bssid, bssid, WLAN_MAC_LEN) == 0) {
+		id = c->id;
+		ssid_entry(t, id)->ref++;
+	}
+	ssid_unlock(t);
+	return id;
+}
+
+/*** sets ***/
+
+bool uwifi_ssid_set_has(const struct uwifi_ssid_set* s, uint16_t id)
+{
+	for (int i = 0; i < s->num; i++)
+		if (s->ids[i] == id)
+			return true;
+	return false;
+}
+
+/* called with lock held */
+static void ssid_set_del(struct uwifi_ssid_table* t, uint16_t id)
+{
+	struct uwifi_ssid* e = uwifi_ssid_get(t, id);
+	if (e == NULL)
+		return;
+	if (e->nodes > 0)
+		e->nodes--;
+	if (e->ref > 0)
+		e->ref--;
+}
+
+bool uwifi_ssid_set_add(struct uwifi_ssid_set* s, struct uwifi_ssid_table* t,
+			uint16_t id)
+{
+	struct uwifi_ssid* e;
+	int i;
+
+	if (s->table != NULL && s->table != t) {
+		LOG_ERR("SSID set of another table");
+		return false;
+	}
+	if (uwifi_ssid_set_has(s, id))
+		return false;
+
+	ssid_lock(t);
+	e = uwifi_ssid_get(t, id);
+	if (e == NULL) {
+		ssid_unlock(t);
+		return false;
+	}
+
+	if (s->num < UWIFI_SSID_SET_SIZE) {
+		i = s->num++;
+	} else {
+		i = s->next;
+		s->next = (s->next + 1) % UWIFI_SSID_SET_SIZE;
+		ssid_set_del(t, s->ids[i]);
+	}
+
+	s->ids[i] = id;
+	s->table = t;
+	e->nodes++;
+	e->ref++;
+	ssid_unlock(t);
+	return true;
+}
+
+void uwifi_ssid_set_merge(struct uwifi_ssid_set* dst, struct uwifi_ssid_table* t,
+			  const struct uwifi_ssid_set* src)
+{
+	if (dst->table != NULL && dst->table != t) {
+		LOG_ERR("SSID set of another table");
+		return;
+	}
+
+	for (int i = 0; i < src->num; i++) {
+		uint16_t id = src->ids[i];
+
+		if (src->table != t) {
+			/* entries in a set are referenced and stay valid */
+			struct uwifi_ssid* e = uwifi_ssid_get(src->table, id);
+			id = e != NULL ? uwifi_ssid_hold(t, 0, e->ssid, e->len) : 0;
+			if (id == 0)
+				continue;
+			uwifi_ssid_set_add(dst, t, id);
+			uwifi_ssid_unref(t, id);
+		} else {
+			uwifi_ssid_set_add(dst, t, id);
+		}
+	}
+}
+
+void uwifi_ssid_set_clear(struct uwifi_ssid_set* s)
+{
+	if (s->table != NULL) {
+		ssid_lock(s->table);
+		for (int i = 0; i < s->num; i++)
+			ssid_set_del(s->table, s->ids[i]);
+		ssid_unlock(s->table);
+	}
+	s->table = NULL;
+	s->num = 0;
+	s->next = 0;
+}
@@ -0,0 +1,736 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <string.h>
+
+#include "telemetry.h"
+#include "node.h"
+#include "essid.h"
+#include "log.h"
+
+/*
+ * Message format (varint is unsigned LEB128, zz is zigzag encoded varint):
+ *
+ *   u8 version, u8 flags, varint seq
+ *   records...
+ *
+ * MAC reference: varint (slot << 1 | define), if define 6 bytes MAC follow
+ *
+ * NODE:	u8 type, MAC ref, varint fields, then for each field bit from
+ *		low to high: PKTS varint, RETRIES varint, SIG zz, SIG_AVG zz,
+ *		SIG_MAX zz, MODE, CHANNEL, STD, WIDTH, FLAGS varint,
+ *		BSSID MAC ref, ESSID varint (slot + 1, 0 for none)
+ * NODE_DEL:	u8 type, varint slot
+ * ESSID:	u8 type, varint slot, if new: u8 len and ESSID,
+ *		varint num_nodes, u8 split
+ * ESSID_DEL:	u8 type, varint slot
+ * CHAN:	u8 type, varint channel, varint num_nodes, varint num_aps
+ */
+
+/* worst case record sizes, a record is only started if it fits */
+#define TELEM_HDR_MAX		(2 + 3)
+#define TELEM_NODE_MAX		(1 + 2 * (5 + WLAN_MAC_LEN) + 2 + 2 * 5 + 3 * 2 + 5 * 5 + 5)
+#define TELEM_ESSID_MAX		(1 + 5 + 1 + WLAN_MAX_SSID_LEN + 3 + 1)
+#define TELEM_DEL_MAX		(1 + 5)
+#define TELEM_CHAN_MAX		(1 + 2 + 3 + 3)
+
+#define TELEM_NODE_FIELDS	12
+
+static unsigned char* put_varint(unsigned char* p, uint32_t v)
+{
+	while (v >= 0x80) {
+		*p++ = (v & 0x7f) | 0x80;
+		v >>= 7;
+	}
+	*p++ = v;
+	return p;
+}
+
+static inline uint32_t zigzag(int32_t v)
+{
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v)
+{
+	return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static const unsigned char* get_varint(const unsigned char* p,
+				       const unsigned char* end, uint32_t* v)
+{
+	*v = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (p >= end)
+			return NULL;
+		*v |= (uint32_t)(*p & 0x7f) << shift;
+		if (!(*p++ & 0x80))
+			return p;
+	}
+	return NULL;
+}
+
+/*** encoder ***/
+
+void uwifi_telem_enc_init(struct uwifi_telem_enc* enc)
+{
+	memset(enc, 0, sizeof(struct uwifi_telem_enc));
+	enc->reset = true;
+}
+
+void uwifi_telem_enc_reset(struct uwifi_telem_enc* enc)
+{
+	enc->reset = true;
+}
+
+static int enc_find_mac(struct uwifi_telem_enc* enc, const unsigned char* mac)
+{
+	for (int i = 0; i < UWIFI_TELEM_MAX_MACS; i++)
+		if (enc->macs[i].used &&
+		    memcmp(enc->macs[i].mac, mac, WLAN_MAC_LEN) == 0)
+			return i;
+	return -1;
+}
+
+/* find a free slot or reuse the next one round-robin, but not @keep */
+static int enc_new_mac(struct uwifi_telem_enc* enc, const unsigned char* mac,
+		       int keep)
+{
+	int i;
+
+	for (i = 0; i < UWIFI_TELEM_MAX_MACS; i++)
+		if (!enc->macs[i].used)
+			break;
+	while (i == UWIFI_TELEM_MAX_MACS || i == keep) {
+		i = enc->next_mac;
+		enc->next_mac = (enc->next_mac + 1) % UWIFI_TELEM_MAX_MACS;
+	}
+
+	memset(&enc->macs[i], 0, sizeof(struct uwifi_telem_mac_slot));
+	memcpy(enc->macs[i].mac, mac, WLAN_MAC_LEN);
+	enc->macs[i].used = true;
+	return i;
+}
+
+/* @slot: in: slot which must not be replaced or -1, out: slot used */
+static unsigned char* put_mac_ref(struct uwifi_telem_enc* enc, unsigned char* p,
+				  const unsigned char* mac, int* slot)
+{
+	int i = enc_find_mac(enc, mac);
+	if (i >= 0) {
+		p = put_varint(p, i << 1);
+	} else {
+		i = enc_new_mac(enc, mac, *slot);
+		p = put_varint(p, (i << 1) | 1);
+		memcpy(p, mac, WLAN_MAC_LEN);
+		p += WLAN_MAC_LEN;
+	}
+	*slot = i;
+	return p;
+}
+
+static int enc_find_essid(struct uwifi_telem_enc* enc, const struct uwifi_ssid* s)
+{
+	for (int i = 0; i < UWIFI_TELEM_MAX_ESSIDS; i++)
+		if (enc->essids[i].used &&
+		    enc->essids[i].last.essid_len == s->len &&
+		    memcmp(enc->essids[i].last.essid, s->ssid, s->len) == 0)
+			return i;
+	return -1;
+}
+
+static unsigned char* enc_essid(struct uwifi_telem_enc* enc, unsigned char* p,
+				struct essid_info* e)
+{
+	bool new = false;
+	const struct uwifi_ssid* ssid = uwifi_essid_ssid(e);
+	int i = enc_find_essid(enc, ssid);
+
+	if (i < 0) {
+		for (i = 0; i < UWIFI_TELEM_MAX_ESSIDS; i++)
+			if (!enc->essids[i].used)
+				break;
+		if (i == UWIFI_TELEM_MAX_ESSIDS) {
+			i = enc->next_essid;
+			enc->next_essid = (enc->next_essid + 1) % UWIFI_TELEM_MAX_ESSIDS;
+		}
+		memset(&enc->essids[i], 0, sizeof(struct uwifi_telem_essid_slot));
+		memcpy(enc->essids[i].last.essid, ssid->ssid, ssid->len);
+		enc->essids[i].last.essid_len = ssid->len;
+		enc->essids[i].used = true;
+		new = true;
+	}
+
+	struct uwifi_telem_essid_slot* s = &enc->essids[i];
+	if (!new && s->last.num_nodes == e->num_nodes && s->last.split == (e->split > 0))
+		return p;
+
+	s->last.num_nodes = e->num_nodes;
+	s->last.split = e->split > 0;
+
+	*p++ = UWIFI_TELEM_ESSID | (new ? UWIFI_TELEM_REC_NEW : 0);
+	p = put_varint(p, i);
+	if (new) {
+		*p++ = s->last.essid_len;
+		memcpy(p, s->last.essid, s->last.essid_len);
+		p += s->last.essid_len;
+	}
+	p = put_varint(p, s->last.num_nodes);
+	*p++ = s->last.split;
+	return p;
+}
+
+static void enc_node_values(struct uwifi_telem_enc* enc, struct uwifi_node* n,
+			    struct uwifi_telem_node* v)
+{
+	memset(v, 0, sizeof(struct uwifi_telem_node));
+	v->sig = n->phy_sig_last;
+	v->sig_avg = -(int)ewma_read(&n->phy_sig_avg);
+	v->sig_max = n->phy_sig_max;
+	v->mode = n->wlan_mode;
+	v->channel = n->wlan_channel;
+	v->std = n->wlan_std;
+	v->width = n->wlan_chan_width;
+	v->flags = (n->wlan_wep ? UWIFI_TELEM_NF_WEP : 0) |
+		   (n->wlan_wpa ? UWIFI_TELEM_NF_WPA : 0) |
+		   (n->wlan_rsn ? UWIFI_TELEM_NF_RSN : 0) |
+		   (n->wlan_ht40plus ? UWIFI_TELEM_NF_HT40PLUS : 0) |
+		   (n->rx_only ? UWIFI_TELEM_NF_RX_ONLY : 0);
+	memcpy(v->bssid, n->wlan_bssid, WLAN_MAC_LEN);
+	v->essid = n->essid ? enc_find_essid(enc, uwifi_essid_ssid(n->essid)) : -1;
+}
+
+static uint32_t enc_node_fields(const struct uwifi_telem_node* v,
+				const struct uwifi_telem_node* o)
+{
+	uint32_t f = 0;
+	if (v->pkts)			f |= UWIFI_TELEM_F_PKTS;
+	if (v->retries)			f |= UWIFI_TELEM_F_RETRIES;
+	if (v->sig != o->sig)		f |= UWIFI_TELEM_F_SIG;
+	if (v->sig_avg != o->sig_avg)	f |= UWIFI_TELEM_F_SIG_AVG;
+	if (v->sig_max != o->sig_max)	f |= UWIFI_TELEM_F_SIG_MAX;
+	if (v->mode != o->mode)		f |= UWIFI_TELEM_F_MODE;
+	if (v->channel != o->channel)	f |= UWIFI_TELEM_F_CHANNEL;
+	if (v->std != o->std)		f |= UWIFI_TELEM_F_STD;
+	if (v->width != o->width)	f |= UWIFI_TELEM_F_WIDTH;
+	if (v->flags != o->flags)	f |= UWIFI_TELEM_F_FLAGS;
+	if (memcmp(v->bssid, o->bssid, WLAN_MAC_LEN) != 0)
+		f |= UWIFI_TELEM_F_BSSID;
+	if (v->essid != o->essid)	f |= UWIFI_TELEM_F_ESSID;
+	return f;
+}
+
+static unsigned char* enc_node(struct uwifi_telem_enc* enc, unsigned char* p,
+			       struct uwifi_node* n)
+{
+	static const struct uwifi_telem_node empty = { .essid = -1 };
+	struct uwifi_telem_node v;
+	int i = enc_find_mac(enc, n->wlan_src);
+	bool new = i < 0 || !enc->macs[i].is_node;
+
+	/* node was removed and added again in between */
+	if (!new && (n->pkt_count < enc->macs[i].pkt_count ||
+		     n->wlan_retries_all < enc->macs[i].retries_all))
+		new = true;
+
+	enc_node_values(enc, n, &v);
+	if (new) {
+		v.pkts = n->pkt_count;
+		v.retries = n->wlan_retries_all;
+	} else {
+		v.pkts = (uint32_t)n->pkt_count - enc->macs[i].pkt_count;
+		v.retries = (uint32_t)n->wlan_retries_all - enc->macs[i].retries_all;
+	}
+
+	uint32_t fields = enc_node_fields(&v, new ? &empty : &enc->macs[i].last);
+	if (!new && fields == 0)
+		return p;
+
+	*p++ = UWIFI_TELEM_NODE | (new ? UWIFI_TELEM_REC_NEW : 0);
+	i = -1;
+	p = put_mac_ref(enc, p, n->wlan_src, &i);
+	p = put_varint(p, fields);
+
+	if (fields & UWIFI_TELEM_F_PKTS)
+		p = put_varint(p, v.pkts);
+	if (fields & UWIFI_TELEM_F_RETRIES)
+		p = put_varint(p, v.retries);
+	if (fields & UWIFI_TELEM_F_SIG)
+		p = put_varint(p, zigzag(v.sig));
+	if (fields & UWIFI_TELEM_F_SIG_AVG)
+		p = put_varint(p, zigzag(v.sig_avg));
+	if (fields & UWIFI_TELEM_F_SIG_MAX)
+		p = put_varint(p, zigzag(v.sig_max));
+	if (fields & UWIFI_TELEM_F_MODE)
+		p = put_varint(p, v.mode);
+	if (fields & UWIFI_TELEM_F_CHANNEL)
+		p = put_varint(p, v.channel);
+	if (fields & UWIFI_TELEM_F_STD)
+		p = put_varint(p, v.std);
+	if (fields & UWIFI_TELEM_F_WIDTH)
+		p = put_varint(p, v.width);
+	if (fields & UWIFI_TELEM_F_FLAGS)
+		p = put_varint(p, v.flags);
+	if (fields & UWIFI_TELEM_F_BSSID) {
+		int bslot = i;	/* don't replace our own slot */
+		p = put_mac_ref(enc, p, v.bssid, &bslot);
+	}
+	if (fields & UWIFI_TELEM_F_ESSID)
+		p = put_varint(p, v.essid + 1);
+
+	struct uwifi_telem_mac_slot* s = &enc->macs[i];
+	s->is_node = true;
+	s->last = v;
+	s->pkt_count = n->pkt_count;
+	s->retries_all = n->wlan_retries_all;
+	return p;
+}
+
+static int enc_count_chans(struct cc_list_head* nodes, struct uwifi_telem_chan* ch)
+{
+	struct uwifi_node* n;
+	int num = 0;
+
+	cc_list_for_each(nodes, n, list) {
+		int i;
+		if (n->wlan_channel == 0)
+			continue;
+		for (i = 0; i < num; i++)
+			if (ch[i].channel == n->wlan_channel)
+				break;
+		if (i == num) {
+			if (num == UWIFI_TELEM_MAX_CHANS)
+				continue;
+			ch[num].channel = n->wlan_channel;
+			ch[num].num_nodes = ch[num].num_aps = 0;
+			num++;
+		}
+		ch[i].num_nodes++;
+		if (n->wlan_mode & WLAN_MODE_AP)
+			ch[i].num_aps++;
+	}
+	return num;
+}
+
+static unsigned char* put_chan(unsigned char* p, const struct uwifi_telem_chan* c)
+{
+	*p++ = UWIFI_TELEM_CHAN;
+	p = put_varint(p, c->channel);
+	p = put_varint(p, c->num_nodes);
+	p = put_varint(p, c->num_aps);
+	return p;
+}
+
+/* send changed and new channels, then channels which have no nodes anymore */
+static unsigned char* enc_chans(struct uwifi_telem_enc* enc, unsigned char* p,
+				const unsigned char* end, struct cc_list_head* nodes,
+				bool* more)
+{
+	struct uwifi_telem_chan ch[UWIFI_TELEM_MAX_CHANS];
+	int num = enc_count_chans(nodes, ch);
+	int i, j;
+
+	for (i = 0; i < num; i++) {
+		for (j = 0; j < enc->num_chans; j++)
+			if (enc->chans[j].channel == ch[i].channel)
+				break;
+		if (j < enc->num_chans &&
+		    enc->chans[j].num_nodes == ch[i].num_nodes &&
+		    enc->chans[j].num_aps == ch[i].num_aps)
+			continue;
+		if (j == enc->num_chans && j == UWIFI_TELEM_MAX_CHANS)
+			continue;
+		if (end - p < TELEM_CHAN_MAX) {
+			*more = true;
+			return p;
+		}
+		p = put_chan(p, &ch[i]);
+		enc->chans[j] = ch[i];
+		if (j == enc->num_chans)
+			enc->num_chans++;
+	}
+
+	for (j = 0; j < enc->num_chans; j++) {
+		for (i = 0; i < num; i++)
+			if (enc->chans[j].channel == ch[i].channel)
+				break;
+		if (i < num)
+			continue;
+		if (end - p < TELEM_CHAN_MAX) {
+			*more = true;
+			return p;
+		}
+		enc->chans[j].num_nodes = enc->chans[j].num_aps = 0;
+		p = put_chan(p, &enc->chans[j]);
+		enc->chans[j--] = enc->chans[--enc->num_chans];
+	}
+	return p;
+}
+
+int uwifi_telem_encode(struct uwifi_telem_enc* enc, struct cc_list_head* nodes,
+		       struct cc_list_head* essids, unsigned char* buf, size_t len)
+{
+	const unsigned char* end = buf + len;
+	unsigned char* p = buf;
+	struct uwifi_node* n;
+	struct essid_info* e;
+	bool more = false;
+	int i;
+
+	if (len < TELEM_HDR_MAX + TELEM_NODE_MAX)
+		return -1;
+
+	if (enc->reset) {
+		/* start over with empty dictionaries */
+		memset(enc->macs, 0, sizeof(enc->macs));
+		memset(enc->essids, 0, sizeof(enc->essids));
+		enc->next_mac = enc->next_essid = 0;
+		enc->num_chans = 0;
+	}
+
+	*p++ = UWIFI_TELEM_VERSION;
+	*p++ = enc->reset ? UWIFI_TELEM_FLAG_RESET : 0;
+	p = put_varint(p, enc->seq++);
+	enc->reset = false;
+
+	/* mark what still exists and delete the rest first, so the slots of
+	 * removed nodes and ESSIDs are free again for the new ones */
+	for (i = 0; i < UWIFI_TELEM_MAX_MACS; i++)
+		enc->macs[i].seen = false;
+	for (i = 0; i < UWIFI_TELEM_MAX_ESSIDS; i++)
+		enc->essids[i].seen = false;
+	cc_list_for_each(nodes, n, list) {
+		i = enc_find_mac(enc, n->wlan_src);
+		if (i >= 0)
+			enc->macs[i].seen = true;
+	}
+	if (essids != NULL) {
+		cc_list_for_each(essids, e, list) {
+			i = enc_find_essid(enc, uwifi_essid_ssid(e));
+			if (i >= 0)
+				enc->essids[i].seen = true;
+		}
+	}
+
+	for (i = 0; i < UWIFI_TELEM_MAX_MACS; i++) {
+		struct uwifi_telem_mac_slot* s = &enc->macs[i];
+		if (!s->is_node || s->seen)
+			continue;
+		if (end - p < TELEM_DEL_MAX) {
+			more = true;
+			goto out;
+		}
+		*p++ = UWIFI_TELEM_NODE_DEL;
+		p = put_varint(p, i);
+		s->is_node = false;
+		s->used = false;
+	}
+
+	for (i = 0; essids != NULL && i < UWIFI_TELEM_MAX_ESSIDS; i++) {
+		struct uwifi_telem_essid_slot* s = &enc->essids[i];
+		if (!s->used || s->seen)
+			continue;
+		if (end - p < TELEM_DEL_MAX) {
+			more = true;
+			goto out;
+		}
+		*p++ = UWIFI_TELEM_ESSID_DEL;
+		p = put_varint(p, i);
+		s->used = false;
+	}
+
+	/* ESSIDs first, nodes refer to them */
+	if (essids != NULL) {
+		cc_list_for_each(essids, e, list) {
+			if (end - p < TELEM_ESSID_MAX) {
+				more = true;
+				break;
+			}
+			p = enc_essid(enc, p, e);
+		}
+	}
+
+	cc_list_for_each(nodes, n, list) {
+		if (end - p < TELEM_NODE_MAX) {
+			more = true;
+			break;
+		}
+		p = enc_node(enc, p, n);
+	}
+
+	if (!more)
+		p = enc_chans(enc, p, end, nodes, &more);
+
+out:
+	if (more)
+		buf[1] |= UWIFI_TELEM_FLAG_MORE;
+	return p - buf;
+}
+
+/*** decoder ***/
+
+void uwifi_telem_dec_init(struct uwifi_telem_dec* dec)
+{
+	memset(dec, 0, sizeof(struct uwifi_telem_dec));
+}
+
+/* the channels the application knows about */
+static void dec_chan(struct uwifi_telem_dec* dec, const struct uwifi_telem_chan* c)
+{
+	int i;
+
+	for (i = 0; i < dec->num_chans; i++)
+		if (dec->chans[i] == c->channel)
+			break;
+	if (c->num_nodes == 0 && c->num_aps == 0) {
+		if (i < dec->num_chans)
+			dec->chans[i] = dec->chans[--dec->num_chans];
+	} else if (i == dec->num_chans && i < UWIFI_TELEM_MAX_CHANS) {
+		dec->chans[dec->num_chans++] = c->channel;
+	}
+}
+
+/* before a full state: the application forgets everything it was told */
+static void dec_clear(struct uwifi_telem_dec* dec, uwifi_telem_cb cb, void* ctx)
+{
+	struct uwifi_telem_rec r;
+	int i;
+
+	for (i = 0; i < UWIFI_TELEM_MAX_MACS; i++) {
+		if (!dec->mac_is_node[i])
+			continue;
+		memset(&r, 0, sizeof(r));
+		r.type = UWIFI_TELEM_NODE_DEL;
+		r.slot = i;
+		r.mac = dec->macs[i];
+		cb(&r, ctx);
+	}
+	for (i = 0; i < UWIFI_TELEM_MAX_ESSIDS; i++) {
+		if (!dec->essid_is_set[i])
+			continue;
+		memset(&r, 0, sizeof(r));
+		r.type = UWIFI_TELEM_ESSID_DEL;
+		r.slot = i;
+		cb(&r, ctx);
+	}
+	for (i = 0; i < dec->num_chans; i++) {
+		memset(&r, 0, sizeof(r));
+		r.type = UWIFI_TELEM_CHAN;
+		r.chan.channel = dec->chans[i];
+		cb(&r, ctx);
+	}
+
+	memset(dec->mac_valid, 0, sizeof(dec->mac_valid));
+	memset(dec->mac_is_node, 0, sizeof(dec->mac_is_node));
+	memset(dec->essid_valid, 0, sizeof(dec->essid_valid));
+	memset(dec->essid_is_set, 0, sizeof(dec->essid_is_set));
+	dec->num_chans = 0;
+}
+
+static const unsigned char* get_mac_ref(struct uwifi_telem_dec* dec,
+					const unsigned char* p,
+					const unsigned char* end, int* slot,
+					bool* valid, uwifi_telem_cb cb, void* ctx)
+{
+	uint32_t v;
+
+	p = get_varint(p, end, &v);
+	if (p == NULL || (v >> 1) >= UWIFI_TELEM_MAX_MACS)
+		return NULL;
+
+	*slot = v >> 1;
+	if (v & 1) {
+		if (end - p < WLAN_MAC_LEN)
+			return NULL;
+		if (dec->mac_is_node[*slot]) {
+			/* slot reused: old node is gone */
+			struct uwifi_telem_rec del = {
+				.type = UWIFI_TELEM_NODE_DEL,
+				.slot = *slot,
+				.mac = dec->macs[*slot],
+			};
+			cb(&del, ctx);
+			dec->mac_is_node[*slot] = false;
+		}
+		memcpy(dec->macs[*slot], p, WLAN_MAC_LEN);
+		dec->mac_valid[*slot] = true;
+		p += WLAN_MAC_LEN;
+	}
+	*valid = dec->mac_valid[*slot];
+	return p;
+}
+
+static const unsigned char* dec_node(struct uwifi_telem_dec* dec,
+				     const unsigned char* p,
+				     const unsigned char* end,
+				     struct uwifi_telem_rec* r,
+				     uwifi_telem_cb cb, void* ctx)
+{
+	uint32_t v;
+	bool valid, bvalid;
+	int bslot;
+
+	p = get_mac_ref(dec, p, end, &r->slot, &valid, cb, ctx);
+	if (p == NULL)
+		return NULL;
+	p = get_varint(p, end, &r->fields);
+	if (p == NULL)
+		return NULL;
+
+	r->node.essid = -1;
+	for (int f = 0; f < TELEM_NODE_FIELDS; f++) {
+		if (!(r->fields & BIT(f)))
+			continue;
+		if (BIT(f) == UWIFI_TELEM_F_BSSID) {
+			p = get_mac_ref(dec, p, end, &bslot, &bvalid, cb, ctx);
+			if (p == NULL)
+				return NULL;
+			if (bvalid)
+				memcpy(r->node.bssid, dec->macs[bslot], WLAN_MAC_LEN);
+			else
+				r->fields &= ~UWIFI_TELEM_F_BSSID;
+			continue;
+		}
+		p = get_varint(p, end, &v);
+		if (p == NULL)
+			return NULL;
+		switch (BIT(f)) {
+		case UWIFI_TELEM_F_PKTS:	r->node.pkts = v; break;
+		case UWIFI_TELEM_F_RETRIES:	r->node.retries = v; break;
+		case UWIFI_TELEM_F_SIG:		r->node.sig = unzigzag(v); break;
+		case UWIFI_TELEM_F_SIG_AVG:	r->node.sig_avg = unzigzag(v); break;
+		case UWIFI_TELEM_F_SIG_MAX:	r->node.sig_max = unzigzag(v); break;
+		case UWIFI_TELEM_F_MODE:	r->node.mode = v; break;
+		case UWIFI_TELEM_F_CHANNEL:	r->node.channel = v; break;
+		case UWIFI_TELEM_F_STD:		r->node.std = v; break;
+		case UWIFI_TELEM_F_WIDTH:	r->node.width = v; break;
+		case UWIFI_TELEM_F_FLAGS:	r->node.flags = v; break;
+		case UWIFI_TELEM_F_ESSID:	r->node.essid = (int)v - 1; break;
+		}
+	}
+
+	/* unknown after lost messages */
+	if (!valid || (!r->is_new && !dec->mac_is_node[r->slot]))
+		return p;
+
+	dec->mac_is_node[r->slot] = true;
+	r->mac = dec->macs[r->slot];
+	cb(r, ctx);
+	return p;
+}
+
+int uwifi_telem_decode(struct uwifi_telem_dec* dec, const unsigned char* buf,
+		       size_t len, uwifi_telem_cb cb, void* ctx)
+{
+	const unsigned char* end = buf + len;
+	const unsigned char* p = buf;
+	uint32_t v, seq;
+	int flags;
+
+	if (len < 3 || buf[0] != UWIFI_TELEM_VERSION)
+		return -1;
+
+	flags = buf[1];
+	p = get_varint(buf + 2, end, &seq);
+	if (p == NULL)
+		return -1;
+
+	if (flags & UWIFI_TELEM_FLAG_RESET) {
+		dec_clear(dec, cb, ctx);
+	} else if (dec->synced && (uint16_t)seq != (uint16_t)(dec->seq + 1)) {
+		LOG_DBG("TELEM lost %d messages", (uint16_t)(seq - dec->seq - 1));
+		dec->lost += (uint16_t)(seq - dec->seq - 1);
+		/* we may have missed slot redefinitions and changes, but keep
+		 * what the application knows for deletions and the next reset */
+		memset(dec->mac_valid, 0, sizeof(dec->mac_valid));
+		memset(dec->essid_valid, 0, sizeof(dec->essid_valid));
+	}
+	dec->seq = seq;
+	dec->synced = true;
+
+	while (p < end) {
+		struct uwifi_telem_rec r;
+		memset(&r, 0, sizeof(r));
+		r.type = *p & ~UWIFI_TELEM_REC_NEW;
+		r.is_new = *p & UWIFI_TELEM_REC_NEW;
+		p++;
+
+		switch (r.type) {
+		case UWIFI_TELEM_NODE:
+			p = dec_node(dec, p, end, &r, cb, ctx);
+			break;
+		case UWIFI_TELEM_NODE_DEL:
+			p = get_varint(p, end, &v);
+			if (p == NULL || v >= UWIFI_TELEM_MAX_MACS)
+				return -1;
+			if (!dec->mac_is_node[v])
+				break;
+			r.slot = v;
+			r.mac = dec->macs[v];
+			dec->mac_is_node[v] = false;
+			cb(&r, ctx);
+			break;
+		case UWIFI_TELEM_ESSID:
+			p = get_varint(p, end, &v);
+			if (p == NULL || v >= UWIFI_TELEM_MAX_ESSIDS)
+				return -1;
+			r.slot = v;
+			if (r.is_new) {
+				if (p >= end || *p > WLAN_MAX_SSID_LEN || end - p < 1 + *p)
+					return -1;
+				memcpy(r.essid.essid, p + 1, *p);
+				r.essid.essid_len = *p;
+				p += 1 + *p;
+				dec->essid_valid[v] = true;
+			}
+			p = get_varint(p, end, &v);
+			if (p == NULL || p >= end)
+				return -1;
+			r.essid.num_nodes = v;
+			r.essid.split = *p++;
+			if (dec->essid_valid[r.slot]) {
+				dec->essid_is_set[r.slot] = true;
+				cb(&r, ctx);
+			}
+			break;
+		case UWIFI_TELEM_ESSID_DEL:
+			p = get_varint(p, end, &v);
+			if (p == NULL || v >= UWIFI_TELEM_MAX_ESSIDS)
+				return -1;
+			dec->essid_valid[v] = false;
+			if (!dec->essid_is_set[v])
+				break;
+			r.slot = v;
+			dec->essid_is_set[v] = false;
+			cb(&r, ctx);
+			break;
+		case UWIFI_TELEM_CHAN:
+			p = get_varint(p, end, &v);
+			if (p != NULL) {
+				r.chan.channel = v;
+				p = get_varint(p, end, &v);
+			}
+			if (p != NULL) {
+				r.chan.num_nodes = v;
+				p = get_varint(p, end, &v);
+			}
+			if (p == NULL)
+				return -1;
+			r.chan.num_aps = v;
+			dec_chan(dec, &r.chan);
+			cb(&r, ctx);
+			break;
+		default:
+			return -1;
+		}
+		if (p == NULL)
+			return -1;
+	}
+	return flags;
+}
@@ -0,0 +1,108 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <string.h>
+
+#include "timestamp.h"
+#include "log.h"
+
+/*
+ * The TSF is latched by the hardware when the frame is received, while the
+ * kernel timestamp is taken some variable time later, depending on interrupt
+ * and softirq latency. The delay can only make the host time later, never
+ * earlier, so the lower envelope of (host - TSF) is the best estimate of the
+ * real offset. We take the minimum offset per window of TSF time and fit a
+ * line thru consecutive minima to track the drift between the two clocks.
+ */
+
+#define TSF_MAP_WINDOW		1000000		/* usec of TSF per window */
+#define TSF_MAP_MAX_JUMP	1000000000LL	/* nsec, reset mapping beyond */
+
+void uwifi_tsf_map_reset(struct uwifi_tsf_map* m)
+{
+	memset(m, 0, sizeof(struct uwifi_tsf_map));
+}
+
+static int64_t tsf_map_predict(const struct uwifi_tsf_map* m, uint64_t tsf)
+{
+	return m->off_ref + ((int64_t)(tsf - m->tsf_ref) * m->drift_ppb) / 1000000;
+}
+
+static void tsf_map_start(struct uwifi_tsf_map* m, uint64_t tsf, int64_t off)
+{
+	m->tsf_ref = m->win_start = m->win_tsf = tsf;
+	m->off_ref = m->win_off = off;
+	m->drift_ppb = 0;
+	m->num_windows = 0;
+	m->valid = true;
+}
+
+void uwifi_tsf_map_update(struct uwifi_tsf_map* m, uint64_t tsf, uint64_t host_ns)
+{
+	int64_t off = (int64_t)host_ns - (int64_t)(tsf * 1000);
+
+	if (!m->valid || tsf < m->last_tsf) {
+		/* first sample or TSF was reset */
+		tsf_map_start(m, tsf, off);
+		m->last_tsf = tsf;
+		return;
+	}
+
+	int64_t err = off - tsf_map_predict(m, tsf);
+	if (err > TSF_MAP_MAX_JUMP || err < -TSF_MAP_MAX_JUMP) {
+		LOG_DBG("TSF map: jump of %lld ns, reset", (long long)err);
+		tsf_map_start(m, tsf, off);
+		m->last_tsf = tsf;
+		return;
+	}
+
+	m->last_tsf = tsf;
+
+	if (off < m->win_off) {
+		m->win_off = off;
+		m->win_tsf = tsf;
+	}
+
+	if (tsf - m->win_start < TSF_MAP_WINDOW)
+		return;
+
+	/* window closed: its minimum is the new reference point and the drift
+	 * is the slope from the previous one */
+	if (m->num_windows > 0 && m->win_tsf - m->tsf_ref >= TSF_MAP_WINDOW / 2) {
+		int64_t ppb = ((m->win_off - m->off_ref) * 1000000) /
+				(int64_t)(m->win_tsf - m->tsf_ref);
+		if (m->num_windows == 1)
+			m->drift_ppb = ppb;
+		else
+			m->drift_ppb = (3 * (int64_t)m->drift_ppb + ppb) / 4;
+	}
+	m->num_windows++;
+
+	m->tsf_ref = m->win_tsf;
+	m->off_ref = m->win_off;
+	m->win_start = m->win_tsf = tsf;
+	m->win_off = off;
+}
+
+/* return estimated host time (nsec) for TSF (usec) */
+uint64_t uwifi_tsf_map_to_host(const struct uwifi_tsf_map* m, uint64_t tsf)
+{
+	if (!m->valid)
+		return 0;
+
+	int64_t off = tsf_map_predict(m, tsf);
+
+	/* the current window may already have seen a smaller offset than
+	 * predicted, which means the line is too late */
+	int64_t corr = m->win_off - tsf_map_predict(m, m->win_tsf);
+	if (corr < 0)
+		off += corr;
+
+	return tsf * 1000 + off;
+}
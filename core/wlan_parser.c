@@ -17,24 +17,64 @@
 #include "channel.h"
 #include "wlan_util.h"
 #include "wlan_parser.h"
+#include "ssid.h"
 #include "log.h"
+#include "trace.h"
 
-void uwifi_parse_information_elements(unsigned char* buf, size_t bufLen, struct uwifi_packet *p)
+/*
+ * Probe request fingerprint: the order of IEs and the contents of the ones
+ * which describe the capabilities of a device and don't change with a
+ * randomized MAC. For vendor IEs only OUI and type, as e.g. WPS contains a
+ * UUID.
+ */
+static uint32_t fingerprint_ie(uint32_t h, struct information_element* ie, int len)
+{
+	h = fnv1a(h, &ie->id, 1);
+	switch (ie->id) {
+	case WLAN_IE_ID_SUPP_RATES:
+	case WLAN_IE_ID_EXT_SUPP_RATES:
+	case WLAN_IE_ID_HT_CAPAB:
+	case WLAN_IE_ID_VHT_CAPAB:
+	case WLAN_IE_ID_EXT_CAPAB:
+	case WLAN_IE_ID_EXTENSION:
+		h = fnv1a(h, ie->var, MIN(ie->len, len));
+		break;
+	case WLAN_IE_ID_VENDOR:
+		h = fnv1a(h, ie->var, MIN(MIN(ie->len, len), 4));
+		break;
+	}
+	return h;
+}
+
+void uwifi_parse_information_elements(unsigned char* buf, size_t bufLen, struct uwifi_packet *p,
+				      struct uwifi_ssid_table* ssids)
 {
 	int len = bufLen;
+	bool probe = p->wlan_type == WLAN_FRAME_PROBE_REQ;
+	uint32_t fp = FNV1A_INIT;
+	int i;
+
 	while (len > 2) {
 		struct information_element* ie = (struct information_element*)buf;
 		//LOG_DBG("WLAN: IE: %d len %d t len %d", ie->id, ie->len, len);
 
+		if (probe)
+			fp = fingerprint_ie(fp, ie, len - 2);
+
 		switch (ie->id) {
 		case WLAN_IE_ID_SSID:
-			if (ie->len < WLAN_MAX_SSID_LEN-1) {
-				memcpy(p->wlan_essid, ie->var, ie->len);
-				p->wlan_essid[ie->len] = '\0';
-			} else {
-				memcpy(p->wlan_essid, ie->var, WLAN_MAX_SSID_LEN-1);
-				p->wlan_essid[WLAN_MAX_SSID_LEN-1] = '\0';
-			}
+			/* no copy, the packet points into the frame */
+			p->wlan_essid = ie->var;
+			p->wlan_essid_len = MIN(MIN(ie->len, len - 2), WLAN_MAX_SSID_LEN);
+			/* hidden SSIDs may be zeroed instead of empty, other
+			 * SSIDs may contain NUL */
+			for (i = 0; i < p->wlan_essid_len && ie->var[i] == '\0'; i++)
+				;
+			if (i == p->wlan_essid_len)
+				p->wlan_essid_len = 0;
+			if (ssids != NULL)
+				p->wlan_essid_id = uwifi_ssid_intern(ssids, p->wlan_essid,
+								     p->wlan_essid_len);
 			break;
 
 		case WLAN_IE_ID_DSSS_PARAM:
@@ -53,7 +93,7 @@ void uwifi_parse_information_elements(unsigned char* buf, size_t bufLen, struct
 
 			if (ie->len >= 26) {
 				wlan_ht_streams_from_mcs(&ie->var[3], &p->wlan_rx_streams, &p->wlan_tx_streams);
-				LOG_DBG("WLAN: IE: STREAMS %dx%d", p->wlan_tx_streams, p->wlan_rx_streams);
+				UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: IE: STREAMS %dx%d", p->wlan_tx_streams, p->wlan_rx_streams);
 			}
 			break;
 
@@ -63,7 +103,7 @@ void uwifi_parse_information_elements(unsigned char* buf, size_t bufLen, struct
 					case 0: p->wlan_chan_width = CHAN_WIDTH_20; break;
 					case 1: p->wlan_ht40plus = true; break;
 					case 3: p->wlan_ht40plus = false; break;
-					default: LOG_DBG("WLAN: IE: HT OPER wrong?"); break;
+					default: UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: IE: HT OPER wrong?"); break;
 				}
 			}
 			break;
@@ -77,7 +117,7 @@ void uwifi_parse_information_elements(unsigned char* buf, size_t bufLen, struct
 			if (ie->len >= 12) {
 				p->wlan_chan_width = wlan_chan_width_from_vht_capab(ie->var[0]);
 				wlan_vht_streams_from_mcs(&ie->var[4], &p->wlan_rx_streams, &p->wlan_tx_streams);
-				LOG_DBG("WLAN: IE: VHT STREAMS %dx%d", p->wlan_tx_streams, p->wlan_rx_streams);
+				UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: IE: VHT STREAMS %dx%d", p->wlan_tx_streams, p->wlan_rx_streams);
 			}
 			break;
 
@@ -94,10 +134,14 @@ void uwifi_parse_information_elements(unsigned char* buf, size_t bufLen, struct
 		buf += ie->len + 2;
 		len -= ie->len + 2;
 	}
+
+	if (probe)	/* 0 means none */
+		p->wlan_fingerprint = fp ? fp : 1;
 }
 
 /* return consumed length, 0 for stop parsing, or -1 on error */
-int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet* p)
+int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet* p,
+			     struct uwifi_ssid_table* ssids)
 {
 	struct wlan_frame* wh = (struct wlan_frame*)buf;
 	uint16_t fc = le16toh(wh->fc);
@@ -106,7 +150,7 @@ int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet
 	uint8_t* ta = NULL;
 	uint8_t* bssid = NULL;
 
-	LOG_DBG("WLAN: LEN %zd", len);
+	UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: LEN %d", (int)len);
 
 	if (len < 10) /* minimum frame size (CTS/ACK) */
 		return -1;
@@ -114,12 +158,12 @@ int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet
 	p->wlan_mode = WLAN_MODE_UNKNOWN;
 	p->wlan_type = (fc & WLAN_FRAME_FC_MASK);
 
-	LOG_DBG("WLAN: %s FC %x type %x stype %x",
-		wlan_get_packet_type_name(fc), fc,
+	UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: %c FC %x type %x stype %x",
+		wlan_get_packet_type_char(fc), fc,
 		fc & WLAN_FRAME_FC_TYPE_MASK, fc & WLAN_FRAME_FC_STYPE_MASK);
 
 	if (WLAN_FRAME_IS_DATA(fc)) {
-		LOG_DBG("WLAN: DATA FromDS %d ToDS %d",
+		UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: DATA FromDS %d ToDS %d",
 			(fc & WLAN_FRAME_FC_FROM_DS) != 0,
 			(fc & WLAN_FRAME_FC_TO_DS) != 0);
 
@@ -146,7 +190,7 @@ int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet
 			hdrlen += 6;
 			if (WLAN_FRAME_IS_QOS(fc)) {
 				uint16_t qos = le16toh(wh->u.addr4_qos_ht.qos);
-				LOG_DBG("WLAN: DATA 4ADDR A-MSDU %x",
+				UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: DATA 4ADDR A-MSDU %x",
 					qos & WLAN_FRAME_QOS_AMSDU_PRESENT);
 				if (qos & WLAN_FRAME_QOS_AMSDU_PRESENT)
 					bssid = wh->addr3;
@@ -171,15 +215,15 @@ int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet
 			return -1;
 
 		p->wlan_nav = le16toh(wh->duration);
-		LOG_DBG("WLAN: DATA NAV %d", p->wlan_nav);
+		UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: DATA NAV %d", p->wlan_nav);
 		p->wlan_seqno = (le16toh(wh->seq) & WLAN_FRAME_SEQ_MASK) >> 4;
-		LOG_DBG("WLAN: DATA SEQ %d", p->wlan_seqno);
+		UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: DATA SEQ %d", p->wlan_seqno);
 
-		LOG_DBG("WLAN: DATA A1 " MAC_FMT, MAC_PAR(wh->addr1));
-		LOG_DBG("WLAN: DATA A2 " MAC_FMT, MAC_PAR(wh->addr2));
-		LOG_DBG("WLAN: DATA A3 " MAC_FMT, MAC_PAR(wh->addr3));
+		UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: DATA A1 " MAC_FMT, MAC_PAR(wh->addr1));
+		UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: DATA A2 " MAC_FMT, MAC_PAR(wh->addr2));
+		UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: DATA A3 " MAC_FMT, MAC_PAR(wh->addr3));
 		if (p->wlan_mode == WLAN_MODE_4ADDR)
-			LOG_DBG("WLAN: DATA A4 " MAC_FMT, MAC_PAR(wh->u.addr4));
+			UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: DATA A4 " MAC_FMT, MAC_PAR(wh->u.addr4));
 
 		/* WEP */
 		if (fc & WLAN_FRAME_FC_PROTECTED)
@@ -213,12 +257,12 @@ int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet
 		ta = wh->addr2;
 		bssid = wh->addr3;
 		p->wlan_seqno = (le16toh(wh->seq) & WLAN_FRAME_SEQ_MASK) >> 4;
-		LOG_DBG("WLAN: MGMT SEQ %d", p->wlan_seqno);
+		UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: MGMT SEQ %d", p->wlan_seqno);
 
 		if (fc & WLAN_FRAME_FC_RETRY)
 			p->wlan_retry = 1;
 	} else {
-		LOG_DBG("WLAN: !!!UNKNOWN FRAME!!!");
+		UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: !!!UNKNOWN FRAME!!!");
 		return -1;
 	}
 
@@ -230,25 +274,25 @@ int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet
 
 		case WLAN_FRAME_QDATA:
 			p->wlan_qos_class = le16toh(wh->u.qos) & WLAN_FRAME_QOS_TID_MASK;
-			LOG_DBG("WLAN: QDATA %x", p->wlan_qos_class);
+			UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: QDATA %x", p->wlan_qos_class);
 			break;
 
 		case WLAN_FRAME_RTS:
 			p->wlan_nav = le16toh(wh->duration);
-			LOG_DBG("WLAN: RTS NAV %d", p->wlan_nav);
+			UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: RTS NAV %d", p->wlan_nav);
 			ra = wh->addr1;
 			ta = wh->addr2;
 			break;
 
 		case WLAN_FRAME_CTS:
 			p->wlan_nav = le16toh(wh->duration);
-			LOG_DBG("WLAN: CTS NAV %d", p->wlan_nav);
+			UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: CTS NAV %d", p->wlan_nav);
 			ra = wh->addr1;
 			break;
 
 		case WLAN_FRAME_ACK:
 			p->wlan_nav = le16toh(wh->duration);
-			LOG_DBG("WLAN: ACK NAV %d", p->wlan_nav);
+			UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: ACK NAV %d", p->wlan_nav);
 			ra = wh->addr1;
 			break;
 
@@ -281,9 +325,9 @@ int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet
 			//LOG_DBG("WLAN: TSF %u BINTVAL %u", p->wlan_tsf, p->wlan_bintval);
 
 			uwifi_parse_information_elements(bc->ie,
-				len - hdrlen - sizeof(struct wlan_frame_beacon) - 4 /* FCS */, p);
-			LOG_DBG("WLAN: ESSID %s", p->wlan_essid );
-			LOG_DBG("WLAN: CHAN %d", p->wlan_channel );
+				len - hdrlen - sizeof(struct wlan_frame_beacon) - 4 /* FCS */, p, ssids);
+			LOG_DBG("WLAN: ESSID %.*s", p->wlan_essid_len, p->wlan_essid);
+			UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: CHAN %d", p->wlan_channel );
 			uint16_t cap_i = le16toh(bc->capab);
 			if (cap_i & WLAN_CAPAB_IBSS)
 				p->wlan_mode = WLAN_MODE_IBSS;
@@ -295,13 +339,23 @@ int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet
 
 		case WLAN_FRAME_PROBE_REQ:
 			uwifi_parse_information_elements(buf + hdrlen,
-				len - hdrlen - 4 /* FCS */, p);
+				len - hdrlen - 4 /* FCS */, p, ssids);
 			p->wlan_mode = WLAN_MODE_PROBE;
 			break;
 
 		case WLAN_FRAME_ASSOC_REQ:
-		case WLAN_FRAME_ASSOC_RESP:
 		case WLAN_FRAME_REASSOC_REQ:
+			;
+			/* the SSID here also resolves hidden SSIDs */
+			size_t fixed = p->wlan_type == WLAN_FRAME_ASSOC_REQ ?
+				sizeof(struct wlan_frame_assoc_req) :
+				sizeof(struct wlan_frame_reassoc_req);
+			if (len >= hdrlen + fixed + 4 /* FCS */)
+				uwifi_parse_information_elements(buf + hdrlen + fixed,
+					len - hdrlen - fixed - 4, p, ssids);
+			break;
+
+		case WLAN_FRAME_ASSOC_RESP:
 		case WLAN_FRAME_REASSOC_RESP:
 		case WLAN_FRAME_DISASSOC:
 			break;
@@ -326,9 +380,9 @@ int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet
 	if (bssid != NULL)
 		memcpy(p->wlan_bssid, bssid, WLAN_MAC_LEN);
 
-	LOG_DBG("WLAN: TA    " MAC_FMT, MAC_PAR(p->wlan_ta));
-	LOG_DBG("WLAN: RA    " MAC_FMT, MAC_PAR(p->wlan_ra));
-	LOG_DBG("WLAN: BSSID " MAC_FMT, MAC_PAR(p->wlan_bssid));
+	UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: TA    " MAC_FMT, MAC_PAR(p->wlan_ta));
+	UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: RA    " MAC_FMT, MAC_PAR(p->wlan_ra));
+	UWIFI_TRACE_DBG(UWIFI_TR_WLAN, "WLAN: BSSID " MAC_FMT, MAC_PAR(p->wlan_bssid));
 
 	/* only unencrypted data frames contain more info */
 	if (WLAN_FRAME_IS_DATA(p->wlan_type) && p->wlan_wep != 1)
@@ -0,0 +1,106 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <string.h>
+
+#include "esp32_promisc.h"
+#include "wlan_parser.h"
+#include "wlan_util.h"
+#include "log.h"
+
+#define ESP32_SIG_MODE_HT	1
+#define ESP32_SIG_MODE_VHT	3
+
+/* MCS flags as in radiotap */
+#define ESP32_MCS_BW_40		0x01
+#define ESP32_MCS_SGI		0x04
+#define ESP32_MCS_FEC_LDPC	0x10
+#define ESP32_MCS_STBC_SHIFT	5
+
+/* legacy rates (wifi_phy_rate_t) in 100kbps, 0 for unused values */
+static const uint16_t esp32_legacy_rates[16] = {
+	10, 20, 55, 110,	/* 1M, 2M, 5.5M, 11M long preamble */
+	0, 20, 55, 110,		/* 2M, 5.5M, 11M short preamble */
+	480, 240, 120, 60,
+	540, 360, 180, 90
+};
+
+static void esp32_parse_rate(const struct uwifi_esp32_rx_ctrl* rxc,
+			     struct uwifi_packet* p)
+{
+	if (rxc->sig_mode == ESP32_SIG_MODE_HT) {
+		p->phy_rate_idx = 12 + rxc->mcs;
+		p->phy_rate_flags = (rxc->cwb ? ESP32_MCS_BW_40 : 0) |
+				    (rxc->sgi ? ESP32_MCS_SGI : 0) |
+				    (rxc->fec_coding ? ESP32_MCS_FEC_LDPC : 0) |
+				    (rxc->stbc << ESP32_MCS_STBC_SHIFT);
+		p->phy_rate = wlan_ht_mcs_to_rate(rxc->mcs, !rxc->cwb, !rxc->sgi);
+		p->phy_flags |= PHY_FLAG_G;
+	} else if (rxc->sig_mode == ESP32_SIG_MODE_VHT) {
+		/* only for RX with ESP32 as STA, which we don't use */
+		p->phy_rate = wlan_vht_mcs_to_rate(rxc->cwb ? CHAN_WIDTH_40 : CHAN_WIDTH_20,
+						   1, rxc->mcs, rxc->sgi);
+	} else if (rxc->rate < 16) {
+		p->phy_rate = esp32_legacy_rates[rxc->rate];
+		p->phy_rate_idx = wlan_rate_to_index(p->phy_rate);
+		if (rxc->rate < 8) {
+			p->phy_flags |= PHY_FLAG_B;
+			if (rxc->rate > 4)
+				p->phy_flags |= PHY_FLAG_SHORTPRE;
+		} else {
+			p->phy_flags |= PHY_FLAG_G;
+		}
+	}
+
+	if (p->phy_rate == 0)
+		p->phy_rate = 10; /* assume min rate */
+}
+
+bool uwifi_esp32_parse(const void* buf, enum uwifi_esp32_pkt_type type,
+		       struct uwifi_packet* p, struct uwifi_ssid_table* ssids)
+{
+	const struct uwifi_esp32_pkt* pkt = buf;
+	const struct uwifi_esp32_rx_ctrl* rxc = &pkt->rx_ctrl;
+	unsigned int len = rxc->sig_len;
+
+	memset(p, 0, sizeof(struct uwifi_packet));
+
+	p->phy_signal = rxc->rssi;
+	p->phy_noise = rxc->noise_floor;
+	if (p->phy_noise < 0 && p->phy_signal > p->phy_noise)
+		p->phy_snr = p->phy_signal - p->phy_noise;
+
+	esp32_parse_rate(rxc, p);
+
+	p->phy_freq = wlan_chan2freq(rxc->channel);
+	if (rxc->secondary_channel == 1)
+		p->wlan_ht40plus = 1;
+
+	/* local MAC time, only 32 bit */
+	p->phy_tsf = rxc->timestamp;
+	p->phy_flags |= PHY_FLAG_TSFT;
+
+	if (rxc->rx_state != 0) {
+		p->phy_flags |= PHY_FLAG_BADFCS;
+		return false;
+	}
+
+	/* MISC packets have no payload */
+	if (type == UWIFI_ESP32_PKT_MISC || len == 0)
+		return false;
+
+	/* sig_len includes the FCS */
+	if (len > 4)
+		len -= 4;
+
+	LOG_DBG("ESP32: RX type %d len %u rate %u sig %d ch %u", type, len,
+		p->phy_rate, p->phy_signal, rxc->channel);
+
+	return uwifi_parse_80211_header((unsigned char*)pkt->payload, len, p, ssids) >= 0;
+}
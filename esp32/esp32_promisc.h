@@ -0,0 +1,97 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_ESP32_PROMISC_H_
+#define _UWIFI_ESP32_PROMISC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Promiscuous callback structures, mirrored from wifi_pkt_rx_ctrl_t and
+ * wifi_promiscuous_pkt_t of ESP-IDF v4 (esp_wifi_types.h) so this can be
+ * built and tested on the host as well. The buffer given to the callback
+ * registered with esp_wifi_set_promiscuous_rx_cb() can be passed directly.
+ */
+
+struct uwifi_esp32_rx_ctrl {
+	signed rssi:8;			// dBm
+	unsigned rate:5;		// legacy rate, see wifi_phy_rate_t
+	unsigned:1;
+	unsigned sig_mode:2;		// 0: non HT, 1: HT (11n), 3: VHT (11ac)
+	unsigned:16;
+	unsigned mcs:7;			// if HT, MCS index 0-76
+	unsigned cwb:1;			// if HT, 1: HT40
+	unsigned:16;
+	unsigned smoothing:1;
+	unsigned not_sounding:1;
+	unsigned:1;
+	unsigned aggregation:1;
+	unsigned stbc:2;
+	unsigned fec_coding:1;		// if HT, 1: LDPC
+	unsigned sgi:1;
+	signed noise_floor:8;		// dBm
+	unsigned ampdu_cnt:8;
+	unsigned channel:4;		// primary channel
+	unsigned secondary_channel:4;	// 0: none, 1: above, 2: below
+	unsigned:8;
+	unsigned timestamp:32;		// local time of reception in usec
+	unsigned:32;
+	unsigned:31;
+	unsigned ant:1;
+	unsigned sig_len:12;		// length of packet including FCS
+	unsigned:12;
+	unsigned rx_state:8;		// 0: no error
+};
+
+struct uwifi_esp32_pkt {
+	struct uwifi_esp32_rx_ctrl rx_ctrl;
+	uint8_t payload[0];		// 802.11 frame, sig_len bytes
+};
+
+/* same values as wifi_promiscuous_pkt_type_t */
+enum uwifi_esp32_pkt_type {
+	UWIFI_ESP32_PKT_MGMT,
+	UWIFI_ESP32_PKT_CTRL,
+	UWIFI_ESP32_PKT_DATA,
+	UWIFI_ESP32_PKT_MISC,		// no payload
+};
+
+struct uwifi_packet;
+
+struct uwifi_ssid_table;
+
+/* parse buffer from the promiscuous RX callback into @pkt, SSIDs are
+ * interned in @ssids if not NULL */
+bool uwifi_esp32_parse(const void* buf, enum uwifi_esp32_pkt_type type,
+		       struct uwifi_packet* pkt, struct uwifi_ssid_table* ssids);
+
+/*
+ * Replay of recorded packet dumps on the host, for validation and
+ * benchmarking (esp32/esp32_replay.c, make ESP32_REPLAY=1 on Linux).
+ *
+ * A dump is a sequence of records: le16 length, le16 type and then length
+ * bytes of the callback buffer (rx_ctrl followed by the payload).
+ */
+typedef void (*uwifi_esp32_replay_cb)(struct uwifi_packet* pkt, bool parsed,
+				      void* ctx);
+
+/* returns number of records or -1 on error */
+int uwifi_esp32_replay(const char* path, struct uwifi_ssid_table* ssids,
+		       uwifi_esp32_replay_cb cb, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+
+#include "esp32_promisc.h"
+#include "wlan_parser.h"
+#include "log.h"
+
+/* maximum record: rx_ctrl and 12 bit sig_len */
+#define ESP32_MAX_RECORD	(sizeof(struct uwifi_esp32_rx_ctrl) + 4096)
+
+int uwifi_esp32_replay(const char* path, struct uwifi_ssid_table* ssids,
+		       uwifi_esp32_replay_cb cb, void* ctx)
+{
+	struct uwifi_packet pkt;
+	uint16_t hdr[2];
+	uint32_t* rec;
+	int count = 0;
+
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) {
+		LOG_ERR("ESP32 replay: could not open %s", path);
+		return -1;
+	}
+
+	/* copy records to an aligned buffer, the dump has no padding */
+	rec = malloc(ESP32_MAX_RECORD);
+	if (rec == NULL) {
+		fclose(f);
+		return -1;
+	}
+
+	while (fread(hdr, sizeof(hdr), 1, f) == 1) {
+		size_t len = le16toh(hdr[0]);
+		enum uwifi_esp32_pkt_type type = le16toh(hdr[1]);
+
+		if (len < sizeof(struct uwifi_esp32_rx_ctrl) || len > ESP32_MAX_RECORD) {
+			LOG_ERR("ESP32 replay: bad record length %zu", len);
+			count = -1;
+			break;
+		}
+		if (fread(rec, len, 1, f) != 1) {
+			LOG_ERR("ESP32 replay: truncated record");
+			count = -1;
+			break;
+		}
+
+		/* don't read beyond the record for a bad sig_len */
+		struct uwifi_esp32_pkt* ep = (struct uwifi_esp32_pkt*)rec;
+		size_t max_sig = len - sizeof(struct uwifi_esp32_rx_ctrl);
+		if (ep->rx_ctrl.sig_len > max_sig)
+			ep->rx_ctrl.sig_len = max_sig;
+
+		bool parsed = uwifi_esp32_parse(rec, type, &pkt, ssids);
+		cb(&pkt, parsed, ctx);
+		count++;
+	}
+
+	free(rec);
+	fclose(f);
+	return count;
+}
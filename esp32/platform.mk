@@ -0,0 +1,16 @@
+# libuwifi - Userspace Wifi Library
+#
+# Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+#
+# This program is licensed under the GNU Lesser General Public License,
+# Version 3. See the file COPYING for more details.
+
+SRC		+= esp32/platform.c
+SRC		+= esp32/esp32_promisc.c
+STATIC_TABLES	= 1
+NODE_STATS	= 0
+NODE_PROBED	= 0
+INTERFERENCE	= 0
+INVENTORY	= 0
+
+all: $(NAME).a
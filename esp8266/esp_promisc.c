@@ -9,9 +9,77 @@
 
 #include "esp8266/platform.h"
 #include "esp8266/esp_promisc.h"
-#include "core/wlan_parser.h"
+#include "wlan_parser.h"
+#include "ring.h"
 
-bool uwifi_esp_parse(uint8_t* buf, uint16_t len, struct uwifi_packet* pkt)
+/* the application may provide its own */
+#ifndef DBG_PRINT
+#if DEBUG
+#define DBG_PRINT(...)		os_printf(__VA_ARGS__)
+#else
+#define DBG_PRINT(...)		do { } while (0)
+#endif
+#endif
+
+/*
+ * The promiscuous RX callback only copies the raw sniffer buffer into a ring,
+ * parsing happens later in a task thru uwifi_esp_ring_parse().
+ *
+ * Data callbacks carry one struct LenSeq per aggregated frame and can be
+ * longer than a slot. uwifi_esp_parse() only reads up to the first LenSeq,
+ * so only that much is copied, but the original length is kept, because it
+ * tells the type of the callback.
+ */
+
+struct esp_rx_record {
+	uint16_t	len;		/* length given to the callback */
+	uint8_t		buf[sizeof(struct sniffer_buf2)];
+};
+
+static struct esp_rx_record esp_rx_records[UWIFI_ESP_RING_SLOTS];
+static struct uwifi_ring esp_rx_ring;
+
+bool uwifi_esp_ring_init(void)
+{
+	if (!uwifi_ring_init(&esp_rx_ring, esp_rx_records,
+			     sizeof(struct esp_rx_record), UWIFI_ESP_RING_SLOTS)) {
+		os_printf("UWIFI_ESP_RING_SLOTS has to be a power of 2\n");
+		return false;
+	}
+	return true;
+}
+
+void uwifi_esp_rx_cb(uint8_t* buf, uint16_t len)
+{
+	struct esp_rx_record* rec = uwifi_ring_produce_begin(&esp_rx_ring);
+	if (rec == NULL)
+		return; /* full, counted as drop */
+
+	memcpy(rec->buf, buf, len < sizeof(rec->buf) ? len : sizeof(rec->buf));
+	rec->len = len;
+	uwifi_ring_produce_commit(&esp_rx_ring);
+}
+
+bool uwifi_esp_ring_parse(struct uwifi_packet* pkt, bool* parsed,
+			  struct uwifi_ssid_table* ssids)
+{
+	struct esp_rx_record* rec = uwifi_ring_consume_begin(&esp_rx_ring);
+	if (rec == NULL)
+		return false;
+
+	/* rec->len can be larger than rec->buf, see above */
+	*parsed = uwifi_esp_parse(rec->buf, rec->len, pkt, ssids);
+	uwifi_ring_consume_commit(&esp_rx_ring);
+	return true;
+}
+
+uint32_t uwifi_esp_ring_drops(void)
+{
+	return uwifi_ring_drops(&esp_rx_ring);
+}
+
+bool uwifi_esp_parse(uint8_t* buf, uint16_t len, struct uwifi_packet* pkt,
+		     struct uwifi_ssid_table* ssids)
 {
 	struct sniffer_buf* sb;
 	struct sniffer_buf2* sb2;
@@ -51,7 +119,7 @@ bool uwifi_esp_parse(uint8_t* buf, uint16_t len, struct uwifi_packet* pkt)
 		os_memset(pkt, 0, sizeof(struct uwifi_packet));
 		pkt->phy_signal = rxc->rssi;
 
-		return uwifi_parse_80211_header(frame, frame_len, pkt) >= 0;
+		return uwifi_parse_80211_header(frame, frame_len, pkt, ssids) >= 0;
 	}
 	return false;
 }
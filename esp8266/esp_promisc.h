@@ -60,7 +60,29 @@ struct sniffer_buf2 {
 };
 
 struct uwifi_packet;
+struct uwifi_ssid_table;
 
-bool uwifi_esp_parse(uint8_t* buf, uint16_t len, struct uwifi_packet* pkt);
+/* SSIDs are interned in @ssids if not NULL */
+bool uwifi_esp_parse(uint8_t* buf, uint16_t len, struct uwifi_packet* pkt,
+		     struct uwifi_ssid_table* ssids);
+
+/* number of raw frames buffered between RX callback and task */
+#ifndef UWIFI_ESP_RING_SLOTS
+#define UWIFI_ESP_RING_SLOTS	16
+#endif
+
+/* returns false if UWIFI_ESP_RING_SLOTS is not a power of 2 */
+bool uwifi_esp_ring_init(void);
+
+/* use as promiscuous RX callback (wifi_set_promiscuous_rx_cb), only copies */
+void uwifi_esp_rx_cb(uint8_t* buf, uint16_t len);
+
+/* call from task: returns false when ring is empty, otherwise parses one
+ * frame into @pkt and sets @parsed to the result of uwifi_esp_parse() */
+bool uwifi_esp_ring_parse(struct uwifi_packet* pkt, bool* parsed,
+			  struct uwifi_ssid_table* ssids);
+
+/* frames dropped because the ring was full */
+uint32_t uwifi_esp_ring_drops(void);
 
 #endif
@@ -6,5 +6,10 @@
 # Version 3. See the file COPYING for more details.
 
 SRC		+= esp8266/esp_promisc.c
+STATIC_TABLES	= 1
+NODE_STATS	= 0
+NODE_PROBED	= 0
+INTERFERENCE	= 0
+INVENTORY	= 0
 
 all: $(NAME).a
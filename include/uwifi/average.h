@@ -29,6 +29,9 @@ extern void ewma_init(struct ewma *avg, unsigned long factor,
 
 extern struct ewma *ewma_add(struct ewma *avg, unsigned long val);
 
+extern void ewma_merge(struct ewma *avg, const struct ewma *other,
+		       unsigned long n);
+
 /**
  * ewma_read() - Get average value
  * @avg: Average structure
@@ -14,6 +14,9 @@
 #include "wlan80211.h"
 #include "channel.h"
 #include "platform.h"
+#include "stats.h"
+#include "timestamp.h"
+#include "util.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -46,6 +49,10 @@ struct uwifi_interface {
 	unsigned int		max_phy_rate;
 	int			if_type;
 	int			arphdr;			/* the device ARP type */
+	struct uwifi_tsf_map	tsf_map;		/* MAC TSF to host time */
+#if UWIFI_NODE_STATS
+	struct uwifi_stat	chan_sig[MAX_CHANNELS];	/* signal by channel index */
+#endif
 };
 
 // TODO: move? platform specific or not?
@@ -0,0 +1,188 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_COUNTERS_H_
+#define _UWIFI_COUNTERS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Library performance counters and latency histograms (make COUNTERS=1).
+ *
+ * Counters are kept per context so bumping them needs no locked operations.
+ * There is one default context, additional threads which call into the
+ * library should register their own with uwifi_counters_register() and
+ * remove it with uwifi_counters_unregister() before they exit. Each
+ * context is protected by a sequence counter, so uwifi_counters_snapshot()
+ * gets a consistent copy without blocking the writers.
+ *
+ * Histograms are log-linear with the buckets of uwifi_sketch (stats.h):
+ * values below 8 have their own bucket, above that each power of 2 is
+ * divided into 8 buckets (max. 12.5% error). uwifi_hist_sketch() turns a
+ * histogram into a sketch, e.g. to merge it with the ones of other hosts.
+ *
+ * Without COUNTERS=1 the macros compile to nothing.
+ */
+
+enum uwifi_counter {
+	UWIFI_CNT_FRAMES_RX,		/* received from packet socket */
+	UWIFI_CNT_FRAMES_PARSED,
+	UWIFI_CNT_FRAMES_BADFCS,
+	UWIFI_CNT_FRAMES_MALFORMED,
+	UWIFI_CNT_NODES_CREATED,
+	UWIFI_CNT_NODES_EXPIRED,
+	UWIFI_CNT_NODES_EVICTED,	/* static tables full */
+	UWIFI_CNT_NODES_ALLOC_FAIL,
+	UWIFI_CNT_ESSIDS_CREATED,
+	UWIFI_CNT_ESSIDS_DELETED,
+	UWIFI_CNT_CHAN_SWITCHES,
+	UWIFI_CNT_CHAN_SWITCH_FAIL,
+	UWIFI_CNT_INJECTED,
+	UWIFI_CNT_INJECT_FAIL,
+	UWIFI_CNT_MAX
+};
+
+enum uwifi_histogram {
+	UWIFI_HIST_PARSE,		/* nsec for uwifi_parse_raw() */
+	UWIFI_HIST_NODE_LOOKUP,		/* nsec to find node in list */
+	UWIFI_HIST_CHAN_SWITCH,		/* nsec to change channel */
+	UWIFI_HIST_MAX
+};
+
+#define UWIFI_HIST_SUB_BITS	UWIFI_SKETCH_SUB_BITS
+#define UWIFI_HIST_SUB		UWIFI_SKETCH_SUB
+#define UWIFI_HIST_BUCKETS	UWIFI_SKETCH_BUCKETS
+
+#ifndef UWIFI_COUNTERS_MAX_CTX
+#define UWIFI_COUNTERS_MAX_CTX	8
+#endif
+
+#ifndef UWIFI_COUNTERS
+#define UWIFI_COUNTERS		0
+#endif
+
+struct uwifi_hist {
+	uint64_t	count;
+	uint64_t	sum;
+	uint32_t	buckets[UWIFI_HIST_BUCKETS];
+};
+
+struct uwifi_counters {
+	uint32_t		seq;	/* odd while being written */
+	uint64_t		cnt[UWIFI_CNT_MAX];
+	struct uwifi_hist	hist[UWIFI_HIST_MAX];
+};
+
+struct uwifi_counters_snapshot {
+	uint64_t		cnt[UWIFI_CNT_MAX];
+	struct uwifi_hist	hist[UWIFI_HIST_MAX];
+};
+
+/* bucket for value, values above 32 bit go into the last bucket */
+static inline unsigned int uwifi_hist_bucket(uint64_t v)
+{
+	if (v > UINT32_MAX)
+		return UWIFI_HIST_BUCKETS - 1;
+	return uwifi_sketch_bucket(v);
+}
+
+#if UWIFI_COUNTERS
+
+/* lowest value of bucket */
+uint64_t uwifi_hist_bucket_low(unsigned int idx);
+
+/* estimate value below which @permille of the samples are */
+uint64_t uwifi_hist_percentile(const struct uwifi_hist* h, unsigned int permille);
+
+/* sketch with the same distribution as @h */
+void uwifi_hist_sketch(const struct uwifi_hist* h, struct uwifi_sketch* s);
+
+const char* uwifi_counter_name(enum uwifi_counter c);
+const char* uwifi_hist_name(enum uwifi_histogram h);
+
+/* add context for the calling thread, @ctx has to stay valid */
+bool uwifi_counters_register(struct uwifi_counters* ctx);
+
+/* remove context before the thread exits, its counts are kept in the
+ * totals and @ctx can be freed afterwards */
+void uwifi_counters_unregister(struct uwifi_counters* ctx);
+
+/* sum of all contexts */
+void uwifi_counters_snapshot(struct uwifi_counters_snapshot* s);
+
+extern __thread struct uwifi_counters* uwifi_counters_ctx;
+extern struct uwifi_counters uwifi_counters_default;
+
+uint64_t uwifi_counters_time(void);
+
+static inline struct uwifi_counters* uwifi_counters_get(void)
+{
+	return uwifi_counters_ctx ? uwifi_counters_ctx : &uwifi_counters_default;
+}
+
+/* only the owner writes, relaxed atomics just avoid torn values */
+#define _UWIFI_CTR_ADD(_var, _v)						\
+	__atomic_store_n(&(_var), (_var) + (_v), __ATOMIC_RELAXED)
+
+static inline void uwifi_counters_write_begin(struct uwifi_counters* c)
+{
+	__atomic_store_n(&c->seq, c->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void uwifi_counters_write_end(struct uwifi_counters* c)
+{
+	__atomic_store_n(&c->seq, c->seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline void uwifi_count_add(enum uwifi_counter cnt, uint32_t v)
+{
+	struct uwifi_counters* c = uwifi_counters_get();
+	uwifi_counters_write_begin(c);
+	_UWIFI_CTR_ADD(c->cnt[cnt], v);
+	uwifi_counters_write_end(c);
+}
+
+static inline void uwifi_hist_add(enum uwifi_histogram hist, uint64_t v)
+{
+	struct uwifi_counters* c = uwifi_counters_get();
+	struct uwifi_hist* h = &c->hist[hist];
+	uwifi_counters_write_begin(c);
+	_UWIFI_CTR_ADD(h->count, 1);
+	_UWIFI_CTR_ADD(h->sum, v);
+	_UWIFI_CTR_ADD(h->buckets[uwifi_hist_bucket(v)], 1);
+	uwifi_counters_write_end(c);
+}
+
+#define UWIFI_COUNT(_c)			uwifi_count_add(_c, 1)
+#define UWIFI_COUNT_ADD(_c, _v)		uwifi_count_add(_c, _v)
+#define UWIFI_TIME_START(_t)		uint64_t _t = uwifi_counters_time()
+#define UWIFI_HIST_SINCE(_h, _t)	uwifi_hist_add(_h, uwifi_counters_time() - (_t))
+
+#else
+
+#define UWIFI_COUNT(_c)			do { } while (0)
+#define UWIFI_COUNT_ADD(_c, _v)		do { } while (0)
+#define UWIFI_TIME_START(_t)		do { } while (0)
+#define UWIFI_HIST_SINCE(_h, _t)	do { } while (0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -12,14 +12,21 @@
 
 #include "cc_list.h"
 #include "wlan80211.h"
+#include "util.h"
+#include "ssid.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#if UWIFI_STATIC_TABLES && !defined(UWIFI_MAX_ESSIDS)
+#define UWIFI_MAX_ESSIDS	8
+#endif
+
 struct essid_info {
 	struct cc_list_node	list;
-	char			essid[WLAN_MAX_SSID_LEN];
+	struct uwifi_ssid_table* ssids;
+	uint16_t		id;		/* interned SSID, referenced */
 	struct cc_list_head	nodes;
 	unsigned int		num_nodes;
 	int			split;
@@ -28,9 +35,29 @@ struct essid_info {
 struct uwifi_node;
 struct uwifi_packet;
 
-void uwifi_essids_update(struct cc_list_head* essids, struct uwifi_packet* p,
-			 struct uwifi_node* n);
+/*
+ * Beacons of APs with hidden SSID have an empty or zeroed SSID. The real one
+ * is learned from probe responses and (re)association requests and kept in
+ * a cache by BSSID in @ssids, so these APs are added to the ESSID with their
+ * next beacon.
+ *
+ * SSIDs are kept in @ssids, usually the table the packet was parsed with,
+ * see ssid.h.
+ */
+void uwifi_essids_update(struct cc_list_head* essids, struct uwifi_ssid_table* ssids,
+			 struct uwifi_packet* p, struct uwifi_node* n);
 void uwifi_essids_remove_node(struct uwifi_node* n);
+
+static inline const struct uwifi_ssid* uwifi_essid_ssid(const struct essid_info* e)
+{
+	return uwifi_ssid_get(e->ssids, e->id);
+}
+
+/* NUL terminated SSID of @e, for printing, may be cut at an embedded NUL */
+static inline const char* uwifi_essid_name(const struct essid_info* e)
+{
+	return uwifi_ssid_get(e->ssids, e->id)->ssid;
+}
 void uwifi_essids_free(struct cc_list_head* essids);
 
 #ifdef __cplusplus
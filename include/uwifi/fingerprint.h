@@ -0,0 +1,105 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_FINGERPRINT_H_
+#define _UWIFI_FINGERPRINT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util.h"
+#include "wlan80211.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Grouping of randomized MACs into devices.
+ *
+ * Clients which randomize their MAC use a new one for every probe burst,
+ * which would create a new node each time. The parser sets wlan_fingerprint
+ * of probe requests from the IEs, and this table maps each fingerprint to
+ * the first MAC it was seen with. Call uwifi_fingerprint_group() before
+ * uwifi_node_update() and probe requests from locally administered MACs
+ * are accounted to the node of that MAC. Likewise frames to the MAC a
+ * device last probed with, like probe responses, are accounted to that
+ * node by calling uwifi_fingerprint_group_receiver() before
+ * uwifi_node_update_receiver(), instead of creating a node for it.
+ *
+ * The table is hash indexed by fingerprint with a bounded number of probes,
+ * when they are all used the least recently seen entry is replaced. A second
+ * index by the hash of the last MAC finds the device of a receiver, where
+ * MACs with the same hash replace each other.
+ * Identical devices with the same software have the same fingerprint and
+ * are counted as one.
+ */
+
+/* has to be a power of 2 */
+#ifndef UWIFI_FP_TABLE_SIZE
+#if UWIFI_STATIC_TABLES
+#define UWIFI_FP_TABLE_SIZE	32
+#else
+#define UWIFI_FP_TABLE_SIZE	1024
+#endif
+#endif
+
+/* number of entries tried for a fingerprint */
+#define UWIFI_FP_MAX_PROBE	8
+
+struct uwifi_packet;
+
+struct uwifi_fp_entry {
+	uint32_t	fingerprint;	/* 0: unused */
+	uint32_t	last_seen;	/* timestamp */
+	unsigned char	mac[WLAN_MAC_LEN];	/* the device is known by this MAC */
+	unsigned char	last_mac[WLAN_MAC_LEN];	/* MAC of the last probe */
+	uint16_t	num_macs;	/* number of MACs used, saturating */
+};
+
+struct uwifi_fp_table {
+	uint32_t		timeout;	/* usec */
+	struct uwifi_fp_entry	entries[UWIFI_FP_TABLE_SIZE];
+	uint16_t		by_mac[UWIFI_FP_TABLE_SIZE];	/* entry + 1 */
+};
+
+/* entries not seen for @timeout_sec are forgotten */
+void uwifi_fingerprint_init(struct uwifi_fp_table* t, unsigned int timeout_sec);
+
+/**
+ * uwifi_fingerprint_group() - group probe request into a device
+ * @t: fingerprint table
+ * @p: parsed packet
+ *
+ * Returns true if @p came from a locally administered MAC of a known device,
+ * its wlan_ta was then replaced by the MAC the device is known by.
+ */
+bool uwifi_fingerprint_group(struct uwifi_fp_table* t, struct uwifi_packet* p);
+
+/**
+ * uwifi_fingerprint_group_receiver() - group receiver into a device
+ * @t: fingerprint table
+ * @p: parsed packet
+ *
+ * Returns true if the receiver of @p is the locally administered MAC a known
+ * device last probed with, its wlan_ra was then replaced by the MAC the
+ * device is known by.
+ */
+bool uwifi_fingerprint_group_receiver(const struct uwifi_fp_table* t,
+				      struct uwifi_packet* p);
+
+/* entry for @fingerprint, or NULL */
+const struct uwifi_fp_entry* uwifi_fingerprint_find(const struct uwifi_fp_table* t,
+						     uint32_t fingerprint);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_FRAMELOG_H_
+#define _UWIFI_FRAMELOG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lz.h"
+#include "util.h"
+#include "wlan80211.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Column oriented binary log of parsed frames for offline analysis.
+ *
+ * Frames are collected into blocks of up to UWIFI_FRAMELOG_BLOCK records.
+ * Within a block each field is stored as one fixed width column, which
+ * makes the (optional) LZ compression effective, as MACs, types and
+ * channels repeat a lot. All values are little endian.
+ *
+ * Block header (12 bytes):
+ *	4	magic "UWFL"
+ *	1	version
+ *	1	flags (UWIFI_FRAMELOG_LZ: data is compressed)
+ *	2	number of records
+ *	4	length of data following
+ *
+ * Columns, in this order, each number of records long:
+ *	u64	time delta to previous record in nsec (first: absolute)
+ *	6	transmitter address
+ *	6	receiver address
+ *	u16	frame control (wlan_type)
+ *	s8	signal (dBm)
+ *	u16	rate (100kbps)
+ *	u16	length
+ *	u16	frequency (MHz)
+ *	u8	flags (UWIFI_FRAMELOG_F_*)
+ */
+
+#define UWIFI_FRAMELOG_VERSION	1
+#define UWIFI_FRAMELOG_BLOCK	2048
+#define UWIFI_FRAMELOG_HDR_LEN	12
+#define UWIFI_FRAMELOG_REC_LEN	30
+#define UWIFI_FRAMELOG_RAW_LEN	(UWIFI_FRAMELOG_BLOCK * UWIFI_FRAMELOG_REC_LEN)
+
+/* block flags */
+#define UWIFI_FRAMELOG_LZ	BIT(0)
+
+/* record flags */
+#define UWIFI_FRAMELOG_F_RETRY	BIT(0)
+#define UWIFI_FRAMELOG_F_BADFCS	BIT(1)
+
+struct uwifi_packet;
+
+struct uwifi_framelog_rec {
+	uint64_t	time;		/* nsec, pkt_time */
+	unsigned char	ta[WLAN_MAC_LEN];
+	unsigned char	ra[WLAN_MAC_LEN];
+	uint16_t	type;
+	int8_t		signal;
+	uint16_t	rate;
+	uint16_t	len;
+	uint16_t	freq;
+	uint8_t		flags;
+};
+
+/* writer */
+
+typedef bool (*uwifi_framelog_flush_cb)(const uint8_t* buf, size_t len, void* ctx);
+
+struct uwifi_framelog_writer {
+	bool			compress;
+	uwifi_framelog_flush_cb	flush;
+	void*			ctx;
+	unsigned int		num;
+	uint64_t		last_time;
+	uint8_t			raw[UWIFI_FRAMELOG_RAW_LEN];
+	uint8_t			out[UWIFI_FRAMELOG_HDR_LEN + UWIFI_LZ_BOUND(UWIFI_FRAMELOG_RAW_LEN)];
+	uint16_t		lz_table[UWIFI_LZ_HASH_SIZE];
+};
+
+void uwifi_framelog_init(struct uwifi_framelog_writer* w, bool compress,
+			 uwifi_framelog_flush_cb flush, void* ctx);
+
+/* add frame, the block is passed to the flush callback when full */
+bool uwifi_framelog_add(struct uwifi_framelog_writer* w, const struct uwifi_packet* p);
+
+/* write out the current block, even if not full */
+bool uwifi_framelog_flush(struct uwifi_framelog_writer* w);
+
+/* reader */
+
+struct uwifi_framelog_block {
+	unsigned int	num;
+	uint8_t		raw[UWIFI_FRAMELOG_RAW_LEN];
+};
+
+/**
+ * uwifi_framelog_read() - decode one block
+ * @buf: data starting at a block header
+ *
+ * Returns the length of the block in @buf, 0 if @len does not contain the
+ * whole block yet, or -1 if the data is corrupt.
+ */
+int uwifi_framelog_read(const uint8_t* buf, size_t len, struct uwifi_framelog_block* b);
+
+/* get record @i of a decoded block */
+void uwifi_framelog_get(const struct uwifi_framelog_block* b, unsigned int i,
+			struct uwifi_framelog_rec* r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_INTERFERENCE_H_
+#define _UWIFI_INTERFERENCE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cc_list.h"
+#include "channel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Co- and adjacent channel interference estimator.
+ *
+ * Every AP adds a weight to each 20 MHz channel its BSS occupies, given by
+ * primary channel, width and HT40+/-. The weight is the received power of
+ * the AP (linear, 1 is -100 dBm) times the share of airtime its BSS was
+ * measured to use. An AP has no weight as long as no frame of its own was
+ * received since its node was created or its statistics were reset. In
+ * 2.4 GHz channels overlap, so neighbouring channels get a part of the
+ * weight, depending on the distance.
+ *
+ * The weights are updated incrementally: when an AP appears, changes its
+ * channel or width, at the end of each airtime measurement window, and
+ * when its node is removed. Channels are indexed by channel number, 2.4
+ * and 5 GHz only.
+ */
+
+#define UWIFI_INTF_MAX_CHAN	200
+
+/* default airtime measurement window in usec */
+#define UWIFI_INTF_WINDOW	1000000
+
+/* per AP state, part of struct uwifi_node */
+struct uwifi_intf_ap {
+	uint64_t	weight;		/* weight currently added */
+	uint32_t	activity;	/* smoothed airtime share, Q16 */
+	uint32_t	airtime;	/* usec in current window */
+	uint32_t	window_start;
+	uint8_t		chan;		/* primary channel, 0: nothing added */
+	uint8_t		width;		/* enum uwifi_chan_width */
+	bool		ht40plus;
+};
+
+struct uwifi_interference {
+	uint64_t	score[UWIFI_INTF_MAX_CHAN];
+	uint32_t	window;		/* usec */
+	struct cc_list_head* nodes;	/* accounted node list */
+};
+
+struct uwifi_node;
+struct uwifi_packet;
+
+/* registers a node remove callback for @nodes, call uwifi_interference_free().
+ * Only nodes of @nodes may be passed to uwifi_interference_update() */
+bool uwifi_interference_init(struct uwifi_interference* est,
+			     struct cc_list_head* nodes, uint32_t window);
+void uwifi_interference_free(struct uwifi_interference* est);
+
+/* account packet @p of node @n, after uwifi_node_update() */
+void uwifi_interference_update(struct uwifi_interference* est,
+			       struct uwifi_node* n, struct uwifi_packet* p);
+
+/* interference on a channel of @width with primary channel @chan, the sum
+ * of the 20 MHz channels it occupies */
+uint64_t uwifi_interference_score(const struct uwifi_interference* est,
+				  int chan, enum uwifi_chan_width width,
+				  bool ht40plus);
+
+/* channel of @channels with the lowest score for @width, 0 if none */
+int uwifi_interference_best(const struct uwifi_interference* est,
+			    struct uwifi_channels* channels,
+			    enum uwifi_chan_width width);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
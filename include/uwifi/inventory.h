@@ -0,0 +1,133 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_INVENTORY_H_
+#define _UWIFI_INVENTORY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cc_list.h"
+#include "channel.h"
+#include "util.h"
+#include "wlan_util.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Device capability inventory: how many APs and clients there are by
+ * standard, channel width, number of spatial streams, band and security,
+ * globally and for the clients of each BSS.
+ *
+ * Every node remembers the category it is counted in, so when a node
+ * changes only the difference is applied and when it is removed it is
+ * subtracted again. Reading a histogram is therefore O(1) at any number
+ * of nodes. APs count as APs, stations and probing nodes as clients, other
+ * nodes are not counted.
+ *
+ * The histograms of the BSSs are kept in a table of the inventory, so only
+ * APs use one. An AP without a free entry is still counted globally.
+ */
+
+/* number of BSSs with a histogram of their clients */
+#ifndef UWIFI_INV_MAX_BSS
+#if UWIFI_STATIC_TABLES
+#define UWIFI_INV_MAX_BSS	4
+#else
+#define UWIFI_INV_MAX_BSS	128
+#endif
+#endif
+
+#define UWIFI_INV_STDS		(IEEE80211_AC + 1)
+#define UWIFI_INV_WIDTHS	(CHAN_WIDTH_8080 + 1)
+#define UWIFI_INV_MAX_NSS	4	/* index 0 is unknown */
+
+enum uwifi_inv_band {
+	UWIFI_INV_BAND_UNKNOWN,
+	UWIFI_INV_BAND_2GHZ,
+	UWIFI_INV_BAND_5GHZ,
+	UWIFI_INV_BANDS
+};
+
+enum uwifi_inv_sec {
+	UWIFI_INV_SEC_OPEN,
+	UWIFI_INV_SEC_WEP,
+	UWIFI_INV_SEC_WPA,
+	UWIFI_INV_SEC_RSN,
+	UWIFI_INV_SECS
+};
+
+/* counts are limited by the number of nodes */
+#if UWIFI_STATIC_TABLES
+typedef uint16_t		uwifi_inv_cnt_t;
+#else
+typedef uint32_t		uwifi_inv_cnt_t;
+#endif
+
+struct uwifi_inv_hist {
+	uwifi_inv_cnt_t		total;
+	uwifi_inv_cnt_t		std[UWIFI_INV_STDS];
+	uwifi_inv_cnt_t		width[UWIFI_INV_WIDTHS];
+	uwifi_inv_cnt_t		nss[UWIFI_INV_MAX_NSS + 1];
+	uwifi_inv_cnt_t		band[UWIFI_INV_BANDS];
+	uwifi_inv_cnt_t		sec[UWIFI_INV_SECS];
+	/* combined, e.g. for the number of 2x2 AC clients */
+	uwifi_inv_cnt_t		std_nss[UWIFI_INV_STDS][UWIFI_INV_MAX_NSS + 1];
+};
+
+/* per node state, part of struct uwifi_node */
+struct uwifi_inv_node {
+	/* BSS entry + 1, for APs their own, for clients the one of their AP
+	 * they are counted in. Only valid while the generation matches */
+	uint16_t		bss;
+	uint16_t		gen;
+	uint8_t			role;		/* 0: not counted */
+	uint8_t			std;
+	uint8_t			width;
+	uint8_t			nss;
+	uint8_t			band;
+	uint8_t			sec;
+};
+
+struct uwifi_inv_bss {
+	struct uwifi_inv_hist	hist;		/* clients of the BSS */
+	const struct uwifi_node* ap;		/* NULL: unused */
+	uint16_t		gen;		/* incremented when freed */
+};
+
+struct uwifi_inventory {
+	struct cc_list_head*	nodes;		/* counted node list */
+	struct uwifi_inv_hist	aps;
+	struct uwifi_inv_hist	clients;
+	struct uwifi_inv_bss	bss[UWIFI_INV_MAX_BSS];
+	unsigned int		bss_used;
+};
+
+struct uwifi_node;
+
+/* registers a node remove callback for @nodes, call uwifi_inventory_free().
+ * Only nodes of @nodes may be passed to uwifi_inventory_update(), and the
+ * state in the nodes can only be used by one inventory at a time */
+bool uwifi_inventory_init(struct uwifi_inventory* inv, struct cc_list_head* nodes);
+void uwifi_inventory_free(struct uwifi_inventory* inv);
+
+/* account changes of @n, after uwifi_node_update() and uwifi_nodes_find_ap() */
+void uwifi_inventory_update(struct uwifi_inventory* inv, struct uwifi_node* n);
+
+/* clients of the BSS of @ap, NULL if it has no entry */
+const struct uwifi_inv_hist* uwifi_inventory_bss(const struct uwifi_inventory* inv,
+						 const struct uwifi_node* ap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
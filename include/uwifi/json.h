@@ -0,0 +1,63 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_JSON_H_
+#define _UWIFI_JSON_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Streaming newline-delimited JSON output of nodes, ESSIDs, channel state
+ * and per-frame summaries.
+ *
+ * Records are written into a caller-provided buffer without allocation or
+ * printf. Each record is one line and is either written completely or not
+ * at all. When the buffer has no room left the flush callback is called,
+ * e.g. to write() it to a file descriptor; without callback the write
+ * fails, so a ring slot can be used as buffer for exactly one record.
+ */
+
+struct uwifi_node;
+struct essid_info;
+struct uwifi_packet;
+struct uwifi_interface;
+
+/* return false on error, the buffer contents are then discarded */
+typedef bool (*uwifi_json_flush_cb)(const char* buf, size_t len, void* ctx);
+
+struct uwifi_json_out {
+	char*			buf;
+	size_t			size;
+	size_t			len;
+	uwifi_json_flush_cb	flush;
+	void*			ctx;
+};
+
+void uwifi_json_init(struct uwifi_json_out* out, char* buf, size_t size,
+		     uwifi_json_flush_cb flush, void* ctx);
+
+/* call flush callback for the buffered records */
+bool uwifi_json_flush(struct uwifi_json_out* out);
+
+/* these return false if the record did not fit or flushing failed */
+bool uwifi_json_node(struct uwifi_json_out* out, const struct uwifi_node* n);
+bool uwifi_json_essid(struct uwifi_json_out* out, const struct essid_info* e);
+bool uwifi_json_channel(struct uwifi_json_out* out, const struct uwifi_interface* intf);
+bool uwifi_json_packet(struct uwifi_json_out* out, const struct uwifi_packet* p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
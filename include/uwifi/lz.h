@@ -0,0 +1,51 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_LZ_H_
+#define _UWIFI_LZ_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Small LZ77 compressor producing the LZ4 block format (no frame header),
+ * so data can also be decompressed by liblz4. Fast rather than good: one
+ * hash table probe per position and no lazy matching. Inputs are limited
+ * to 64KB so positions fit in the 16 bit hash table supplied by the caller.
+ */
+
+#define UWIFI_LZ_MAX_INPUT	65535
+#define UWIFI_LZ_HASH_BITS	12
+#define UWIFI_LZ_HASH_SIZE	(1 << UWIFI_LZ_HASH_BITS)
+
+/* worst case output size for incompressible input */
+#define UWIFI_LZ_BOUND(_len)	((_len) + (_len) / 255 + 16)
+
+/**
+ * uwifi_lz_compress() - compress @len bytes into @dst
+ * @table: scratch space of UWIFI_LZ_HASH_SIZE entries
+ *
+ * Returns the compressed size or 0 if it would not fit into @dst_len.
+ */
+size_t uwifi_lz_compress(const uint8_t* src, size_t len, uint8_t* dst,
+			 size_t dst_len, uint16_t* table);
+
+/* returns the decompressed size or -1 for corrupt input or too small @dst */
+int uwifi_lz_decompress(const uint8_t* src, size_t len, uint8_t* dst,
+			size_t dst_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
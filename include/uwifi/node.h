@@ -14,38 +14,80 @@
 #include "wlan_parser.h"
 #include "cc_list.h"
 #include "average.h"
+#include "stats.h"
 #include "conf.h"
 #include "essid.h"
+#include "ssid.h"
 #include "wlan_util.h"
+#include "interference.h"
+#include "inventory.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* time constant of phy_sig_tavg in usec */
+#ifndef UWIFI_SIG_TAU
+#define UWIFI_SIG_TAU		1000000
+#endif
+
+#if UWIFI_STATIC_TABLES
+/* maximum number of nodes, the oldest node is replaced when full */
+#ifndef UWIFI_MAX_NODES
+#define UWIFI_MAX_NODES		32
+#endif
+typedef uint16_t		uwifi_cnt_t;	/* saturating */
+typedef int8_t			uwifi_sig_t;
+#define uwifi_cnt_inc(_c)	do { if ((_c) < UINT16_MAX) (_c)++; } while (0)
+#define uwifi_cnt_add(_c, _v)	do { uint32_t _s = (uint32_t)(_c) + (_v); \
+				     (_c) = _s > UINT16_MAX ? UINT16_MAX : _s; } while (0)
+#else
+typedef unsigned int		uwifi_cnt_t;
+typedef int			uwifi_sig_t;
+#define uwifi_cnt_inc(_c)	(_c)++
+#define uwifi_cnt_add(_c, _v)	(_c) += (_v)
+#endif
+
 struct uwifi_node {
 	/* housekeeping */
 	struct cc_list_node	list;								// X
 	struct cc_list_node	essid_nodes;
+#if !UWIFI_STATIC_TABLES
 	struct cc_list_head	on_channels;	/* channels this node was seen on */
+#endif
 	struct cc_list_head	ap_nodes;	/* stations associated to AP */
 	struct cc_list_node	ap_list;
 	struct uwifi_node*	ap_node;
-	unsigned int		num_on_channels;
+#if !UWIFI_STATIC_TABLES
+	uwifi_cnt_t		num_on_channels;
+#endif
 	uint32_t		last_seen;	/* timestamp */					// X uint32
 
 	/* general packet info */
 	unsigned int		pkt_types;	/* bitmask of packet types we've seen */
-	unsigned int		pkt_count;	/* nr of packets seen */
-	unsigned int		rx_pkt_count;   /* nr of packets seen */
+	uwifi_cnt_t		pkt_count;	/* nr of packets seen */
+	uwifi_cnt_t		rx_pkt_count;   /* nr of packets seen */
 	int			rx_only;
 
 	/* wlan phy (from radiotap) */
 	unsigned int		phy_rate_last;
-	int			phy_sig_last;
-	int			phy_sig_max;
+	uwifi_sig_t		phy_sig_last;
+	uwifi_sig_t		phy_sig_max;
 	struct ewma		phy_sig_avg;
 	unsigned long		phy_sig_sum;							// X
-	int			phy_sig_count;							// X
+	uwifi_cnt_t		phy_sig_count;							// X
+#if UWIFI_NODE_STATS
+	struct uwifi_stat	phy_sig_stat;	/* min, max, mean, variance */
+	struct uwifi_tewma	phy_sig_tavg;	/* decays with time, not per packet */
+#endif
+	uwifi_sig_t		phy_noise_last;
+	struct ewma		phy_snr_avg;
+	unsigned char		phy_chains;	/* bitmask of chains seen */
+	signed char		phy_chain_sig_last[UWIFI_MAX_CHAINS];
+#if UWIFI_NODE_STATS
+	struct ewma		phy_chain_sig_avg[UWIFI_MAX_CHAINS];
+	struct ewma		phy_chain_noise_avg[UWIFI_MAX_CHAINS];
+#endif
 
 	/* wlan mac */
 	unsigned char		wlan_src[WLAN_MAC_LEN];	/* Sender MAC address (ID) */		// X
@@ -54,21 +96,32 @@ struct uwifi_node {
 	unsigned int		wlan_mode;	/* AP, STA or IBSS */				// X
 	uint64_t		wlan_tsf;
 	unsigned int		wlan_bintval;
-	unsigned int		wlan_retries_all;
-	unsigned int		wlan_retries_last;
+	uwifi_cnt_t		wlan_retries_all;
+	uwifi_cnt_t		wlan_retries_last;
 	unsigned int		wlan_seqno;
+	uint32_t		wlan_fingerprint; /* of probe requests */
 	struct essid_info*	essid;
+#if UWIFI_NODE_PROBED
+	struct uwifi_ssid_set	probed;		/* SSIDs in directed probe requests */
+#endif
+#if UWIFI_INTERFERENCE
+	struct uwifi_intf_ap	intf;		/* interference estimator, for APs */
+#endif
+#if UWIFI_INVENTORY
+	struct uwifi_inv_node	inv;		/* capability inventory */
+#endif
 	enum uwifi_chan_width	wlan_chan_width;
 	unsigned char		wlan_tx_streams;
 	unsigned char		wlan_rx_streams;
 	enum uwifi_80211_std	wlan_std;
 
 	unsigned int		wlan_wep:1,	/* WEP active? */
-				wlan_wpa:1,
+				wlan_wpa:1,	/* AP: beacon, STA: (re)assoc request */
 				wlan_rsn:1,
-				wlan_ht40plus:1;
-
+				wlan_ht40plus:1,
+				phy_sig_tavg_pkt:1; /* phy_sig_tavg uses packet time */
 
+#if !UWIFI_STATIC_TABLES
 	/* batman */
 	unsigned char		bat_gw:1;
 
@@ -77,6 +130,7 @@ struct uwifi_node {
 	unsigned int		olsr_count;	/* number of OLSR packets */
 	unsigned int		olsr_neigh;	/* number if OLSR neighbours */
 	unsigned int		olsr_tc;	/* unused */
+#endif
 };
 
 struct uwifi_node* uwifi_node_update(struct uwifi_packet* p,
@@ -88,6 +142,45 @@ void uwifi_nodes_timeout(struct cc_list_head* nodes, unsigned int timeout_sec,
 			 uint32_t* last_nodetimeout);
 void uwifi_nodes_free(struct cc_list_head* nodes);
 
+/* number of callbacks which can be registered */
+#define UWIFI_NODE_MAX_REMOVE_CBS	4
+
+/* called before a node of the list it was added for is removed, by timeout,
+ * replacement or free */
+typedef void (*uwifi_node_remove_cb)(struct uwifi_node* n, void* ctx);
+
+bool uwifi_nodes_add_remove_cb(const struct cc_list_head* nodes,
+			       uwifi_node_remove_cb cb, void* ctx);
+void uwifi_nodes_del_remove_cb(const struct cc_list_head* nodes,
+			       uwifi_node_remove_cb cb, void* ctx);
+
+/* add the values of @src, which are newer, to @dst, which keeps its SSIDs
+ * in @ssids */
+void uwifi_node_merge(struct uwifi_node* dst, struct uwifi_ssid_table* ssids,
+		      const struct uwifi_node* src);
+
+/**
+ * uwifi_nodes_reduce() - fold a per-thread node list into a global one
+ * @global: global view
+ * @ssids: SSID table of @global, the one of @shard may differ
+ * @shard: node list which is only updated by one thread
+ *
+ * For multi-threaded capture each thread keeps its own node list, so the
+ * hot path does not share any cache lines between threads. Periodically,
+ * each thread (or a thread which can stop the workers) calls this to add
+ * what its nodes have seen since the last call to the global list. The
+ * statistics and probed SSIDs of @shard are reset afterwards, so every
+ * packet is only counted once, while the identity of the nodes is kept.
+ * Only the global list needs a lock, held by the caller during this call.
+ * Expire nodes of both lists with uwifi_nodes_timeout() as usual. ESSIDs
+ * are not merged. See uwifi_ssid_set_add() for the SSID node counts.
+ *
+ * With UWIFI_STATIC_TABLES all lists share one node pool which is not
+ * thread safe.
+ */
+void uwifi_nodes_reduce(struct cc_list_head* global, struct uwifi_ssid_table* ssids,
+			struct cc_list_head* shard);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,54 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_PROBES_H_
+#define _UWIFI_PROBES_H_
+
+/*
+ * USDT static tracepoints (make USDT=1, needs sys/sdt.h from systemtap).
+ * Each probe is a single NOP until a tracer attaches, e.g.:
+ *
+ *   bpftrace -e 'usdt:libuwifi.so:libuwifi:chan_switch_end { @[arg0] = hist(arg2); }'
+ *
+ * Probes and arguments (MACs are pointers to 6 bytes):
+ *
+ *   frame_rx		fd, length, kernel timestamp (nsec) or 0
+ *   frame_parse	result, frame type, TA MAC, signal
+ *   node_create	MAC, rx_only
+ *   node_expire	MAC, usec since last seen
+ *   node_evict		MAC, usec since last seen (static tables full)
+ *   essid_change	node MAC, ESSID string, nodes in ESSID
+ *   chan_switch_start	freq, width
+ *   chan_switch_end	channel index, freq, latency (usec), success
+ *   inject		fd, length, result
+ *
+ * Without USDT=1 the macros compile to nothing.
+ */
+
+#if UWIFI_USDT
+
+#include <sys/sdt.h>
+
+#define UWIFI_PROBE(_n)			DTRACE_PROBE(libuwifi, _n)
+#define UWIFI_PROBE1(_n, a)		DTRACE_PROBE1(libuwifi, _n, a)
+#define UWIFI_PROBE2(_n, a, b)		DTRACE_PROBE2(libuwifi, _n, a, b)
+#define UWIFI_PROBE3(_n, a, b, c)	DTRACE_PROBE3(libuwifi, _n, a, b, c)
+#define UWIFI_PROBE4(_n, a, b, c, d)	DTRACE_PROBE4(libuwifi, _n, a, b, c, d)
+
+#else
+
+#define UWIFI_PROBE(_n)			do { } while (0)
+#define UWIFI_PROBE1(_n, a)		do { } while (0)
+#define UWIFI_PROBE2(_n, a, b)		do { } while (0)
+#define UWIFI_PROBE3(_n, a, b, c)	do { } while (0)
+#define UWIFI_PROBE4(_n, a, b, c, d)	do { } while (0)
+
+#endif
+
+#endif
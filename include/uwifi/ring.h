@@ -0,0 +1,99 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_RING_H_
+#define _UWIFI_RING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Lock-free single producer, single consumer ring of fixed size slots.
+ *
+ * The producer (e.g. an RX callback or interrupt) and the consumer (a task or
+ * thread) each only write their own index, so no locks are needed. Slots are
+ * written and read in place: get a slot with _begin(), fill or use it, then
+ * hand it over with _commit(). Storage is provided by the caller.
+ */
+struct uwifi_ring {
+	unsigned char*	buf;
+	uint32_t	slot_size;
+	uint32_t	mask;		/* number of slots - 1 */
+	uint32_t	head;		/* next slot to write, written by producer */
+	uint32_t	tail;		/* next slot to read, written by consumer */
+	uint32_t	drops;		/* ring was full, written by producer */
+};
+
+/* @num_slots has to be a power of 2 */
+static inline bool uwifi_ring_init(struct uwifi_ring* r, void* buf,
+				   uint32_t slot_size, uint32_t num_slots)
+{
+	if (!is_power_of_2(num_slots))
+		return false;
+	r->buf = (unsigned char*)buf;
+	r->slot_size = slot_size;
+	r->mask = num_slots - 1;
+	r->head = r->tail = r->drops = 0;
+	return true;
+}
+
+/* producer: return free slot or NULL (and count a drop) if full */
+static inline void* uwifi_ring_produce_begin(struct uwifi_ring* r)
+{
+	uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	if (r->head - tail > r->mask) {
+		r->drops++;
+		return NULL;
+	}
+	return r->buf + (r->head & r->mask) * r->slot_size;
+}
+
+/* producer: make slot from uwifi_ring_produce_begin() visible */
+static inline void uwifi_ring_produce_commit(struct uwifi_ring* r)
+{
+	__atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+}
+
+/* consumer: return oldest used slot or NULL if empty */
+static inline void* uwifi_ring_consume_begin(struct uwifi_ring* r)
+{
+	uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	if (head == r->tail)
+		return NULL;
+	return r->buf + (r->tail & r->mask) * r->slot_size;
+}
+
+/* consumer: release slot from uwifi_ring_consume_begin() */
+static inline void uwifi_ring_consume_commit(struct uwifi_ring* r)
+{
+	__atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t uwifi_ring_count(struct uwifi_ring* r)
+{
+	return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) -
+		__atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+}
+
+static inline uint32_t uwifi_ring_drops(struct uwifi_ring* r)
+{
+	return __atomic_load_n(&r->drops, __ATOMIC_RELAXED);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,173 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_SSID_H_
+#define _UWIFI_SSID_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util.h"
+#include "wlan80211.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Interned SSIDs: each distinct SSID is stored once and referred to by a
+ * small integer ID, 0 means none. SSIDs are up to 32 bytes of any value,
+ * including NUL and UTF-8, so they are kept as length and bytes. Entries
+ * are found by hash of length and bytes, and are reference counted by the
+ * structures which keep the ID.
+ * When the table is full, an entry without references is reused, so an ID
+ * without a reference is only valid until the next uwifi_ssid_intern().
+ *
+ * The table is owned by the caller and passed to the parser and to
+ * uwifi_essids_update(). It can be used by one thread, or shared by several
+ * with a lock set by uwifi_ssid_table_set_lock(). Worker threads with their
+ * own node lists should rather have a table each, so the parser takes no
+ * lock, uwifi_nodes_reduce() interns the SSIDs again in the table of the
+ * global list. Entries which are referenced do not change, so they can be
+ * read without the lock.
+ */
+
+#ifndef UWIFI_MAX_SSIDS
+#if UWIFI_STATIC_TABLES
+#define UWIFI_MAX_SSIDS		16
+#else
+#define UWIFI_MAX_SSIDS		1024
+#endif
+#endif
+
+/* number of SSIDs probed for which are kept per node */
+#ifndef UWIFI_SSID_SET_SIZE
+#if UWIFI_STATIC_TABLES
+#define UWIFI_SSID_SET_SIZE	4
+#else
+#define UWIFI_SSID_SET_SIZE	8
+#endif
+#endif
+
+struct uwifi_ssid {
+	uint32_t	hash;
+	uint16_t	next;		/* hash chain or free list */
+	uint16_t	ref;		/* references to the ID */
+	uint16_t	nodes;		/* sets of this table holding it */
+	uint32_t	probes;		/* number of probe requests for it */
+	uint8_t		len;		/* 0: unused */
+	union {
+		/* zero padded and terminated, but may contain NUL */
+		char		ssid[WLAN_MAX_SSID_LEN + 1];
+		uint64_t	words[WLAN_MAX_SSID_LEN / 8 + 1];
+	};
+};
+
+/* entries of the BSSID to SSID cache for hidden SSIDs, power of 2 */
+#ifndef UWIFI_SSID_CACHE_SIZE
+#if UWIFI_STATIC_TABLES
+#define UWIFI_SSID_CACHE_SIZE	16
+#else
+#define UWIFI_SSID_CACHE_SIZE	256
+#endif
+#endif
+
+typedef void (*uwifi_ssid_lock_cb)(void* ctx);
+
+/* direct mapped, entries reference the ID */
+struct uwifi_ssid_bssid {
+	unsigned char		bssid[WLAN_MAC_LEN];
+	uint16_t		id;
+};
+
+struct uwifi_ssid_table {
+	struct uwifi_ssid	ssids[UWIFI_MAX_SSIDS];
+	uint16_t		buckets[UWIFI_MAX_SSIDS];	/* first ID of chain */
+	uint16_t		free;				/* first free ID */
+	unsigned int		reclaim;			/* next entry checked for reuse */
+	struct uwifi_ssid_bssid	bssids[UWIFI_SSID_CACHE_SIZE];	/* SSID of BSSID */
+	uwifi_ssid_lock_cb	lock;
+	uwifi_ssid_lock_cb	unlock;
+	void*			lock_ctx;
+};
+
+void uwifi_ssid_table_init(struct uwifi_ssid_table* t);
+
+/* for a table shared by threads, called around every change */
+void uwifi_ssid_table_set_lock(struct uwifi_ssid_table* t, uwifi_ssid_lock_cb lock,
+			       uwifi_ssid_lock_cb unlock, void* ctx);
+
+/* ID for @len bytes of @ssid, 0 if empty or the table is full */
+uint16_t uwifi_ssid_intern(struct uwifi_ssid_table* t, const void* ssid,
+			   unsigned int len);
+
+/**
+ * uwifi_ssid_hold() - referenced ID for an SSID
+ * @id: ID from the parser, used if it still refers to @ssid
+ *
+ * Unreferenced IDs, like the ones in parsed packets, may be reused by
+ * another thread, so this checks @id and interns again if needed. Release
+ * the ID with uwifi_ssid_unref().
+ */
+uint16_t uwifi_ssid_hold(struct uwifi_ssid_table* t, uint16_t id,
+			 const void* ssid, unsigned int len);
+
+/* entry of @id, or NULL; IDs go from 1 to UWIFI_MAX_SSIDS */
+struct uwifi_ssid* uwifi_ssid_get(struct uwifi_ssid_table* t, uint16_t id);
+
+void uwifi_ssid_ref(struct uwifi_ssid_table* t, uint16_t id);
+void uwifi_ssid_unref(struct uwifi_ssid_table* t, uint16_t id);
+
+/* count a probe request for @id */
+void uwifi_ssid_count_probe(struct uwifi_ssid_table* t, uint16_t id);
+
+/* remember @id as SSID of @bssid, for hidden SSIDs */
+void uwifi_ssid_bssid_put(struct uwifi_ssid_table* t, const unsigned char* bssid,
+			  uint16_t id);
+
+/* referenced ID of the SSID last seen for @bssid, or 0 */
+uint16_t uwifi_ssid_bssid_hold(struct uwifi_ssid_table* t, const unsigned char* bssid);
+
+/* set of SSID IDs, e.g. the preferred network list of a client */
+struct uwifi_ssid_set {
+	struct uwifi_ssid_table* table;		/* of the IDs, NULL when empty */
+	uint16_t	ids[UWIFI_SSID_SET_SIZE];
+	uint8_t		num;
+	uint8_t		next;		/* replaced when full */
+};
+
+bool uwifi_ssid_set_has(const struct uwifi_ssid_set* s, uint16_t id);
+
+/*
+ * Add @id of @t to @s and count the node for it, returns false if it was
+ * there. All IDs of a set are from the same table.
+ *
+ * The node count of an entry is the number of sets of its table holding
+ * it, so it is the number of clients only when every client has one node
+ * using the table. With uwifi_nodes_reduce() give the global list a table of
+ * its own: the table of a worker then counts its clients since the last
+ * reduce, the global one each client once. If both share a table, clients
+ * are counted twice until the next reduce.
+ */
+bool uwifi_ssid_set_add(struct uwifi_ssid_set* s, struct uwifi_ssid_table* t,
+			uint16_t id);
+
+/* add all SSIDs of @src to @dst, which uses @t, interned again if @src uses
+ * another table */
+void uwifi_ssid_set_merge(struct uwifi_ssid_set* dst, struct uwifi_ssid_table* t,
+			  const struct uwifi_ssid_set* src);
+
+/* remove all IDs */
+void uwifi_ssid_set_clear(struct uwifi_ssid_set* s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_STATS_H_
+#define _UWIFI_STATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed-point statistics which need no allocation and no floating point,
+ * so they can be used on ESP as well:
+ *
+ * uwifi_stat	count, min, max, mean and variance (Welford's algorithm)
+ * uwifi_tewma	EWMA decaying with elapsed time instead of per sample
+ * uwifi_sketch	log-linear histogram for approximate quantiles
+ *
+ * All of them can be merged, e.g. to combine per-thread or per-node values.
+ */
+
+/*** min/max/mean/variance ***/
+
+/*
+ * Values have to be within +/- UWIFI_STAT_MAX_VAL and there have to be less
+ * than 2^32 of them. m2 grows with the number of samples times the squared
+ * spread of the values and is exact as long as count * (max - min)^2 < 2^58,
+ * e.g. for 2^32 samples with a spread below 8192 (like signal in dBm), but
+ * only 4096 samples when using the full range. Beyond that m2 saturates, so
+ * the variance is too large, but not garbage.
+ */
+#define UWIFI_STAT_MAX_VAL	(1 << 22)
+
+struct uwifi_stat {
+	uint32_t	count;
+	int32_t		min;
+	int32_t		max;
+	int64_t		sum;	/* exact, the mean would stop moving */
+	int64_t		mean;	/* Q8, rounded sum / count */
+	uint64_t	m2;	/* sum of squared differences from mean, Q8 */
+};
+
+void uwifi_stat_init(struct uwifi_stat* s);
+void uwifi_stat_add(struct uwifi_stat* s, int32_t v);
+
+/* add @b to @a, the result is the same as if all samples were added to @a */
+void uwifi_stat_merge(struct uwifi_stat* a, const struct uwifi_stat* b);
+
+/* rounded mean */
+int32_t uwifi_stat_mean(const struct uwifi_stat* s);
+
+/* sample variance and standard deviation, Q8 */
+uint64_t uwifi_stat_var_q8(const struct uwifi_stat* s);
+uint32_t uwifi_stat_stddev_q8(const struct uwifi_stat* s);
+
+/*** time decayed EWMA ***/
+
+/*
+ * The weight of old samples decays with exp(-dt/tau), regardless of how many
+ * samples arrive in between, so a burst of samples does not dominate a later
+ * single sample. Samples at the same time get equal weight. The total weight
+ * is limited to UWIFI_TEWMA_MAX_WEIGHT samples. Time is in any unit, usually
+ * usec from plat_time_usec(), and may wrap, but has to have the same base for
+ * all samples. Samples out of order don't decay the older ones. The decay
+ * comes from a fixed-point table, no exp() is needed.
+ */
+#define UWIFI_TEWMA_MAX_WEIGHT	1024
+
+struct uwifi_tewma {
+	int64_t		sum;		/* weighted sum of samples, Q16 weights */
+	uint32_t	weight;		/* sum of weights, Q16 */
+	uint32_t	last;		/* time of last sample */
+	uint32_t	tau;		/* time constant */
+};
+
+void uwifi_tewma_init(struct uwifi_tewma* t, uint32_t tau);
+void uwifi_tewma_add(struct uwifi_tewma* t, int32_t v, uint32_t time);
+
+/* add @b to @a, both decayed to the time of the later sample */
+void uwifi_tewma_merge(struct uwifi_tewma* a, const struct uwifi_tewma* b);
+
+/* rounded average, 0 without samples */
+int32_t uwifi_tewma_read(const struct uwifi_tewma* t);
+
+/*** quantile sketch ***/
+
+/*
+ * Values below 2^UWIFI_SKETCH_SUB_BITS have their own bucket, above that
+ * each power of 2 is split into 2^UWIFI_SKETCH_SUB_BITS buckets. Bucket
+ * counts are 16 bit, when one would overflow all are halved, which keeps
+ * the distribution but reduces precision of the counts.
+ */
+#ifndef UWIFI_SKETCH_SUB_BITS
+#define UWIFI_SKETCH_SUB_BITS	3
+#endif
+#define UWIFI_SKETCH_SUB	(1 << UWIFI_SKETCH_SUB_BITS)
+#define UWIFI_SKETCH_BUCKETS	((32 - UWIFI_SKETCH_SUB_BITS + 1) * UWIFI_SKETCH_SUB)
+
+/* bucket of a value, also used by the latency histograms of counters.h */
+static inline unsigned int uwifi_sketch_bucket(uint32_t v)
+{
+	if (v < UWIFI_SKETCH_SUB)
+		return v;
+	unsigned int msb = 31 - __builtin_clz(v);
+	return (msb - UWIFI_SKETCH_SUB_BITS + 1) * UWIFI_SKETCH_SUB +
+		((v >> (msb - UWIFI_SKETCH_SUB_BITS)) & (UWIFI_SKETCH_SUB - 1));
+}
+
+/* lowest value of a bucket */
+uint64_t uwifi_sketch_bucket_low(unsigned int idx);
+
+struct uwifi_sketch {
+	uint32_t	count;		/* sum of buckets */
+	uint8_t		shift;		/* number of times counts were halved */
+	uint16_t	buckets[UWIFI_SKETCH_BUCKETS];
+};
+
+void uwifi_sketch_init(struct uwifi_sketch* s);
+void uwifi_sketch_add(struct uwifi_sketch* s, uint32_t v);
+void uwifi_sketch_merge(struct uwifi_sketch* a, const struct uwifi_sketch* b);
+
+/* approximate value below which @permille of the samples are */
+uint32_t uwifi_sketch_quantile(const struct uwifi_sketch* s, unsigned int permille);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_TELEMETRY_H_
+#define _UWIFI_TELEMETRY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cc_list.h"
+#include "util.h"
+#include "wlan80211.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Compact binary encoding of node, ESSID and channel state for slow links.
+ *
+ * Each message starts with version, flags and a sequence number, followed
+ * by records. Only the fields which changed since the last message are sent,
+ * numbers as varints. MAC addresses and ESSIDs are sent once to define a
+ * dictionary slot and are referred to by slot index afterwards. When the
+ * dictionary is full the slots are reused round-robin, so it should be
+ * larger than the number of nodes and BSSIDs. See telemetry.c for the
+ * exact format.
+ *
+ * The encoder keeps the last sent state, the decoder only the dictionaries,
+ * applications apply the decoded changes to their own state. As messages
+ * may get lost, uwifi_telem_enc_reset() should be called periodically.
+ */
+
+#define UWIFI_TELEM_VERSION	1
+
+#ifndef UWIFI_TELEM_MAX_MACS
+#define UWIFI_TELEM_MAX_MACS	64
+#endif
+#ifndef UWIFI_TELEM_MAX_ESSIDS
+#define UWIFI_TELEM_MAX_ESSIDS	16
+#endif
+#ifndef UWIFI_TELEM_MAX_CHANS
+#define UWIFI_TELEM_MAX_CHANS	32
+#endif
+
+/* message flags */
+#define UWIFI_TELEM_FLAG_RESET	BIT(0)	/* full state, decoder clears dictionaries */
+#define UWIFI_TELEM_FLAG_MORE	BIT(1)	/* buffer was full, more changes pending */
+
+/* node fields */
+#define UWIFI_TELEM_F_PKTS	BIT(0)	/* packets since last message */
+#define UWIFI_TELEM_F_RETRIES	BIT(1)	/* retries since last message */
+#define UWIFI_TELEM_F_SIG	BIT(2)
+#define UWIFI_TELEM_F_SIG_AVG	BIT(3)
+#define UWIFI_TELEM_F_SIG_MAX	BIT(4)
+#define UWIFI_TELEM_F_MODE	BIT(5)
+#define UWIFI_TELEM_F_CHANNEL	BIT(6)
+#define UWIFI_TELEM_F_STD	BIT(7)
+#define UWIFI_TELEM_F_WIDTH	BIT(8)
+#define UWIFI_TELEM_F_FLAGS	BIT(9)
+#define UWIFI_TELEM_F_BSSID	BIT(10)
+#define UWIFI_TELEM_F_ESSID	BIT(11)
+
+/* node flags (UWIFI_TELEM_F_FLAGS) */
+#define UWIFI_TELEM_NF_WEP	BIT(0)
+#define UWIFI_TELEM_NF_WPA	BIT(1)
+#define UWIFI_TELEM_NF_RSN	BIT(2)
+#define UWIFI_TELEM_NF_HT40PLUS	BIT(3)
+#define UWIFI_TELEM_NF_RX_ONLY	BIT(4)
+
+/* set in the type of the first record for a node or ESSID slot, all fields
+ * which are not sent are 0 (ESSID -1) and counters are absolute */
+#define UWIFI_TELEM_REC_NEW	0x80
+
+enum uwifi_telem_rec_type {
+	UWIFI_TELEM_NODE	= 1,
+	UWIFI_TELEM_NODE_DEL	= 2,
+	UWIFI_TELEM_ESSID	= 3,
+	UWIFI_TELEM_ESSID_DEL	= 4,
+	UWIFI_TELEM_CHAN	= 5,
+};
+
+/* node values as sent */
+struct uwifi_telem_node {
+	uint32_t	pkts;
+	uint32_t	retries;
+	int8_t		sig;
+	int8_t		sig_avg;
+	int8_t		sig_max;
+	uint8_t		mode;
+	uint8_t		channel;
+	uint8_t		std;
+	uint8_t		width;
+	uint8_t		flags;
+	uint8_t		bssid[WLAN_MAC_LEN];
+	int		essid;		/* ESSID slot or -1 */
+};
+
+struct uwifi_telem_essid {
+	char		essid[WLAN_MAX_SSID_LEN];	/* not NUL terminated */
+	uint8_t		essid_len;
+	uint16_t	num_nodes;
+	bool		split;
+};
+
+struct uwifi_telem_chan {
+	uint8_t		channel;
+	uint16_t	num_nodes;
+	uint16_t	num_aps;
+};
+
+/* encoder state */
+
+struct uwifi_telem_mac_slot {
+	unsigned char		mac[WLAN_MAC_LEN];
+	bool			used;
+	bool			is_node;	/* has node state */
+	bool			seen;		/* node still exists */
+	struct uwifi_telem_node	last;
+	uint32_t		pkt_count;	/* counters of node at last message */
+	uint32_t		retries_all;
+};
+
+struct uwifi_telem_essid_slot {
+	bool			used;
+	bool			seen;
+	struct uwifi_telem_essid last;
+};
+
+struct uwifi_telem_enc {
+	uint16_t			seq;
+	bool				reset;
+	unsigned int			next_mac;
+	unsigned int			next_essid;
+	struct uwifi_telem_mac_slot	macs[UWIFI_TELEM_MAX_MACS];
+	struct uwifi_telem_essid_slot	essids[UWIFI_TELEM_MAX_ESSIDS];
+	struct uwifi_telem_chan		chans[UWIFI_TELEM_MAX_CHANS];
+	int				num_chans;
+};
+
+void uwifi_telem_enc_init(struct uwifi_telem_enc* enc);
+
+/* next message will contain the full state */
+void uwifi_telem_enc_reset(struct uwifi_telem_enc* enc);
+
+/**
+ * uwifi_telem_encode() - encode changes since the last message
+ * @nodes: node list
+ * @essids: ESSID list or NULL
+ *
+ * Returns the message length or -1 if @len is too small for even one record.
+ * If not all changes fit, UWIFI_TELEM_FLAG_MORE is set in the message and the
+ * remaining changes are sent with the next call.
+ */
+int uwifi_telem_encode(struct uwifi_telem_enc* enc, struct cc_list_head* nodes,
+		       struct cc_list_head* essids, unsigned char* buf, size_t len);
+
+/* decoder */
+
+struct uwifi_telem_rec {
+	enum uwifi_telem_rec_type	type;
+	uint32_t			fields;		/* UWIFI_TELEM_F_* for nodes */
+	bool				is_new;		/* first record for this slot */
+	int				slot;		/* dictionary slot */
+	const unsigned char*		mac;		/* nodes */
+	struct uwifi_telem_node		node;
+	struct uwifi_telem_essid	essid;
+	struct uwifi_telem_chan		chan;
+};
+
+typedef void (*uwifi_telem_cb)(const struct uwifi_telem_rec* rec, void* ctx);
+
+struct uwifi_telem_dec {
+	uint16_t	seq;
+	bool		synced;
+	uint32_t	lost;		/* messages lost, from sequence numbers */
+	unsigned char	macs[UWIFI_TELEM_MAX_MACS][WLAN_MAC_LEN];
+	bool		mac_valid[UWIFI_TELEM_MAX_MACS];
+	bool		mac_is_node[UWIFI_TELEM_MAX_MACS];
+	bool		essid_valid[UWIFI_TELEM_MAX_ESSIDS];
+	bool		essid_is_set[UWIFI_TELEM_MAX_ESSIDS];	/* told the application */
+	uint8_t		chans[UWIFI_TELEM_MAX_CHANS];		/* told the application */
+	int		num_chans;
+};
+
+void uwifi_telem_dec_init(struct uwifi_telem_dec* dec);
+
+/**
+ * uwifi_telem_decode() - decode message and call @cb for each record
+ *
+ * Returns the message flags or -1 for a malformed message or unknown version.
+ * After lost messages, records referring to unknown dictionary slots are
+ * skipped until they are defined again or a reset message arrives. When a
+ * slot holding a node is redefined, a UWIFI_TELEM_NODE_DEL record for the
+ * old node is generated. A reset message first generates deletions for all
+ * nodes and ESSIDs and empty channel records for all channels which were
+ * reported before, so afterwards the application has the encoder state.
+ */
+int uwifi_telem_decode(struct uwifi_telem_dec* dec, const unsigned char* buf,
+		       size_t len, uwifi_telem_cb cb, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_TIMESTAMP_H_
+#define _UWIFI_TIMESTAMP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Linear mapping from the MAC TSF (usec, from radiotap TSFT) of one radio to
+ * host time (nsec, from the kernel RX timestamp). See timestamp.c.
+ */
+struct uwifi_tsf_map {
+	uint64_t	tsf_ref;	/* TSF of reference point */
+	int64_t		off_ref;	/* host - TSF offset at reference (nsec) */
+	int32_t		drift_ppb;	/* host clock rate relative to TSF */
+	uint64_t	win_start;	/* TSF at start of current window */
+	uint64_t	win_tsf;	/* TSF where window minimum was seen */
+	int64_t		win_off;	/* minimum offset in current window */
+	uint64_t	last_tsf;
+	unsigned int	num_windows;
+	bool		valid;
+};
+
+void uwifi_tsf_map_reset(struct uwifi_tsf_map* m);
+void uwifi_tsf_map_update(struct uwifi_tsf_map* m, uint64_t tsf, uint64_t host_ns);
+uint64_t uwifi_tsf_map_to_host(const struct uwifi_tsf_map* m, uint64_t tsf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
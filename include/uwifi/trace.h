@@ -0,0 +1,121 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_TRACE_H_
+#define _UWIFI_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary trace ring for the per-frame debug messages (make TRACE=1).
+ *
+ * Instead of formatting with log_out(), UWIFI_TRACE() only stores a pointer
+ * to the format string and up to UWIFI_TRACE_MAX_ARGS integer arguments in a
+ * lock-free ring. Formatting happens later when the application calls
+ * uwifi_trace_drain(), e.g. from a separate thread. Levels can be changed per
+ * subsystem at runtime, so tracing can stay compiled in.
+ *
+ * Restrictions: arguments are stored as int, so no strings, pointers or
+ * floats, and format strings must be literals. Wider arguments, e.g. a TSF,
+ * and more than UWIFI_TRACE_MAX_ARGS fail to compile. Records should only be
+ * written from one thread (the one receiving and parsing packets).
+ *
+ * Without TRACE=1 the macros are the same as LOG_DBG() and friends.
+ */
+
+enum uwifi_trace_subsys {
+	UWIFI_TR_WLAN,		/* 802.11 parser */
+	UWIFI_TR_RADIOTAP,	/* radiotap and prism headers */
+	UWIFI_TR_NODE,
+	UWIFI_TR_ESSID,
+	UWIFI_TR_CHANNEL,
+	UWIFI_TR_MAX
+};
+
+#define UWIFI_TRACE_MAX_ARGS	8
+
+#ifndef UWIFI_TRACING
+#define UWIFI_TRACING		0
+#endif
+
+#if UWIFI_TRACING
+
+/* current level per subsystem, messages above it are not recorded */
+extern uint8_t uwifi_trace_level[UWIFI_TR_MAX];
+
+void uwifi_trace_rec(enum uwifi_trace_subsys ss, enum loglevel ll,
+		     const char* fmt, const int* args, unsigned int nargs);
+
+/* compile error for arguments which would be truncated, "+ 0" promotes
+ * bit fields which sizeof can not be applied to */
+#define _UWIFI_TR_C(_a)		(void)sizeof(char[sizeof((_a) + 0) <= sizeof(int) ? 1 : -1]);
+#define _UWIFI_TR_C0(_z)
+#define _UWIFI_TR_C1(_z, _a)	_UWIFI_TR_C(_a)
+#define _UWIFI_TR_C2(_z, _a, ...) _UWIFI_TR_C(_a) _UWIFI_TR_C1(_z, __VA_ARGS__)
+#define _UWIFI_TR_C3(_z, _a, ...) _UWIFI_TR_C(_a) _UWIFI_TR_C2(_z, __VA_ARGS__)
+#define _UWIFI_TR_C4(_z, _a, ...) _UWIFI_TR_C(_a) _UWIFI_TR_C3(_z, __VA_ARGS__)
+#define _UWIFI_TR_C5(_z, _a, ...) _UWIFI_TR_C(_a) _UWIFI_TR_C4(_z, __VA_ARGS__)
+#define _UWIFI_TR_C6(_z, _a, ...) _UWIFI_TR_C(_a) _UWIFI_TR_C5(_z, __VA_ARGS__)
+#define _UWIFI_TR_C7(_z, _a, ...) _UWIFI_TR_C(_a) _UWIFI_TR_C6(_z, __VA_ARGS__)
+#define _UWIFI_TR_C8(_z, _a, ...) _UWIFI_TR_C(_a) _UWIFI_TR_C7(_z, __VA_ARGS__)
+#define _UWIFI_TR_SEL(_0, _1, _2, _3, _4, _5, _6, _7, _8, _n, ...) _n
+#define _UWIFI_TR_CHECK(...)							\
+	_UWIFI_TR_SEL(__VA_ARGS__, _UWIFI_TR_C8, _UWIFI_TR_C7, _UWIFI_TR_C6,	\
+		      _UWIFI_TR_C5, _UWIFI_TR_C4, _UWIFI_TR_C3, _UWIFI_TR_C2,	\
+		      _UWIFI_TR_C1, _UWIFI_TR_C0)(__VA_ARGS__)
+
+#define UWIFI_TRACE(_ss, _ll, _fmt, ...) do {					\
+	_UWIFI_TR_CHECK(0, ##__VA_ARGS__)					\
+	if ((_ll) <= uwifi_trace_level[_ss]) {					\
+		int _args[] = { 0, ##__VA_ARGS__ };				\
+		uwifi_trace_rec(_ss, _ll, _fmt, _args + 1,			\
+				sizeof(_args) / sizeof(int) - 1);		\
+	}									\
+	if (0) /* format check only */						\
+		log_out(_ll, _fmt, ##__VA_ARGS__);				\
+} while (0)
+
+/**
+ * uwifi_trace_init() - allocate trace ring
+ * @num_records: size of ring, has to be a power of 2
+ */
+bool uwifi_trace_init(unsigned int num_records);
+void uwifi_trace_free(void);
+
+void uwifi_trace_set_level(enum uwifi_trace_subsys ss, enum loglevel ll);
+
+/* format and output up to @max records thru log_out(), returns number */
+unsigned int uwifi_trace_drain(unsigned int max);
+
+/* records lost because the ring was full */
+uint32_t uwifi_trace_drops(void);
+
+#else
+
+#define UWIFI_TRACE(_ss, _ll, ...) do {						\
+	if (DEBUG || (_ll) < LL_DEBUG)						\
+		log_out(_ll, __VA_ARGS__);					\
+} while (0)
+
+#endif
+
+#define UWIFI_TRACE_DBG(_ss, ...)	UWIFI_TRACE(_ss, LL_DEBUG, __VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -11,6 +11,8 @@
 #define _UWIFI_UTIL_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -27,6 +29,34 @@ extern "C" {
 #define MAC_BCAST(_mac) (_mac[0] == 0xff && _mac[1] == 0xff && _mac[2] == 0xff \
 			 && _mac[3] == 0xff && _mac[4] == 0xff && _mac[5] == 0xff)
 
+/* static tables and smaller structs for microcontrollers (make STATIC_TABLES=1),
+ * applications have to be compiled with the same setting */
+#ifndef UWIFI_STATIC_TABLES
+#define UWIFI_STATIC_TABLES	0
+#endif
+
+/* optional state in struct uwifi_node, by default only without static tables
+ * (make NODE_STATS=0 etc.), applications have to be compiled the same:
+ *   UWIFI_NODE_STATS	signal distribution, time decaying and chain averages
+ *   UWIFI_NODE_PROBED	SSIDs of directed probe requests
+ *   UWIFI_INTERFERENCE	interference estimator, needs UWIFI_NODE_STATS
+ *   UWIFI_INVENTORY	capability inventory */
+#ifndef UWIFI_NODE_STATS
+#define UWIFI_NODE_STATS	(!UWIFI_STATIC_TABLES)
+#endif
+#ifndef UWIFI_NODE_PROBED
+#define UWIFI_NODE_PROBED	(!UWIFI_STATIC_TABLES)
+#endif
+#ifndef UWIFI_INTERFERENCE
+#define UWIFI_INTERFERENCE	(!UWIFI_STATIC_TABLES)
+#endif
+#ifndef UWIFI_INVENTORY
+#define UWIFI_INVENTORY		(!UWIFI_STATIC_TABLES)
+#endif
+#if UWIFI_INTERFERENCE && !UWIFI_NODE_STATS
+#error "UWIFI_INTERFERENCE needs UWIFI_NODE_STATS"
+#endif
+
 #ifndef BIT
 #define BIT(nr) (1 << (nr))
 #endif
@@ -72,12 +102,25 @@ bool string_to_mac(const char* string, unsigned char* mac);
 
 int ilog2(int x);
 
+int utf8_valid_len(const unsigned char* s, size_t len);
+
 static inline __attribute__((const))
 int is_power_of_2(unsigned long n)
 {
 	return (n != 0 && ((n & (n - 1)) == 0));
 }
 
+/* FNV-1a hash, start with @h = FNV1A_INIT */
+#define FNV1A_INIT	2166136261U
+
+static inline uint32_t fnv1a(uint32_t h, const void* data, size_t len)
+{
+	const unsigned char* d = data;
+	while (len--)
+		h = (h ^ *d++) * 16777619U;
+	return h;
+}
+
 extern const char* UWIFI_VERSION;
 
 #ifdef __cplusplus
@@ -143,6 +143,19 @@ struct wlan_frame_beacon {
 	unsigned char	ie[0];
 } __attribute__ ((packed));
 
+struct wlan_frame_assoc_req {
+	uint16_t	capab;
+	uint16_t	listen_intval;
+	unsigned char	ie[0];
+} __attribute__ ((packed));
+
+struct wlan_frame_reassoc_req {
+	uint16_t	capab;
+	uint16_t	listen_intval;
+	unsigned char	current_ap[6];
+	unsigned char	ie[0];
+} __attribute__ ((packed));
+
 
 /*** capabilities ***/
 #define WLAN_CAPAB_ESS		0x0001
@@ -175,11 +188,14 @@ struct information_element {
 #define WLAN_IE_ID_DSSS_PARAM	3
 #define WLAN_IE_ID_HT_CAPAB	45
 #define WLAN_IE_ID_RSN		48
+#define WLAN_IE_ID_EXT_SUPP_RATES 50
 #define WLAN_IE_ID_HT_OPER	61
+#define WLAN_IE_ID_EXT_CAPAB	127
 #define WLAN_IE_ID_VHT_CAPAB	191
 #define WLAN_IE_ID_VHT_OPER	192
 #define WLAN_IE_ID_VHT_OMN	199
 #define WLAN_IE_ID_VENDOR	221
+#define WLAN_IE_ID_EXTENSION	255
 
 /* HT capability info */
 // present in Beacon, Assoc Req/Resp, Reassoc Req/Resp, Probe Req/Resp, Mesh Peering Open/Close
@@ -193,8 +209,11 @@ struct information_element {
 #define WLAN_IE_VHT_CAPAB_INFO_CHAN_WIDTH_160	1 /* 160MHz */
 #define WLAN_IE_VHT_CAPAB_INFO_CHAN_WIDTH_BOTH	2 /* 160MHz and 80+80 MHz */
 
-#define WLAN_MAX_SSID_LEN	34
+#define WLAN_MAX_SSID_LEN	32
 
 #define WLAN_MAC_LEN		6
 
+/* locally administered, e.g. randomized MAC */
+#define WLAN_MAC_IS_LOCAL(_mac)	((_mac)[0] & 0x02)
+
 #endif
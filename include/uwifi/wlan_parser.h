@@ -28,6 +28,7 @@ extern "C" {
 #define PHY_FLAG_B		BIT(3)
 #define PHY_FLAG_G		BIT(4)
 #define PHY_FLAG_MODE_MASK	0x1C
+#define PHY_FLAG_TSFT		BIT(5)	/* phy_tsf is valid */
 
 #define WLAN_MODE_AP		BIT(0)
 #define WLAN_MODE_IBSS		BIT(1)
@@ -36,6 +37,9 @@ extern "C" {
 #define WLAN_MODE_4ADDR		BIT(4)
 #define WLAN_MODE_UNKNOWN	BIT(5)
 
+/* maximum number of RX chains we keep per-chain values for */
+#define UWIFI_MAX_CHAINS	4
+
 #define WLAN_MODE_ALL		(WLAN_MODE_AP | WLAN_MODE_IBSS | WLAN_MODE_STA | WLAN_MODE_PROBE | WLAN_MODE_4ADDR | WLAN_MODE_UNKNOWN)
 
 struct uwifi_packet {
@@ -44,12 +48,18 @@ struct uwifi_packet {
 
 	/* wlan phy (from radiotap) */
 	int			phy_signal;	/* signal strength (usually dBm) */		// X
+	int			phy_noise;	/* noise (dBm), 0 if unknown */
+	unsigned char		phy_snr;	/* signal to noise ratio (dB), 0 if unknown */
+	unsigned char		phy_chains;	/* bitmask of valid per-chain values */
+	signed char		phy_chain_signal[UWIFI_MAX_CHAINS]; /* dBm per antenna */
+	signed char		phy_chain_noise[UWIFI_MAX_CHAINS];
 	unsigned int		phy_rate;	/* physical rate * 10 (=in 100kbps) */
 	unsigned char		phy_rate_idx;	/* MCS index */
 	unsigned char		phy_rate_flags;	/* MCS flags */
 	unsigned int		phy_freq;	/* frequency from driver */
 	unsigned int		phy_flags;	/* A, B, G, shortpre */
 	bool			phy_injected;	/* frame was injected by ourselves */
+	uint64_t		phy_tsf;	/* MAC timestamp (TSFT) in usec */
 
 	/* wlan mac */
 	unsigned int		wlan_len;	/* packet length */
@@ -59,7 +69,9 @@ struct uwifi_packet {
 	unsigned char		wlan_ta[WLAN_MAC_LEN]; /* transmitter (TA) */			// X
 	unsigned char		wlan_ra[WLAN_MAC_LEN]; /* receiver (RA) */
 	unsigned char		wlan_bssid[WLAN_MAC_LEN];						// X?
-	char			wlan_essid[WLAN_MAX_SSID_LEN];
+	const unsigned char*	wlan_essid;	/* SSID in the frame, not NUL terminated */
+	uint8_t			wlan_essid_len;	/* 0 if none or hidden */
+	uint16_t		wlan_essid_id;	/* interned SSID, not referenced, 0 if none */
 	uint64_t		wlan_tsf;	/* timestamp from beacon */
 	unsigned int		wlan_bintval;	/* beacon interval */
 	unsigned int		wlan_mode;	/* AP, STA or IBSS */				// X
@@ -70,6 +82,7 @@ struct uwifi_packet {
 	unsigned char		wlan_qos_class;	/* for QDATA frames */
 	unsigned int		wlan_nav;	/* frame NAV duration */
 	unsigned int		wlan_seqno;	/* sequence number */
+	uint32_t		wlan_fingerprint; /* of probe request IEs, 0 if none */
 
 	/* flags */
 	unsigned int		wlan_wep:1,	/* WEP on/off */
@@ -78,6 +91,7 @@ struct uwifi_packet {
 				wlan_rsn:1,
 				wlan_ht40plus:1;
 
+#if !UWIFI_STATIC_TABLES
 	/* batman-adv */
 	unsigned char		bat_version;
 	unsigned char		bat_packet_type;
@@ -90,6 +104,11 @@ struct uwifi_packet {
 	unsigned int		olsr_type;
 	unsigned int		olsr_neigh;
 	unsigned int		olsr_tc;
+#endif
+
+	/* receive time */
+	uint64_t		pkt_rx_time;	/* kernel RX timestamp in nsec */
+	uint64_t		pkt_time;	/* best RX time estimate in nsec */
 
 	/* calculated from other values */
 	unsigned int		pkt_duration;	/* packet "airtime" */
@@ -97,8 +116,14 @@ struct uwifi_packet {
 	int			wlan_retries;	/* retry count for this frame */
 };
 
-int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet* p);
-void uwifi_parse_information_elements(unsigned char* buf, size_t bufLen, struct uwifi_packet *p);
+struct uwifi_ssid_table;
+
+/* SSIDs are interned in @ssids, which is owned by the caller, when NULL
+ * wlan_essid_id is not set */
+int uwifi_parse_80211_header(unsigned char* buf, size_t len, struct uwifi_packet* p,
+			     struct uwifi_ssid_table* ssids);
+void uwifi_parse_information_elements(unsigned char* buf, size_t bufLen, struct uwifi_packet *p,
+				      struct uwifi_ssid_table* ssids);
 
 #ifdef __cplusplus
 }
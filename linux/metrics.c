@@ -0,0 +1,542 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "metrics.h"
+#include "node.h"
+#include "channel.h"
+#include "wlan_util.h"
+#include "platform.h"
+#include "counters.h"
+#include "log.h"
+
+#define METRICS_TIMEOUT_MS	200
+
+/* rough upper limits for output size */
+#define METRICS_OUT_BASE	16384
+#define METRICS_OUT_NODE	1536
+#define METRICS_HDR_MAX		160
+
+struct metrics_node {
+	unsigned char		mac[WLAN_MAC_LEN];
+	unsigned char		bssid[WLAN_MAC_LEN];
+	char			essid[WLAN_MAX_SSID_LEN];
+	uint8_t			essid_len;
+	uint32_t		pkts;
+	uint32_t		retries;
+	int			sig;
+	int			sig_avg;
+	int			sig_max;
+	unsigned int		channel;
+	unsigned int		mode;
+	enum uwifi_80211_std	std;
+	uint32_t		age;		/* usec since last seen */
+};
+
+struct metrics_chan {
+	int			channel;
+	unsigned int		nodes;
+	unsigned int		aps;
+};
+
+struct metrics_snap {
+	unsigned int		num_nodes_total;
+	unsigned int		num_nodes;	/* exported */
+	unsigned int		freq;
+	enum uwifi_chan_width	width;
+	unsigned int		num_chans;
+	struct metrics_chan	chans[MAX_CHANNELS];
+	struct metrics_node	nodes[];
+};
+
+struct uwifi_metrics {
+	int			fd;
+	unsigned int		max_nodes;
+	size_t			snap_size;
+	pthread_mutex_t		lock;		/* protects snap */
+	struct metrics_snap*	snap;		/* published */
+	struct metrics_snap*	build;		/* used by update */
+	struct metrics_snap*	render;		/* used by serve */
+	const struct uwifi_node** sel;		/* top-N selection */
+	char*			out;
+	size_t			out_size;
+};
+
+static int metrics_listen(const char* addr)
+{
+	int fd;
+
+	if (strncmp(addr, "unix:", 5) == 0) {
+		struct sockaddr_un sun = { .sun_family = AF_UNIX };
+		if (strlen(addr + 5) >= sizeof(sun.sun_path)) {
+			LOG_ERR("metrics: path too long");
+			return -1;
+		}
+		strcpy(sun.sun_path, addr + 5);
+		fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+		if (fd < 0)
+			return -1;
+		unlink(sun.sun_path);
+		if (bind(fd, (struct sockaddr*)&sun, sizeof(sun)) < 0)
+			goto err;
+	} else {
+		char host[64];
+		struct addrinfo hints = {
+			.ai_family = AF_UNSPEC,
+			.ai_socktype = SOCK_STREAM,
+			.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV,
+		};
+		struct addrinfo* ai;
+		const char* port = strrchr(addr, ':');
+
+		if (port == NULL || (size_t)(port - addr) >= sizeof(host)) {
+			LOG_ERR("metrics: address has to be host:port or unix:path");
+			return -1;
+		}
+		/* allow [::1]:port */
+		if (addr[0] == '[' && port > addr + 1 && port[-1] == ']')
+			snprintf(host, sizeof(host), "%.*s", (int)(port - addr - 2), addr + 1);
+		else
+			snprintf(host, sizeof(host), "%.*s", (int)(port - addr), addr);
+
+		if (getaddrinfo(host, port + 1, &hints, &ai) != 0) {
+			LOG_ERR("metrics: invalid address %s", addr);
+			return -1;
+		}
+		fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK,
+			    ai->ai_protocol);
+		if (fd < 0) {
+			freeaddrinfo(ai);
+			return -1;
+		}
+		int on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		int ret = bind(fd, ai->ai_addr, ai->ai_addrlen);
+		freeaddrinfo(ai);
+		if (ret < 0)
+			goto err;
+	}
+
+	if (listen(fd, 4) < 0)
+		goto err;
+	return fd;
+
+err:
+	LOG_ERR("metrics: could not listen on %s: %s", addr, strerror(errno));
+	close(fd);
+	return -1;
+}
+
+struct uwifi_metrics* uwifi_metrics_open(const char* addr, unsigned int max_nodes)
+{
+	struct uwifi_metrics* m = calloc(1, sizeof(struct uwifi_metrics));
+	if (m == NULL)
+		return NULL;
+
+	m->max_nodes = max_nodes;
+	m->snap_size = sizeof(struct metrics_snap) + max_nodes * sizeof(struct metrics_node);
+	m->out_size = METRICS_OUT_BASE + max_nodes * METRICS_OUT_NODE;
+	m->snap = calloc(1, m->snap_size);
+	m->build = calloc(1, m->snap_size);
+	m->render = calloc(1, m->snap_size);
+	m->sel = calloc(max_nodes + 1, sizeof(*m->sel));
+	m->out = malloc(m->out_size);
+	pthread_mutex_init(&m->lock, NULL);
+
+	if (m->snap == NULL || m->build == NULL || m->render == NULL ||
+	    m->sel == NULL || m->out == NULL) {
+		m->fd = -1;
+		uwifi_metrics_close(m);
+		return NULL;
+	}
+
+	m->fd = metrics_listen(addr);
+	if (m->fd < 0) {
+		uwifi_metrics_close(m);
+		return NULL;
+	}
+	return m;
+}
+
+int uwifi_metrics_fd(struct uwifi_metrics* m)
+{
+	return m->fd;
+}
+
+void uwifi_metrics_close(struct uwifi_metrics* m)
+{
+	if (m->fd >= 0)
+		close(m->fd);
+	pthread_mutex_destroy(&m->lock);
+	free(m->snap);
+	free(m->build);
+	free(m->render);
+	free(m->sel);
+	free(m->out);
+	free(m);
+}
+
+/*** snapshot ***/
+
+static void metrics_chan_add(struct metrics_snap* s, const struct uwifi_node* n)
+{
+	unsigned int i;
+
+	if (n->wlan_channel == 0)
+		return;
+
+	for (i = 0; i < s->num_chans; i++)
+		if (s->chans[i].channel == (int)n->wlan_channel)
+			break;
+	if (i == s->num_chans) {
+		if (s->num_chans >= MAX_CHANNELS)
+			return;
+		s->num_chans++;
+		s->chans[i].channel = n->wlan_channel;
+		s->chans[i].nodes = s->chans[i].aps = 0;
+	}
+	s->chans[i].nodes++;
+	if (n->wlan_mode & WLAN_MODE_AP)
+		s->chans[i].aps++;
+}
+
+void uwifi_metrics_update(struct uwifi_metrics* m, struct uwifi_interface* intf)
+{
+	struct metrics_snap* s = m->build;
+	struct uwifi_node* n;
+	unsigned int num_sel = 0;
+	uint32_t now = plat_time_usec();
+
+	s->num_nodes_total = 0;
+	s->num_chans = 0;
+	s->freq = intf->channel.freq;
+	s->width = intf->channel.width;
+
+	/* keep the nodes with the most packets, sorted */
+	cc_list_for_each(&intf->wlan_nodes, n, list) {
+		s->num_nodes_total++;
+		metrics_chan_add(s, n);
+
+		unsigned int i = num_sel;
+		while (i > 0 && m->sel[i - 1]->pkt_count < n->pkt_count) {
+			m->sel[i] = m->sel[i - 1];
+			i--;
+		}
+		if (i < m->max_nodes) {
+			m->sel[i] = n;
+			if (num_sel < m->max_nodes)
+				num_sel++;
+		}
+	}
+
+	for (unsigned int i = 0; i < num_sel; i++) {
+		const struct uwifi_node* o = m->sel[i];
+		struct metrics_node* mn = &s->nodes[i];
+
+		memcpy(mn->mac, o->wlan_src, WLAN_MAC_LEN);
+		memcpy(mn->bssid, o->wlan_bssid, WLAN_MAC_LEN);
+		if (o->essid != NULL) {
+			const struct uwifi_ssid* ssid = uwifi_essid_ssid(o->essid);
+			memcpy(mn->essid, ssid->ssid, ssid->len);
+			mn->essid_len = ssid->len;
+		} else {
+			mn->essid_len = 0;
+		}
+		mn->pkts = o->pkt_count;
+		mn->retries = o->wlan_retries_all;
+		mn->sig = o->phy_sig_last;
+		mn->sig_avg = -(int)ewma_read(&o->phy_sig_avg);
+		mn->sig_max = o->phy_sig_max;
+		mn->channel = o->wlan_channel;
+		mn->mode = o->wlan_mode;
+		mn->std = o->wlan_std;
+		mn->age = now - o->last_seen;
+	}
+	s->num_nodes = num_sel;
+
+	pthread_mutex_lock(&m->lock);
+	m->build = m->snap;
+	m->snap = s;
+	pthread_mutex_unlock(&m->lock);
+}
+
+/*** rendering ***/
+
+struct metrics_out {
+	char*	buf;
+	size_t	len;
+	size_t	size;
+	bool	overflow;
+};
+
+static void __attribute__((format(printf, 2, 3)))
+out_printf(struct metrics_out* o, const char* fmt, ...)
+{
+	va_list ap;
+
+	if (o->overflow)
+		return;
+	va_start(ap, fmt);
+	int ret = vsnprintf(o->buf + o->len, o->size - o->len, fmt, ap);
+	va_end(ap);
+	if (ret < 0 || (size_t)ret >= o->size - o->len)
+		o->overflow = true;
+	else
+		o->len += ret;
+}
+
+static void out_family(struct metrics_out* o, const char* name, const char* type,
+		       const char* help)
+{
+	out_printf(o, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+}
+
+/* label value escaping as required by OpenMetrics */
+/* label values have to be UTF-8, other bytes are replaced by '?' */
+static void label_escape(char* dst, size_t size, const char* src, size_t len)
+{
+	const unsigned char* u = (const unsigned char*)src;
+	size_t i = 0, j = 0;
+	int n;
+
+	while (j < len && i + 4 < size) {
+		if (u[j] == '\\' || u[j] == '"') {
+			dst[i++] = '\\';
+			dst[i++] = u[j++];
+		} else if (u[j] == '\n') {
+			dst[i++] = '\\';
+			dst[i++] = 'n';
+			j++;
+		} else if (u[j] != '\0' && (n = utf8_valid_len(u + j, len - j)) > 0) {
+			memcpy(dst + i, u + j, n);
+			i += n;
+			j += n;
+		} else {
+			dst[i++] = '?';
+			j++;
+		}
+	}
+	dst[i] = '\0';
+}
+
+#define MAC_LABEL_LEN	18
+
+static void mac_label(char* buf, const unsigned char* mac)
+{
+	snprintf(buf, MAC_LABEL_LEN, "%02x:%02x:%02x:%02x:%02x:%02x",
+		 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+/* one gauge or counter sample per exported node */
+#define OUT_NODES(_o, _s, _name, _fmt, _field)					\
+	for (unsigned int _i = 0; _i < (_s)->num_nodes; _i++) {			\
+		char _mac[MAC_LABEL_LEN];					\
+		mac_label(_mac, (_s)->nodes[_i].mac);				\
+		out_printf(_o, _name "{mac=\"%s\"} " _fmt "\n", _mac,		\
+			   (_s)->nodes[_i]._field);				\
+	}
+
+static void render_nodes(struct metrics_out* o, const struct metrics_snap* s)
+{
+	char mac[MAC_LABEL_LEN], bssid[MAC_LABEL_LEN];
+	char essid[2 * WLAN_MAX_SSID_LEN + 4];
+
+	out_family(o, "uwifi_nodes", "gauge", "Number of nodes tracked");
+	out_printf(o, "uwifi_nodes %u\n", s->num_nodes_total);
+
+	out_family(o, "uwifi_node", "info", "Node attributes");
+	for (unsigned int i = 0; i < s->num_nodes; i++) {
+		const struct metrics_node* n = &s->nodes[i];
+		mac_label(mac, n->mac);
+		mac_label(bssid, n->bssid);
+		label_escape(essid, sizeof(essid), n->essid, n->essid_len);
+		out_printf(o, "uwifi_node_info{mac=\"%s\",bssid=\"%s\",essid=\"%s\","
+			   "mode=\"%s\",std=\"%s\"} 1\n", mac, bssid, essid,
+			   wlan_mode_string(n->mode), wlan_80211std_str(n->std));
+	}
+
+	out_family(o, "uwifi_node_packets", "counter", "Packets received from node");
+	OUT_NODES(o, s, "uwifi_node_packets_total", "%u", pkts);
+	out_family(o, "uwifi_node_retries", "counter", "Retries seen from node");
+	OUT_NODES(o, s, "uwifi_node_retries_total", "%u", retries);
+	out_family(o, "uwifi_node_signal_dbm", "gauge", "Signal of last packet");
+	OUT_NODES(o, s, "uwifi_node_signal_dbm", "%d", sig);
+	out_family(o, "uwifi_node_signal_avg_dbm", "gauge", "Average signal");
+	OUT_NODES(o, s, "uwifi_node_signal_avg_dbm", "%d", sig_avg);
+	out_family(o, "uwifi_node_signal_max_dbm", "gauge", "Maximum signal");
+	OUT_NODES(o, s, "uwifi_node_signal_max_dbm", "%d", sig_max);
+	out_family(o, "uwifi_node_channel", "gauge", "Channel from beacon or probe");
+	OUT_NODES(o, s, "uwifi_node_channel", "%u", channel);
+	out_family(o, "uwifi_node_last_seen_seconds", "gauge", "Time since last packet");
+	for (unsigned int i = 0; i < s->num_nodes; i++) {
+		mac_label(mac, s->nodes[i].mac);
+		out_printf(o, "uwifi_node_last_seen_seconds{mac=\"%s\"} %u.%03u\n", mac,
+			   s->nodes[i].age / 1000000, s->nodes[i].age / 1000 % 1000);
+	}
+}
+
+static void render_channels(struct metrics_out* o, const struct metrics_snap* s)
+{
+	out_family(o, "uwifi_interface_freq_mhz", "gauge", "Current frequency");
+	out_printf(o, "uwifi_interface_freq_mhz{width=\"%s\"} %u\n",
+		   uwifi_channel_width_string(s->width), s->freq);
+
+	out_family(o, "uwifi_channel_nodes", "gauge", "Nodes per channel");
+	for (unsigned int i = 0; i < s->num_chans; i++)
+		out_printf(o, "uwifi_channel_nodes{channel=\"%d\"} %u\n",
+			   s->chans[i].channel, s->chans[i].nodes);
+
+	out_family(o, "uwifi_channel_aps", "gauge", "Access points per channel");
+	for (unsigned int i = 0; i < s->num_chans; i++)
+		out_printf(o, "uwifi_channel_aps{channel=\"%d\"} %u\n",
+			   s->chans[i].channel, s->chans[i].aps);
+}
+
+#if UWIFI_COUNTERS
+static void render_counters(struct metrics_out* o)
+{
+	struct uwifi_counters_snapshot* cs = malloc(sizeof(*cs));
+	char name[64];
+
+	if (cs == NULL)
+		return;
+	uwifi_counters_snapshot(cs);
+
+	for (int i = 0; i < UWIFI_CNT_MAX; i++) {
+		snprintf(name, sizeof(name), "uwifi_%s", uwifi_counter_name(i));
+		out_family(o, name, "counter", "Library counter");
+		out_printf(o, "%s_total %llu\n", name, (unsigned long long)cs->cnt[i]);
+	}
+
+	/* cumulative buckets at powers of 2 */
+	for (int i = 0; i < UWIFI_HIST_MAX; i++) {
+		const struct uwifi_hist* h = &cs->hist[i];
+		unsigned int last = 0;
+		uint64_t sum = 0;
+
+		for (unsigned int j = 0; j < UWIFI_HIST_BUCKETS; j++)
+			if (h->buckets[j])
+				last = j;
+
+		snprintf(name, sizeof(name), "uwifi_%s", uwifi_hist_name(i));
+		out_family(o, name, "histogram", "Library latency histogram");
+		for (unsigned int j = 0; j <= last; j++) {
+			sum += h->buckets[j];
+			if (j % UWIFI_HIST_SUB == UWIFI_HIST_SUB - 1 &&
+			    j + 1 < UWIFI_HIST_BUCKETS)
+				out_printf(o, "%s_bucket{le=\"%llu\"} %llu\n", name,
+					   (unsigned long long)uwifi_hist_bucket_low(j + 1) - 1,
+					   (unsigned long long)sum);
+		}
+		out_printf(o, "%s_bucket{le=\"+Inf\"} %llu\n", name,
+			   (unsigned long long)h->count);
+		out_printf(o, "%s_count %llu\n", name, (unsigned long long)h->count);
+		out_printf(o, "%s_sum %llu\n", name, (unsigned long long)h->sum);
+	}
+	free(cs);
+}
+#endif
+
+static bool metrics_render(struct uwifi_metrics* m, struct metrics_out* o)
+{
+	pthread_mutex_lock(&m->lock);
+	memcpy(m->render, m->snap, m->snap_size);
+	pthread_mutex_unlock(&m->lock);
+
+	render_nodes(o, m->render);
+	render_channels(o, m->render);
+#if UWIFI_COUNTERS
+	render_counters(o);
+#endif
+	out_printf(o, "# EOF\n");
+	return !o->overflow;
+}
+
+/*** serving ***/
+
+static bool send_all(int fd, const char* buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t ret = send(fd, buf, len, MSG_NOSIGNAL);
+		if (ret <= 0)
+			return false;
+		buf += ret;
+		len -= ret;
+	}
+	return true;
+}
+
+static void metrics_answer(struct uwifi_metrics* m, int fd)
+{
+	struct timeval tv = { .tv_usec = METRICS_TIMEOUT_MS * 1000 };
+	char req[1024];
+	size_t len = 0;
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	/* read the request header, we answer anything with the metrics */
+	while (len < sizeof(req) - 1) {
+		ssize_t ret = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+		if (ret <= 0)
+			return;
+		len += ret;
+		req[len] = '\0';
+		if (strstr(req, "\r\n\r\n") != NULL || strstr(req, "\n\n") != NULL)
+			break;
+	}
+
+	/* leave room for the HTTP header in front of the body */
+	struct metrics_out o = {
+		.buf = m->out + METRICS_HDR_MAX,
+		.size = m->out_size - METRICS_HDR_MAX,
+	};
+	char hdr[METRICS_HDR_MAX];
+	int hlen;
+
+	if (metrics_render(m, &o)) {
+		hlen = snprintf(hdr, sizeof(hdr), "HTTP/1.0 200 OK\r\n"
+				"Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+				"Content-Length: %zu\r\n\r\n", o.len);
+	} else {
+		LOG_ERR("metrics: output too large");
+		o.len = 0;
+		hlen = snprintf(hdr, sizeof(hdr), "HTTP/1.0 500 Internal Server Error\r\n"
+				"Content-Length: 0\r\n\r\n");
+	}
+
+	/* send header and body in one go */
+	memcpy(o.buf - hlen, hdr, hlen);
+	send_all(fd, o.buf - hlen, hlen + o.len);
+}
+
+int uwifi_metrics_serve(struct uwifi_metrics* m)
+{
+	int fd, num = 0;
+
+	while ((fd = accept(m->fd, NULL, NULL)) >= 0) {
+		metrics_answer(m, fd);
+		close(fd);
+		num++;
+	}
+	if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		LOG_ERR("metrics: accept failed: %s", strerror(errno));
+	return num;
+}
@@ -0,0 +1,64 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_METRICS_H_
+#define _UWIFI_METRICS_H_
+
+#include <stdbool.h>
+
+#include "conf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Optional OpenMetrics (Prometheus) exporter for node and channel stats
+ * (make METRICS=1).
+ *
+ * The capture loop calls uwifi_metrics_update() from time to time, which
+ * copies the interesting values of the nodes into a snapshot. Scrapes are
+ * answered from that snapshot by uwifi_metrics_serve(), so rendering never
+ * touches the node list and can run in another thread. To limit label
+ * cardinality only the nodes with the most packets are exported.
+ *
+ * When the library is built with COUNTERS=1 the library counters and
+ * histograms are exported as well.
+ */
+
+struct uwifi_metrics;
+
+/**
+ * uwifi_metrics_open() - listen for scrapes
+ * @addr: "host:port" for TCP, e.g. "127.0.0.1:9100", or "unix:/path"
+ * @max_nodes: number of nodes to export (top-N by packet count)
+ */
+struct uwifi_metrics* uwifi_metrics_open(const char* addr, unsigned int max_nodes);
+
+/** Listening socket, readable when a scrape is waiting */
+int uwifi_metrics_fd(struct uwifi_metrics* m);
+
+/** Take a new snapshot of the nodes and channels of @intf */
+void uwifi_metrics_update(struct uwifi_metrics* m, struct uwifi_interface* intf);
+
+/**
+ * uwifi_metrics_serve() - answer pending scrapes
+ *
+ * Does not block when nobody is connecting. Slow clients are given up on
+ * after a short timeout. Returns the number of scrapes answered.
+ */
+int uwifi_metrics_serve(struct uwifi_metrics* m);
+
+void uwifi_metrics_close(struct uwifi_metrics* m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
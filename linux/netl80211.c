@@ -194,6 +194,56 @@ bool nl80211_send(struct nl_sock *const sock, struct nl_msg *const msg)
 	return nl80211_send_recv(sock, msg, NULL, NULL); /* frees msg */
 }
 
+/**
+ * send message and free msg without waiting for a reply, for use with an
+ * external event loop which passes the replies to nl80211_dispatch()
+ */
+bool nl80211_send_async(struct nl_sock *const sock, struct nl_msg *const msg)
+{
+	int err = nl_send_auto_complete(sock, msg);
+	nlmsg_free(msg);
+
+	if (err <= 0) {
+		nl_perror(err, "failed to send netlink message");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * handle netlink messages received outside of libnl (e.g. thru io_uring)
+ *
+ * Calls cb_func for each valid message. Returns 1 if more messages are
+ * expected, 0 when the ACK or end of a dump was received and a negative libnl
+ * error code on error.
+ */
+int nl80211_dispatch(const unsigned char *buf, size_t len,
+		     nl_recvmsg_msg_cb_t cb_func, void* cb_arg)
+{
+	struct nlmsghdr *hdr = (struct nlmsghdr *)buf;
+	int remaining = len;
+
+	for (; nlmsg_ok(hdr, remaining); hdr = nlmsg_next(hdr, &remaining)) {
+		if (hdr->nlmsg_type == NLMSG_DONE)
+			return 0;
+
+		if (hdr->nlmsg_type == NLMSG_ERROR) {
+			struct nlmsgerr *e = nlmsg_data(hdr);
+			return e->error ? -nl_syserr2nlerr(e->error) : 0;
+		}
+
+		if (cb_func == NULL)
+			continue;
+
+		struct nl_msg *msg = nlmsg_convert(hdr);
+		if (msg == NULL)
+			return -NLE_NOMEM;
+		cb_func(msg, cb_arg);
+		nlmsg_free(msg);
+	}
+	return 1;
+}
+
 struct nlattr** nl80211_parse(struct nl_msg *msg)
 {
 	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
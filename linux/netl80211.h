@@ -35,6 +35,11 @@ bool nl80211_send_recv(struct nl_sock *const sock, struct nl_msg *const msg,
 
 bool nl80211_send(struct nl_sock *const sock, struct nl_msg *const msg);
 
+bool nl80211_send_async(struct nl_sock *const sock, struct nl_msg *const msg);
+
+int nl80211_dispatch(const unsigned char *buf, size_t len,
+		     nl_recvmsg_msg_cb_t cb_func, void* cb_arg);
+
 struct nlattr** nl80211_parse(struct nl_msg *msg);
 
 int nl_get_multicast_id(struct nl_sock *sock, const char *family, const char *group);
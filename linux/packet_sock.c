@@ -18,11 +18,14 @@
 #include <net/if.h>
 #include <arpa/inet.h>
 #include <err.h>
+#include <time.h>
 
 #include "packet_sock.h"
 #include "util.h"
 #include "platform.h"
 #include "log.h"
+#include "probes.h"
+#include "counters.h"
 
 void socket_set_receive_buffer(int fd, int sockbufsize)
 {
@@ -71,10 +74,60 @@ int packet_socket_open(char* devname)
 	if (ret != 0)
 		err(1, "bind failed");
 
+	/* kernel receive timestamps for packet_socket_recv_ts() */
+	int on = 1;
+	if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) != 0)
+		LOG_WARN("Could not enable socket timestamps");
+
 	return fd;
 }
 
 ssize_t packet_socket_recv(int fd, unsigned char* buffer, size_t bufsize)
 {
-	return recv(fd, buffer, bufsize, MSG_DONTWAIT);
+	ssize_t ret = recv(fd, buffer, bufsize, MSG_DONTWAIT);
+	if (ret > 0) {
+		UWIFI_PROBE3(frame_rx, fd, ret, 0);
+		UWIFI_COUNT(UWIFI_CNT_FRAMES_RX);
+	}
+	return ret;
+}
+
+ssize_t packet_socket_recv_ts(int fd, unsigned char* buffer, size_t bufsize,
+			     uint64_t* ts)
+{
+	char cbuf[CMSG_SPACE(sizeof(struct timespec))];
+	struct iovec iov = { .iov_base = buffer, .iov_len = bufsize };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf,
+		.msg_controllen = sizeof(cbuf),
+	};
+	struct cmsghdr* cmsg;
+
+	ssize_t ret = recvmsg(fd, &msg, MSG_DONTWAIT);
+	if (ret <= 0)
+		return ret;
+
+	*ts = 0;
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET &&
+		    cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+			struct timespec t;
+			memcpy(&t, CMSG_DATA(cmsg), sizeof(t));
+			*ts = (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+			break;
+		}
+	}
+	UWIFI_PROBE3(frame_rx, fd, ret, *ts);
+	UWIFI_COUNT(UWIFI_CNT_FRAMES_RX);
+	return ret;
+}
+
+ssize_t packet_socket_send(int fd, const unsigned char* buffer, size_t len)
+{
+	ssize_t ret = send(fd, buffer, len, MSG_DONTWAIT);
+	UWIFI_PROBE3(inject, fd, len, ret);
+	UWIFI_COUNT(ret < 0 ? UWIFI_CNT_INJECT_FAIL : UWIFI_CNT_INJECTED);
+	return ret;
 }
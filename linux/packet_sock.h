@@ -11,6 +11,8 @@
 #define _UWIFI_PKT_SOCKET_H_
 
 #include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,6 +22,14 @@ int packet_socket_open(char* devname);
 
 ssize_t packet_socket_recv(int fd, unsigned char* buffer, size_t bufsize);
 
+/* like packet_socket_recv() and return kernel RX timestamp (nsec) in @ts,
+ * e.g. for uwifi_packet.pkt_rx_time */
+ssize_t packet_socket_recv_ts(int fd, unsigned char* buffer, size_t bufsize,
+			     uint64_t* ts);
+
+/* send (inject) frame with radiotap header, see inject.h */
+ssize_t packet_socket_send(int fd, const unsigned char* buffer, size_t len);
+
 void socket_set_receive_buffer(int fd, int sockbufsize);
 
 #ifdef __cplusplus
@@ -0,0 +1,176 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ * Copyright (C) 2007 Sven-Ola Tuecke
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pcap.h>
+
+#include "pcap_capture.h"
+#include "netdev.h"
+#include "util.h"
+#include "log.h"
+
+#define PCAP_TIMEOUT	100	/* ms, only matters without immediate mode */
+
+#ifndef ARPHRD_IEEE80211
+#define ARPHRD_IEEE80211 801
+#endif
+
+struct pcap_capture {
+	pcap_t*		pcap;
+	bool		offline;
+};
+
+struct pcap_capture* pcap_capture_open(const char* devname, int bufsize)
+{
+	char errbuf[PCAP_ERRBUF_SIZE];
+	struct pcap_capture* pc;
+	int ret;
+
+	pc = malloc(sizeof(struct pcap_capture));
+	if (pc == NULL)
+		return NULL;
+	memset(pc, 0, sizeof(struct pcap_capture));
+
+	pc->pcap = pcap_create(devname, errbuf);
+	if (pc->pcap == NULL) {
+		LOG_ERR("Couldn't create pcap on '%s': %s", devname, errbuf);
+		free(pc);
+		return NULL;
+	}
+
+	pcap_set_snaplen(pc->pcap, 65535);
+	pcap_set_promisc(pc->pcap, 1);
+	pcap_set_timeout(pc->pcap, PCAP_TIMEOUT);
+	if (pcap_set_immediate_mode(pc->pcap, 1) != 0)
+		LOG_WARN("pcap: immediate mode not supported");
+	if (bufsize > 0 && pcap_set_buffer_size(pc->pcap, bufsize) != 0)
+		LOG_WARN("pcap: could not set buffer size %d", bufsize);
+
+	ret = pcap_activate(pc->pcap);
+	if (ret < 0) {
+		LOG_ERR("Can't activate pcap on '%s': %s", devname,
+			pcap_geterr(pc->pcap));
+		pcap_close(pc->pcap);
+		free(pc);
+		return NULL;
+	} else if (ret > 0) {
+		LOG_WARN("pcap: %s", pcap_statustostr(ret));
+	}
+
+	if (pcap_setnonblock(pc->pcap, 1, errbuf) != 0)
+		LOG_WARN("pcap: could not set non-blocking: %s", errbuf);
+
+	return pc;
+}
+
+struct pcap_capture* pcap_capture_open_offline(const char* path)
+{
+	char errbuf[PCAP_ERRBUF_SIZE];
+	struct pcap_capture* pc;
+
+	pc = malloc(sizeof(struct pcap_capture));
+	if (pc == NULL)
+		return NULL;
+	memset(pc, 0, sizeof(struct pcap_capture));
+
+	pc->pcap = pcap_open_offline(path, errbuf);
+	if (pc->pcap == NULL) {
+		LOG_ERR("Couldn't open '%s': %s", path, errbuf);
+		free(pc);
+		return NULL;
+	}
+	pc->offline = true;
+	return pc;
+}
+
+bool pcap_capture_set_filter(struct pcap_capture* pc, const char* filter)
+{
+	struct bpf_program prog;
+
+	if (pcap_compile(pc->pcap, &prog, filter, 1, PCAP_NETMASK_UNKNOWN) != 0) {
+		LOG_ERR("pcap: invalid filter '%s': %s", filter, pcap_geterr(pc->pcap));
+		return false;
+	}
+
+	int ret = pcap_setfilter(pc->pcap, &prog);
+	pcap_freecode(&prog);
+	if (ret != 0) {
+		LOG_ERR("pcap: could not set filter: %s", pcap_geterr(pc->pcap));
+		return false;
+	}
+	return true;
+}
+
+int pcap_capture_fd(struct pcap_capture* pc)
+{
+	if (pc->offline)
+		return -1;
+	return pcap_get_selectable_fd(pc->pcap);
+}
+
+int pcap_capture_arphdr(struct pcap_capture* pc)
+{
+	switch (pcap_datalink(pc->pcap)) {
+	case DLT_IEEE802_11_RADIO:
+		return ARPHRD_IEEE80211_RADIOTAP;
+	case DLT_PRISM_HEADER:
+		return ARPHRD_IEEE80211_PRISM;
+	case DLT_IEEE802_11:
+		return ARPHRD_IEEE80211;
+	default:
+		return -1;
+	}
+}
+
+ssize_t pcap_capture_recv_zc(struct pcap_capture* pc, const unsigned char** data)
+{
+	struct pcap_pkthdr* hdr;
+
+	switch (pcap_next_ex(pc->pcap, &hdr, data)) {
+	case 1:
+		return hdr->caplen;
+	case 0: /* timeout or nothing available in non-blocking mode */
+		errno = EAGAIN;
+		return -1;
+	case PCAP_ERROR_BREAK: /* end of savefile */
+		return 0;
+	default:
+		LOG_DBG("pcap: %s", pcap_geterr(pc->pcap));
+		errno = EIO;
+		return -1;
+	}
+}
+
+ssize_t pcap_capture_recv(struct pcap_capture* pc, unsigned char* buffer,
+			  size_t bufsize)
+{
+	const unsigned char* data;
+	ssize_t len = pcap_capture_recv_zc(pc, &data);
+
+	if (len <= 0)
+		return len;
+
+	if ((size_t)len > bufsize) {
+		LOG_ERR("pcap: buffer (%zu) too small for %zd bytes", bufsize, len);
+		len = bufsize;
+	}
+	memcpy(buffer, data, len);
+	return len;
+}
+
+void pcap_capture_close(struct pcap_capture* pc)
+{
+	if (pc == NULL)
+		return;
+	pcap_close(pc->pcap);
+	free(pc);
+}
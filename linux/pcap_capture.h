@@ -0,0 +1,71 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_PCAP_CAPTURE_H_
+#define _UWIFI_PCAP_CAPTURE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pcap_capture;
+
+/**
+ * pcap_capture_open() - open live capture on an interface
+ *
+ * @devname: interface name, or a remote source string understood by libpcap
+ * @bufsize: kernel buffer size in bytes, or 0 for the libpcap default
+ *
+ * The handle is opened in immediate mode so packets are delivered as soon as
+ * they arrive instead of when the buffer fills up. Returns NULL on error.
+ */
+struct pcap_capture* pcap_capture_open(const char* devname, int bufsize);
+
+/** Open a pcap savefile for reading. Returns NULL on error. */
+struct pcap_capture* pcap_capture_open_offline(const char* path);
+
+/** Compile and set a BPF filter expression, run by the kernel for live captures */
+bool pcap_capture_set_filter(struct pcap_capture* pc, const char* filter);
+
+/** File descriptor for poll/select, -1 for offline captures */
+int pcap_capture_fd(struct pcap_capture* pc);
+
+/** Link type as ARPHRD_xxx constant, to be passed to uwifi_parse_raw() */
+int pcap_capture_arphdr(struct pcap_capture* pc);
+
+/**
+ * pcap_capture_recv() - receive one packet into @buffer
+ *
+ * Same semantics as packet_socket_recv(): returns the length of the packet,
+ * -1 with errno EAGAIN if no packet is available right now, 0 at the end of
+ * a savefile and -1 on other errors. Packets larger than @bufsize are
+ * truncated.
+ */
+ssize_t pcap_capture_recv(struct pcap_capture* pc, unsigned char* buffer,
+			  size_t bufsize);
+
+/**
+ * pcap_capture_recv_zc() - receive one packet without copying
+ *
+ * Like pcap_capture_recv() but @data is set to point into the libpcap buffer.
+ * The data is only valid until the next call on the same handle.
+ */
+ssize_t pcap_capture_recv_zc(struct pcap_capture* pc, const unsigned char** data);
+
+void pcap_capture_close(struct pcap_capture* pc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _UWIFI_PCAP_CAPTURE_H_
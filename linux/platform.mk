@@ -11,7 +11,11 @@ INST_PATH	= /usr/local
 WEXT		= 0
 LIBNL		= 3.0
 BUILD_RADIOTAP	= 1
-#PCAP		= 0 #TODO revive
+PCAP		= 0
+IO_URING	= 0
+ESP32_REPLAY	= 0
+USDT		= 0
+METRICS		= 0
 
 SRC		+= linux/inject_rtap.c
 SRC		+= linux/interface.c
@@ -32,6 +36,31 @@ else
   LIBS		= -lradiotap
 endif
 
+ifeq ($(PCAP),1)
+  SRC		+= linux/pcap_capture.c
+  LIBS		+= -lpcap
+endif
+
+ifeq ($(IO_URING),1)
+  SRC		+= linux/uring.c
+  LIBS		+= -luring
+endif
+
+ifeq ($(USDT),1)
+  DEFS		+= -DUWIFI_USDT=1
+endif
+
+ifeq ($(METRICS),1)
+  SRC		+= linux/metrics.c
+  LIBS		+= -lpthread
+endif
+
+ifeq ($(ESP32_REPLAY),1)
+  INCLUDES	+= -I./esp32
+  SRC		+= esp32/esp32_promisc.c
+  SRC		+= esp32/esp32_replay.c
+endif
+
 ifeq ($(WEXT),1)
   SRC		+= linux/ifctrl-wext.c
 else
@@ -53,5 +82,8 @@ install: lib-static lib-dynamic
 	-mkdir -p $(INST_PATH)/lib
 	cp -r ./include/uwifi $(INST_PATH)/include/
 	cp ./linux/*.h $(INST_PATH)/include/uwifi
+ifeq ($(ESP32_REPLAY),1)
+	cp ./esp32/esp32_promisc.h $(INST_PATH)/include/uwifi
+endif
 	cp $(BUILD_DIR)/libuwifi.a $(INST_PATH)/lib/
 	cp -a $(BUILD_DIR)/libuwifi.so* $(INST_PATH)/lib/
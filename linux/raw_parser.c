@@ -22,6 +22,9 @@
 #include "raw_parser.h"
 #include "netdev.h"
 #include "log.h"
+#include "trace.h"
+#include "probes.h"
+#include "counters.h"
 
 /** return -1 on error, size of prism header otherwise */
 int uwifi_parse_prism_header(unsigned char* buf, int len, struct uwifi_packet* p)
@@ -46,7 +49,7 @@ int uwifi_parse_prism_header(unsigned char* buf, int len, struct uwifi_packet* p
 	/* just in case...*/
 	if (p->phy_rate == 0 || p->phy_rate > 1080) {
 		/* assume min rate, guess mode from channel */
-		LOG_DBG("Prism2: *** fixing wrong rate");
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Prism2: *** fixing wrong rate");
 		if (ph->channel.data > 14)
 			p->phy_rate = 120; /* 6 * 2 */
 		else
@@ -64,14 +67,40 @@ int uwifi_parse_prism_header(unsigned char* buf, int len, struct uwifi_packet* p
 	p->phy_flags |= PHY_FLAG_SHORTPRE;
 
 	LOG_DBG("Prism2: devname %s", ph->devname);
-	LOG_DBG("Prism2: signal %d -> %d", ph->signal.data, p->phy_signal);
-	LOG_DBG("Prism2: rate %d", ph->rate.data);
-	LOG_DBG("Prism2: rssi %d", ph->rssi.data);
+	UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Prism2: signal %d -> %d", ph->signal.data, p->phy_signal);
+	UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Prism2: rate %d", ph->rate.data);
+	UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Prism2: rssi %d", ph->rssi.data);
 
 	return sizeof(wlan_ng_prism2_header);
 }
 
-static void get_radiotap_info(struct ieee80211_radiotap_iterator *iter, struct uwifi_packet* p)
+/*
+ * Per-chain values come in extended presence bitmaps, one bitmap per chain
+ * with DBM_ANTSIGNAL, DBM_ANTNOISE and ANTENNA. Since ANTENNA comes last
+ * in each bitmap we keep the values until the bitmap ends.
+ */
+struct radiotap_chain {
+	int		last_idx;	/* arg index of previous field */
+	signed char	sig;
+	signed char	noise;
+	int		ant;
+	unsigned char	db_sig;
+	unsigned char	db_noise;
+};
+
+static void radiotap_chain_commit(struct radiotap_chain* ch, struct uwifi_packet* p)
+{
+	if (ch->ant >= 0 && ch->ant < UWIFI_MAX_CHAINS && (ch->sig || ch->noise)) {
+		p->phy_chain_signal[ch->ant] = ch->sig;
+		p->phy_chain_noise[ch->ant] = ch->noise;
+		p->phy_chains |= BIT(ch->ant);
+	}
+	ch->sig = ch->noise = 0;
+	ch->ant = -1;
+}
+
+static void get_radiotap_info(struct ieee80211_radiotap_iterator *iter, struct uwifi_packet* p,
+			      struct radiotap_chain* ch)
 {
 	uint16_t x;
 	signed char c;
@@ -79,7 +108,6 @@ static void get_radiotap_info(struct ieee80211_radiotap_iterator *iter, struct u
 
 	switch (iter->this_arg_index) {
 	/* ignoring these */
-	case IEEE80211_RADIOTAP_TSFT:
 	case IEEE80211_RADIOTAP_FHSS:
 	case IEEE80211_RADIOTAP_LOCK_QUALITY:
 	case IEEE80211_RADIOTAP_TX_ATTENUATION:
@@ -90,6 +118,11 @@ static void get_radiotap_info(struct ieee80211_radiotap_iterator *iter, struct u
 	case IEEE80211_RADIOTAP_DATA_RETRIES:
 	case IEEE80211_RADIOTAP_AMPDU_STATUS:
 		break;
+	case IEEE80211_RADIOTAP_TSFT:
+		/* MAC time of the first bit of the frame */
+		p->phy_tsf = le64toh(*(uint64_t*)iter->this_arg);
+		p->phy_flags |= PHY_FLAG_TSFT;
+		break;
 	case IEEE80211_RADIOTAP_TX_FLAGS:
 		/* when TX flags are present we can conclude that a userspace
 		 * program has injected this packet */
@@ -107,7 +140,7 @@ static void get_radiotap_info(struct ieee80211_radiotap_iterator *iter, struct u
 	case IEEE80211_RADIOTAP_RATE:
 		//TODO check!
 		//printf("\trate: %lf\n", (double)*iter->this_arg/2);
-		LOG_DBG("Radiotap: rate %0x", *iter->this_arg);
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: rate %0x", *iter->this_arg);
 		p->phy_rate = (*iter->this_arg)*5; /* rate is in 500kbps */
 		p->phy_rate_idx = wlan_rate_to_index(p->phy_rate);
 		break;
@@ -132,28 +165,35 @@ static void get_radiotap_info(struct ieee80211_radiotap_iterator *iter, struct u
 		break;
 	case IEEE80211_RADIOTAP_DBM_ANTSIGNAL:
 		c = *(signed char*)iter->this_arg;
-		LOG_DBG("Radiotap: signal %ddBm", c);
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: signal %ddBm", c);
 		/* we get the signal per rx chain with newer drivers.
 		 * save the highest value, but make sure we don't override
 		 * with invalid values */
 		if (c < 0 && (p->phy_signal == 0 || c > p->phy_signal))
 			p->phy_signal = c;
+		ch->sig = c;
 		break;
 	case IEEE80211_RADIOTAP_DBM_ANTNOISE:
-		LOG_DBG("Radiotap: noise %ddBm", *(signed char*)iter->this_arg);
-		// usually not present
-		//p->phy_noise = *(signed char*)iter->this_arg;
+		c = *(signed char*)iter->this_arg;
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: noise %ddBm", c);
+		/* usually not present, the first one is for all chains */
+		if (c < 0 && p->phy_noise == 0)
+			p->phy_noise = c;
+		ch->noise = c;
 		break;
 	case IEEE80211_RADIOTAP_ANTENNA:
-		LOG_DBG("Radiotap: antenna %d", *iter->this_arg);
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: antenna %d", *iter->this_arg);
+		ch->ant = *iter->this_arg;
 		break;
 	case IEEE80211_RADIOTAP_DB_ANTSIGNAL:
-		LOG_DBG("Radiotap: signal %ddB (ref?)", *iter->this_arg);
-		// usually not present
-		//p->phy_snr = *iter->this_arg;
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: signal %ddB (ref?)", *iter->this_arg);
+		/* usually not present */
+		if (ch->db_sig == 0)
+			ch->db_sig = *iter->this_arg;
 		break;
 	case IEEE80211_RADIOTAP_DB_ANTNOISE:
-		//printf("\tantnoise: %02d\n", *iter->this_arg);
+		if (ch->db_noise == 0)
+			ch->db_noise = *iter->this_arg;
 		break;
 	case IEEE80211_RADIOTAP_MCS:
 		/* Ref http://www.radiotap.org/defined-fields/MCS */
@@ -175,19 +215,90 @@ static void get_radiotap_info(struct ieee80211_radiotap_iterator *iter, struct u
 		p->phy_rate_flags = flags;
 		p->phy_rate = wlan_ht_mcs_to_rate(*iter->this_arg, ht20, lgi);
 
-		LOG_DBG("Radiotap: MCS rate %d ", p->phy_rate);
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: MCS rate %d ", p->phy_rate);
 		break;
 	default:
-		LOG_DBG("Radiotap: UNKNOWN FIELD %d", iter->this_arg_index);
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: UNKNOWN FIELD %d", iter->this_arg_index);
 		break;
 	}
 }
 
+/*
+ * Vendor namespaces are not known to the radiotap iterator (we don't pass
+ * any), so it returns each one once as raw data with the vendor namespace
+ * header and skips over it. Registered parsers get the data in place.
+ */
+
+#define MAX_RADIOTAP_VENDORS	8
+
+struct radiotap_vendor {
+	uint32_t			oui;
+	uint8_t				subns;
+	uwifi_radiotap_vendor_cb	cb;
+	void*				ctx;
+};
+
+static struct radiotap_vendor rt_vendors[MAX_RADIOTAP_VENDORS];
+static int rt_num_vendors;
+
+bool uwifi_radiotap_vendor_register(uint32_t oui, uint8_t subns,
+				    uwifi_radiotap_vendor_cb cb, void* ctx)
+{
+	for (int i = 0; i < rt_num_vendors; i++) {
+		if (rt_vendors[i].oui == oui && rt_vendors[i].subns == subns) {
+			rt_vendors[i].cb = cb;
+			rt_vendors[i].ctx = ctx;
+			return true;
+		}
+	}
+
+	if (rt_num_vendors >= MAX_RADIOTAP_VENDORS)
+		return false;
+
+	rt_vendors[rt_num_vendors].oui = oui;
+	rt_vendors[rt_num_vendors].subns = subns;
+	rt_vendors[rt_num_vendors].cb = cb;
+	rt_vendors[rt_num_vendors].ctx = ctx;
+	rt_num_vendors++;
+	return true;
+}
+
+void uwifi_radiotap_vendor_unregister(uint32_t oui, uint8_t subns)
+{
+	for (int i = 0; i < rt_num_vendors; i++) {
+		if (rt_vendors[i].oui == oui && rt_vendors[i].subns == subns) {
+			rt_vendors[i] = rt_vendors[--rt_num_vendors];
+			return;
+		}
+	}
+}
+
+static void radiotap_vendor_ns(struct ieee80211_radiotap_iterator *iter,
+			       unsigned char* end, struct uwifi_packet* p)
+{
+	/* vendor namespace header: OUI (3), sub namespace (1), skip length (2) */
+	unsigned char* hdr = iter->this_arg;
+	uint32_t oui = (hdr[0] << 16) | (hdr[1] << 8) | hdr[2];
+	uint16_t len = le16toh(*(uint16_t*)(hdr + 4));
+
+	if (hdr + 6 + len > end)
+		return;
+
+	for (int i = 0; i < rt_num_vendors; i++) {
+		if (rt_vendors[i].oui == oui && rt_vendors[i].subns == hdr[3]) {
+			rt_vendors[i].cb(hdr + 6, len, p, rt_vendors[i].ctx);
+			return;
+		}
+	}
+	UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: vendor namespace %06x/%d len %d", oui, hdr[3], len);
+}
+
 /* return -1 on error, 0 on bad FCS, size of radiotap header otherwise */
 int uwifi_parse_radiotap(unsigned char* buf, size_t len, struct uwifi_packet* p)
 {
 	struct ieee80211_radiotap_header* rh = (struct ieee80211_radiotap_header*)buf;
 	struct ieee80211_radiotap_iterator iter;
+	struct radiotap_chain chain = { .last_idx = -1, .ant = -1 };
 	int rt_len = le16toh(rh->it_len);
 
 	if (len < sizeof(struct ieee80211_radiotap_header))
@@ -195,20 +306,32 @@ int uwifi_parse_radiotap(unsigned char* buf, size_t len, struct uwifi_packet* p)
 
 	int err = ieee80211_radiotap_iterator_init(&iter, rh, rt_len, NULL);
 	if (err) {
-		LOG_DBG("Radiotap: MALFORMED HEADER (err %d)", err);
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: MALFORMED HEADER (err %d)", err);
 		return -1;
 	}
 
 	while (!(err = ieee80211_radiotap_iterator_next(&iter))) {
 		if (iter.is_radiotap_ns) {
-			get_radiotap_info(&iter, p);
+			/* arg index starts over with each presence bitmap */
+			if (iter.this_arg_index <= chain.last_idx)
+				radiotap_chain_commit(&chain, p);
+			chain.last_idx = iter.this_arg_index;
+			get_radiotap_info(&iter, p, &chain);
+		} else if (iter.this_arg_index == IEEE80211_RADIOTAP_VENDOR_NAMESPACE) {
+			radiotap_vendor_ns(&iter, buf + rt_len, p);
 		}
 	}
+	radiotap_chain_commit(&chain, p);
+
+	if (p->phy_signal < 0 && p->phy_noise < 0 && p->phy_signal > p->phy_noise)
+		p->phy_snr = p->phy_signal - p->phy_noise;
+	else if (chain.db_sig > chain.db_noise)
+		p->phy_snr = chain.db_sig - chain.db_noise;
 
 	/* sanitize */
 	if (p->phy_rate == 0 || p->phy_rate > 6000) {
 		/* assume min rate for mode */
-		LOG_DBG("Radiotap: *** fixing wrong rate");
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: *** fixing wrong rate");
 		if (p->phy_flags & PHY_FLAG_A)
 			p->phy_rate = 120; /* 6 * 2 */
 		else if (p->phy_flags & PHY_FLAG_B)
@@ -219,12 +342,13 @@ int uwifi_parse_radiotap(unsigned char* buf, size_t len, struct uwifi_packet* p)
 			p->phy_rate = 20;
 	}
 
-	LOG_DBG("Radiotap: RATE %.2f = idx %d", (float)p->phy_rate/10, p->phy_rate_idx);
-	LOG_DBG("Radiotap: SIGNAL %d", p->phy_signal);
+	UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: RATE %d.%d = idx %d",
+		p->phy_rate / 10, p->phy_rate % 10, p->phy_rate_idx);
+	UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "Radiotap: SIGNAL %d", p->phy_signal);
 
 	if (p->phy_flags & PHY_FLAG_BADFCS) {
 		/* we can't trust frames with a bad FCS - stop parsing */
-		LOG_DBG("=== bad FCS, stop ===");
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "=== bad FCS, stop ===");
 		return 0;
 	} else {
 		return rt_len;
@@ -232,9 +356,12 @@ int uwifi_parse_radiotap(unsigned char* buf, size_t len, struct uwifi_packet* p)
 }
 
 /* return -1 on error, 0 on bad FCS, size of parsed headers otherwise */
-int uwifi_parse_raw(unsigned char* buf, size_t len, struct uwifi_packet* p, int arphdr)
+int uwifi_parse_raw(unsigned char* buf, size_t len, struct uwifi_packet* p, int arphdr,
+		    struct uwifi_ssid_table* ssids)
 {
 	int ret;
+	UWIFI_TIME_START(start);
+
 	if (arphdr == ARPHRD_IEEE80211_PRISM) {
 		ret = uwifi_parse_prism_header(buf, len, p);
 	} else if (arphdr == ARPHRD_IEEE80211_RADIOTAP) {
@@ -243,18 +370,26 @@ int uwifi_parse_raw(unsigned char* buf, size_t len, struct uwifi_packet* p, int
 		return -1;
 	}
 
-	if (ret == 0) /* 0: Bad FCS, allow packet but stop parsing */
+	if (ret == 0) { /* 0: Bad FCS, allow packet but stop parsing */
+		UWIFI_PROBE4(frame_parse, ret, p->wlan_type, p->wlan_ta, p->phy_signal);
+		UWIFI_COUNT(UWIFI_CNT_FRAMES_BADFCS);
 		return ret;
-	else if (ret < 0) /* Malformed header, don't allow packet */
+	} else if (ret < 0) { /* Malformed header, don't allow packet */
+		UWIFI_COUNT(UWIFI_CNT_FRAMES_MALFORMED);
 		return -1;
+	}
 
 	if ((size_t)ret >= len) {
-		LOG_DBG("impossible len");
+		UWIFI_TRACE_DBG(UWIFI_TR_RADIOTAP, "impossible len");
+		UWIFI_COUNT(UWIFI_CNT_FRAMES_MALFORMED);
 		return -1;
 	}
 
 	int hlen = ret;
-	ret = uwifi_parse_80211_header(buf + ret, len - ret, p);
+	ret = uwifi_parse_80211_header(buf + ret, len - ret, p, ssids);
+	UWIFI_PROBE4(frame_parse, ret, p->wlan_type, p->wlan_ta, p->phy_signal);
+	UWIFI_COUNT(ret < 0 ? UWIFI_CNT_FRAMES_MALFORMED : UWIFI_CNT_FRAMES_PARSED);
+	UWIFI_HIST_SINCE(UWIFI_HIST_PARSE, start);
 	if (ret <= 0)
 		return ret;
 	return hlen + ret;
@@ -284,4 +419,22 @@ void uwifi_fixup_packet_channel(struct uwifi_packet* p, struct uwifi_interface*
 	 * the packet */
 	if (intf->channel_idx < 0 && p->pkt_chan_idx >= 0)
 		intf->channel_idx = p->pkt_chan_idx;
+
+#if UWIFI_NODE_STATS
+	if (p->pkt_chan_idx >= 0 && p->pkt_chan_idx < MAX_CHANNELS &&
+	    p->phy_signal != 0 && !(p->phy_flags & PHY_FLAG_BADFCS))
+		uwifi_stat_add(&intf->chan_sig[p->pkt_chan_idx], p->phy_signal);
+#endif
+}
+
+void uwifi_fixup_packet_time(struct uwifi_packet* p, struct uwifi_interface* intf)
+{
+	/* without TSF the kernel timestamp is the best we have */
+	if (!(p->phy_flags & PHY_FLAG_TSFT) || p->pkt_rx_time == 0) {
+		p->pkt_time = p->pkt_rx_time;
+		return;
+	}
+
+	uwifi_tsf_map_update(&intf->tsf_map, p->phy_tsf, p->pkt_rx_time);
+	p->pkt_time = uwifi_tsf_map_to_host(&intf->tsf_map, p->phy_tsf);
 }
@@ -10,24 +10,47 @@
 #ifndef _UWIFI_RAW_PARSE_H_
 #define _UWIFI_RAW_PARSE_H_
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "wlan_parser.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* return rest of packet length (may be 0) or negative value on error */
-int uwifi_parse_raw(unsigned char* buf, size_t len, struct uwifi_packet* p, int arphdr);
+/* return rest of packet length (may be 0) or negative value on error,
+ * SSIDs are interned in @ssids if not NULL */
+int uwifi_parse_raw(unsigned char* buf, size_t len, struct uwifi_packet* p, int arphdr,
+		    struct uwifi_ssid_table* ssids);
 
 /* return consumed length, 0 for bad FCS, -1 on error */
 int uwifi_parse_radiotap(unsigned char* buf, size_t len, struct uwifi_packet* p);
 
+/**
+ * uwifi_radiotap_vendor_cb - parser for a radiotap vendor namespace
+ * @data: vendor namespace data inside the radiotap header, only valid
+ *	during the callback
+ * @len: length of data
+ */
+typedef void (*uwifi_radiotap_vendor_cb)(const unsigned char* data, size_t len,
+					 struct uwifi_packet* p, void* ctx);
+
+/* register parser for vendor namespace OUI / sub namespace, replaces an
+ * already registered one. Returns false when there is no more space */
+bool uwifi_radiotap_vendor_register(uint32_t oui, uint8_t subns,
+				    uwifi_radiotap_vendor_cb cb, void* ctx);
+
+void uwifi_radiotap_vendor_unregister(uint32_t oui, uint8_t subns);
+
 /* return consumed length or -1 on error */
 int uwifi_parse_prism_header(unsigned char* buf, int len, struct uwifi_packet* p);
 
 void uwifi_fixup_packet_channel(struct uwifi_packet* p, struct uwifi_interface* intf);
 
+/* set pkt_time from kernel timestamp and TSF, call after uwifi_parse_raw() */
+void uwifi_fixup_packet_time(struct uwifi_packet* p, struct uwifi_interface* intf);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,297 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <liburing.h>
+
+#include "uring.h"
+#include "util.h"
+#include "log.h"
+
+#define URING_ENTRIES		64
+#define URING_MAX_SOURCES	8
+#define URING_BGID		1
+
+struct uring_source {
+	int	fd;
+	int	tag;
+};
+
+struct uwifi_uring {
+	struct io_uring			ring;
+	struct io_uring_buf_ring*	br;
+	unsigned char*			bufs;
+	unsigned int			nbufs;
+	unsigned int			bufsize;
+	struct uring_source		src[URING_MAX_SOURCES];
+	int				num_src;
+};
+
+#define URING_DATA(_ev, _idx)	(((uint64_t)(_ev) << 32) | (uint32_t)(_idx))
+#define URING_DATA_EV(_d)	((enum uwifi_uring_event)((_d) >> 32))
+#define URING_DATA_IDX(_d)	((int)((_d) & 0xffffffff))
+
+/* only used while probing in uwifi_uring_init() */
+#define URING_PROBE_RECV	UINT64_MAX
+#define URING_PROBE_CANCEL	(UINT64_MAX - 1)
+
+static void uring_buf_return(struct uwifi_uring* u, struct io_uring_cqe* cqe)
+{
+	unsigned int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+	io_uring_buf_ring_add(u->br, u->bufs + bid * u->bufsize, u->bufsize, bid,
+			      io_uring_buf_ring_mask(u->nbufs), 0);
+	io_uring_buf_ring_advance(u->br, 1);
+}
+
+/*
+ * Provided buffer rings came with Linux 5.19, multishot recv only with 6.0,
+ * which fails with -EINVAL. Try it on a socketpair with data waiting, so
+ * the recv completes immediately.
+ */
+static bool uring_probe_multishot(struct uwifi_uring* u)
+{
+	struct io_uring_sqe* sqe;
+	struct io_uring_cqe* cqe;
+	bool ok = false, more = false;
+	int sv[2];
+
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) < 0)
+		return false;
+	if (write(sv[1], "", 1) != 1)
+		goto out;
+
+	sqe = io_uring_get_sqe(&u->ring);
+	if (sqe == NULL)
+		goto out;
+	io_uring_prep_recv_multishot(sqe, sv[0], NULL, 0, 0);
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BGID;
+	io_uring_sqe_set_data64(sqe, URING_PROBE_RECV);
+	if (io_uring_submit(&u->ring) < 0 || io_uring_wait_cqe(&u->ring, &cqe) < 0)
+		goto out;
+
+	ok = cqe->res >= 0;
+	more = cqe->flags & IORING_CQE_F_MORE;
+	if (cqe->flags & IORING_CQE_F_BUFFER)
+		uring_buf_return(u, cqe);
+	io_uring_cqe_seen(&u->ring, cqe);
+
+	if (more) {
+		/* wait for both the cancel and the final recv completion */
+		int pending = 2;
+
+		sqe = io_uring_get_sqe(&u->ring);
+		if (sqe == NULL) {
+			ok = false;
+			goto out;
+		}
+		io_uring_prep_cancel64(sqe, URING_PROBE_RECV, 0);
+		io_uring_sqe_set_data64(sqe, URING_PROBE_CANCEL);
+		io_uring_submit(&u->ring);
+
+		while (pending > 0 && io_uring_wait_cqe(&u->ring, &cqe) == 0) {
+			if (io_uring_cqe_get_data64(cqe) == URING_PROBE_CANCEL ||
+			    !(cqe->flags & IORING_CQE_F_MORE))
+				pending--;
+			if (cqe->flags & IORING_CQE_F_BUFFER)
+				uring_buf_return(u, cqe);
+			io_uring_cqe_seen(&u->ring, cqe);
+		}
+	}
+
+out:
+	close(sv[0]);
+	close(sv[1]);
+	return ok;
+}
+
+struct uwifi_uring* uwifi_uring_init(unsigned int nbufs, unsigned int bufsize)
+{
+	struct uwifi_uring* u;
+	int ret;
+
+	if (!is_power_of_2(nbufs)) {
+		LOG_ERR("io_uring: number of buffers has to be a power of two");
+		return NULL;
+	}
+
+	u = malloc(sizeof(struct uwifi_uring));
+	if (u == NULL)
+		return NULL;
+	memset(u, 0, sizeof(struct uwifi_uring));
+
+	ret = io_uring_queue_init(URING_ENTRIES, &u->ring, 0);
+	if (ret < 0) {
+		LOG_INF("io_uring not available (%s)", strerror(-ret));
+		free(u);
+		return NULL;
+	}
+
+	u->br = io_uring_setup_buf_ring(&u->ring, nbufs, URING_BGID, 0, &ret);
+	if (u->br == NULL) {
+		LOG_INF("io_uring: provided buffer rings not available (%s)",
+			strerror(-ret));
+		io_uring_queue_exit(&u->ring);
+		free(u);
+		return NULL;
+	}
+
+	u->nbufs = nbufs;
+	u->bufsize = bufsize;
+	u->bufs = malloc((size_t)nbufs * bufsize);
+	if (u->bufs == NULL) {
+		uwifi_uring_free(u);
+		return NULL;
+	}
+
+	for (unsigned int i = 0; i < nbufs; i++)
+		io_uring_buf_ring_add(u->br, u->bufs + i * bufsize, bufsize, i,
+				      io_uring_buf_ring_mask(nbufs), i);
+	io_uring_buf_ring_advance(u->br, nbufs);
+
+	if (!uring_probe_multishot(u)) {
+		LOG_INF("io_uring: multishot recv not available");
+		uwifi_uring_free(u);
+		return NULL;
+	}
+
+	return u;
+}
+
+static bool uring_arm_recv(struct uwifi_uring* u, int idx)
+{
+	struct io_uring_sqe* sqe = io_uring_get_sqe(&u->ring);
+	if (sqe == NULL)
+		return false;
+
+	io_uring_prep_recv_multishot(sqe, u->src[idx].fd, NULL, 0, 0);
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BGID;
+	io_uring_sqe_set_data64(sqe, URING_DATA(UWIFI_URING_RECV, idx));
+	return true;
+}
+
+/* the SQ can be full of re-arms and timers of this batch, flush it once */
+static bool uring_rearm_recv(struct uwifi_uring* u, int idx)
+{
+	if (uring_arm_recv(u, idx))
+		return true;
+	return io_uring_submit(&u->ring) >= 0 && uring_arm_recv(u, idx);
+}
+
+bool uwifi_uring_add_recv(struct uwifi_uring* u, int fd, int tag)
+{
+	if (u->num_src >= URING_MAX_SOURCES)
+		return false;
+
+	u->src[u->num_src].fd = fd;
+	u->src[u->num_src].tag = tag;
+
+	if (!uring_arm_recv(u, u->num_src))
+		return false;
+
+	u->num_src++;
+	return io_uring_submit(&u->ring) >= 0;
+}
+
+bool uwifi_uring_add_timer(struct uwifi_uring* u, uint32_t usec, int tag)
+{
+	struct __kernel_timespec ts;
+	struct io_uring_sqe* sqe = io_uring_get_sqe(&u->ring);
+	if (sqe == NULL)
+		return false;
+
+	ts.tv_sec = usec / 1000000;
+	ts.tv_nsec = (usec % 1000000) * 1000;
+
+	io_uring_prep_timeout(sqe, &ts, 0, 0);
+	io_uring_sqe_set_data64(sqe, URING_DATA(UWIFI_URING_TIMER, tag));
+
+	/* the kernel copies the timespec when the SQE is submitted */
+	return io_uring_submit(&u->ring) >= 0;
+}
+
+static void uring_handle_recv(struct uwifi_uring* u, struct io_uring_cqe* cqe,
+			      int idx, uwifi_uring_cb cb, void* ctx)
+{
+	if (idx < 0 || idx >= u->num_src)
+		return;
+
+	if (cqe->flags & IORING_CQE_F_BUFFER) {
+		unsigned int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+		cb(UWIFI_URING_RECV, u->src[idx].tag, u->bufs + bid * u->bufsize,
+		   cqe->res, ctx);
+		/* give buffer back to the kernel */
+		uring_buf_return(u, cqe);
+	} else if (cqe->res < 0 && cqe->res != -ENOBUFS) {
+		cb(UWIFI_URING_RECV, u->src[idx].tag, NULL, cqe->res, ctx);
+	}
+
+	if (cqe->flags & IORING_CQE_F_MORE)
+		return;
+
+	/* multishot ended: continue when it only ran out of buffers, but
+	 * re-arming after a real error would just fail again */
+	if (cqe->res >= 0 || cqe->res == -ENOBUFS) {
+		LOG_DBG("io_uring: re-arming recv on fd %d (%d)",
+			u->src[idx].fd, cqe->res);
+		if (uring_rearm_recv(u, idx))
+			return;
+		LOG_ERR("io_uring: no SQE to re-arm recv on fd %d, stopped",
+			u->src[idx].fd);
+		cb(UWIFI_URING_RECV, u->src[idx].tag, NULL, -EBUSY, ctx);
+	} else {
+		LOG_ERR("io_uring: recv on fd %d failed (%s), stopped",
+			u->src[idx].fd, strerror(-cqe->res));
+	}
+}
+
+int uwifi_uring_run(struct uwifi_uring* u, uwifi_uring_cb cb, void* ctx)
+{
+	struct io_uring_cqe* cqe;
+	unsigned int head;
+	int count = 0;
+
+	int ret = io_uring_submit_and_wait(&u->ring, 1);
+	if (ret < 0 && ret != -EINTR && ret != -ETIME) {
+		LOG_ERR("io_uring: wait failed (%s)", strerror(-ret));
+		return -1;
+	}
+
+	io_uring_for_each_cqe(&u->ring, head, cqe) {
+		uint64_t data = io_uring_cqe_get_data64(cqe);
+
+		if (URING_DATA_EV(data) == UWIFI_URING_RECV)
+			uring_handle_recv(u, cqe, URING_DATA_IDX(data), cb, ctx);
+		else
+			cb(UWIFI_URING_TIMER, URING_DATA_IDX(data), NULL, 0, ctx);
+		count++;
+	}
+	io_uring_cq_advance(&u->ring, count);
+
+	/* re-armed receives are submitted with the next wait */
+	return count;
+}
+
+void uwifi_uring_free(struct uwifi_uring* u)
+{
+	if (u == NULL)
+		return;
+	if (u->br != NULL)
+		io_uring_free_buf_ring(&u->ring, u->br, u->nbufs, URING_BGID);
+	io_uring_queue_exit(&u->ring);
+	free(u->bufs);
+	free(u);
+}
@@ -0,0 +1,77 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_URING_H_
+#define _UWIFI_URING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Optional io_uring event loop for packet sockets, netlink sockets and
+ * timers. Receives use multishot recv with a provided buffer ring, so one
+ * submission keeps delivering packets without further syscalls.
+ *
+ * uwifi_uring_init() returns NULL when io_uring, provided buffer rings or
+ * multishot recv are not available, in that case use packet_socket_recv()
+ * and nl80211_send_recv() as before.
+ */
+
+struct uwifi_uring;
+
+enum uwifi_uring_event {
+	UWIFI_URING_RECV,	/* data received on fd, len < 0 is -errno
+				 * after which the fd is not received on,
+				 * -EBUSY if it could not be re-armed */
+	UWIFI_URING_TIMER,	/* timer expired */
+};
+
+/**
+ * uwifi_uring_cb - completion callback
+ * @ev: event type
+ * @tag: tag given when adding the fd or timer
+ * @buf: received data, only valid during the callback
+ * @len: length of data or negative error
+ */
+typedef void (*uwifi_uring_cb)(enum uwifi_uring_event ev, int tag,
+			       const unsigned char* buf, ssize_t len, void* ctx);
+
+/**
+ * uwifi_uring_init() - set up ring and provided buffers
+ * @nbufs: number of receive buffers, has to be a power of 2
+ * @bufsize: size of each receive buffer
+ */
+struct uwifi_uring* uwifi_uring_init(unsigned int nbufs, unsigned int bufsize);
+
+/** Start multishot receive on @fd (packet or netlink socket) */
+bool uwifi_uring_add_recv(struct uwifi_uring* u, int fd, int tag);
+
+/** One-shot timer firing after @usec, e.g. for channel dwell time */
+bool uwifi_uring_add_timer(struct uwifi_uring* u, uint32_t usec, int tag);
+
+/**
+ * uwifi_uring_run() - wait for and process completions
+ *
+ * Waits for at least one completion and then handles all which are ready,
+ * calling @cb for each. Returns the number of completions or -1 on error.
+ */
+int uwifi_uring_run(struct uwifi_uring* u, uwifi_uring_cb cb, void* ctx);
+
+void uwifi_uring_free(struct uwifi_uring* u);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _UWIFI_URING_H_
@@ -0,0 +1,48 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#ifndef _UWIFI_TEST_CHECK_H_
+#define _UWIFI_TEST_CHECK_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* failed checks, the test fails at the end if any */
+extern int check_errors;
+
+/* returned by plat_time_usec() of stubs.c */
+extern uint32_t test_time_usec;
+
+#define CHECK(_c) do {							\
+	if (!(_c)) {							\
+		printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #_c);	\
+		check_errors++;						\
+	}								\
+} while (0)
+
+#define CHECK_EQ(_a, _b) do {						\
+	long long _va = (_a), _vb = (_b);				\
+	if (_va != _vb) {						\
+		printf("FAIL %s:%d: %s == %s (%lld != %lld)\n",		\
+		       __FILE__, __LINE__, #_a, #_b, _va, _vb);		\
+		check_errors++;						\
+	}								\
+} while (0)
+
+static inline int check_result(void)
+{
+	if (check_errors) {
+		printf("FAIL: %d checks\n", check_errors);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
+
+#endif
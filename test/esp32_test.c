@@ -0,0 +1,122 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/*
+ * Host test of the ESP32 parser, replaying esp32_dump.bin through
+ * uwifi_esp32_replay(). The dump has one record of each kind:
+ *
+ *  1. beacon "uwifi", 1M long preamble, -50 dBm, channel 6
+ *  2. QoS data, HT MCS 7 HT40 SGI, secondary above, -67 dBm, channel 1
+ *  3. data, 54M, -80 dBm, channel 11
+ *  4. data, 11M short preamble, -72 dBm, channel 11
+ *  5. MISC without payload, -90 dBm, channel 13
+ *  6. data, 6M, with rx_state error, -60 dBm, channel 6
+ *  7. ACK, 11M long preamble, with a sig_len longer than the record,
+ *     -55 dBm, channel 6
+ *
+ * The noise floor is -95 dBm and the timestamps are 1000 usec apart.
+ */
+
+#include <string.h>
+
+#include "wlan_parser.h"
+#include "wlan_util.h"
+#include "esp32/esp32_promisc.h"
+#include "check.h"
+
+#define DUMP		"esp32_dump.bin"
+#define NUM_RECORDS	7
+
+static struct uwifi_packet pkts[NUM_RECORDS];
+static bool parsed[NUM_RECORDS];
+static int num;
+static char essid[WLAN_MAX_SSID_LEN];	/* points into the record */
+
+static void replay_cb(struct uwifi_packet* p, bool ok, void* ctx)
+{
+	(void)ctx;
+	if (num < NUM_RECORDS) {
+		pkts[num] = *p;
+		parsed[num] = ok;
+		if (p->wlan_essid_len > 0)
+			memcpy(essid, p->wlan_essid, p->wlan_essid_len);
+	}
+	num++;
+}
+
+static void check_phy(int i, int signal, int freq, int rate)
+{
+	struct uwifi_packet* p = &pkts[i];
+
+	printf("record %d: parsed %d signal %d freq %d rate %d\n", i + 1,
+	       parsed[i], p->phy_signal, p->phy_freq, p->phy_rate);
+	CHECK_EQ(p->phy_signal, signal);
+	CHECK_EQ(p->phy_noise, -95);
+	CHECK_EQ(p->phy_snr, signal + 95);
+	CHECK_EQ(p->phy_freq, freq);
+	CHECK_EQ(p->phy_rate, rate);
+	CHECK_EQ(p->phy_tsf, 1000 * (i + 1));
+}
+
+int main(void)
+{
+	struct uwifi_packet* p;
+
+	CHECK_EQ(uwifi_esp32_replay(DUMP, NULL, replay_cb, NULL), NUM_RECORDS);
+	CHECK_EQ(num, NUM_RECORDS);
+
+	/* legacy long preamble */
+	check_phy(0, -50, 2437, 10);
+	p = &pkts[0];
+	CHECK(parsed[0]);
+	CHECK_EQ(p->wlan_type, WLAN_FRAME_BEACON);
+	CHECK(p->phy_flags & PHY_FLAG_B);
+	CHECK(!(p->phy_flags & PHY_FLAG_SHORTPRE));
+	CHECK_EQ(p->phy_rate_idx, wlan_rate_to_index(10));
+	CHECK_EQ(p->wlan_essid_len, 5);
+	CHECK(memcmp(essid, "uwifi", 5) == 0);
+
+	/* HT: MCS 7, 40 MHz, short GI */
+	check_phy(1, -67, 2412, 1500);
+	p = &pkts[1];
+	CHECK(parsed[1]);
+	CHECK_EQ(p->wlan_type, WLAN_FRAME_QDATA);
+	CHECK_EQ(p->phy_rate_idx, 12 + 7);
+	CHECK_EQ(p->phy_rate_flags, 0x01 | 0x04);
+	CHECK(p->phy_flags & PHY_FLAG_G);
+	CHECK(p->wlan_ht40plus);
+
+	/* OFDM and short preamble */
+	check_phy(2, -80, 2462, 540);
+	CHECK(parsed[2]);
+	CHECK(pkts[2].phy_flags & PHY_FLAG_G);
+	CHECK(!(pkts[2].phy_flags & PHY_FLAG_B));
+	CHECK_EQ(pkts[2].wlan_type, WLAN_FRAME_DATA);
+	check_phy(3, -72, 2462, 110);
+	CHECK(parsed[3]);
+	CHECK(pkts[3].phy_flags & PHY_FLAG_B);
+	CHECK(pkts[3].phy_flags & PHY_FLAG_SHORTPRE);
+
+	/* no payload and errors are not parsed, the PHY values are there */
+	check_phy(4, -90, 2472, 10);
+	CHECK(!parsed[4]);
+	CHECK_EQ(pkts[4].wlan_type, 0);
+	check_phy(5, -60, 2437, 60);
+	CHECK(!parsed[5]);
+	CHECK(pkts[5].phy_flags & PHY_FLAG_BADFCS);
+
+	/* sig_len is clamped to the record */
+	check_phy(6, -55, 2437, 110);
+	CHECK(parsed[6]);
+	CHECK_EQ(pkts[6].wlan_type, WLAN_FRAME_ACK);
+	CHECK_EQ(pkts[6].wlan_len, 10);
+
+	CHECK_EQ(uwifi_esp32_replay("does-not-exist.bin", NULL, replay_cb, NULL), -1);
+	return check_result();
+}
@@ -0,0 +1,18 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/* Stand-in for the ESP8266 SDK header, to build esp8266/ in the host tests */
+
+#ifndef _ETS_SYS_H_
+#define _ETS_SYS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#endif
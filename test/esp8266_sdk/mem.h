@@ -0,0 +1,24 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/* Stand-in for the ESP8266 SDK header, to build esp8266/ in the host tests */
+
+#ifndef _MEM_H_
+#define _MEM_H_
+
+#include <stddef.h>
+
+/* not stdlib.h, it defines le16toh() like esp8266/platform.h */
+void* malloc(size_t size);
+void free(void* ptr);
+
+#define os_malloc		malloc
+#define os_free			free
+
+#endif
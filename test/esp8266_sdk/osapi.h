@@ -0,0 +1,25 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/* Stand-in for the ESP8266 SDK header, to build esp8266/ in the host tests:
+ * output is discarded, memory functions are the ones of libc */
+
+#ifndef _OSAPI_H_
+#define _OSAPI_H_
+
+#include <stdio.h>
+#include <string.h>
+
+#define os_printf(...)		((void)0)
+#define os_sprintf		sprintf
+#define os_memcpy		memcpy
+#define os_memset		memset
+#define os_memcmp		memcmp
+
+#endif
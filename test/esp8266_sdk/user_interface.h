@@ -0,0 +1,19 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/* Stand-in for the ESP8266 SDK header, to build esp8266/ in the host tests */
+
+#ifndef _USER_INTERFACE_H_
+#define _USER_INTERFACE_H_
+
+#include "os_type.h"
+
+uint32_t system_get_time(void);
+
+#endif
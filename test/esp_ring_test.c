@@ -0,0 +1,232 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/*
+ * Host test of the ring between the ESP8266 promiscuous RX callback and the
+ * parsing task, built from esp8266/esp_promisc.c with stand-ins for the SDK
+ * headers (esp8266_sdk/).
+ *
+ * First data callbacks longer than a slot are copied up to the slot size,
+ * without touching the next slot, but parsed by their original length.
+ * Then a producer thread calls uwifi_esp_rx_cb() like the SDK, while the
+ * consumer checks that frames arrive complete, in order and that every
+ * frame was either received or counted as a drop.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "wlan_parser.h"
+#include "esp8266/esp_promisc.h"
+#include "check.h"
+
+#define NUM_RECORDS	200000
+#define CB_MAX		512
+#define LEN_LONG	150	/* data callback with 10 LenSeq, longer than a slot */
+#define HDR_DATA	36	/* parsed from data callbacks */
+#define HDR_MGMT	112	/* parsed from management callbacks */
+
+static volatile int producer_done;
+
+/* ESP callbacks are 12 (no header), 128 (management) or 50 + n * 10
+ * (data with n LenSeq) bytes long */
+static uint16_t rec_len(uint32_t seq)
+{
+	switch (seq % 4) {
+	case 0:
+		return 12;
+	case 1:
+		return 128;
+	default:
+		return 60 + (seq % 12) * 10;
+	}
+}
+
+static int8_t rec_rssi(uint32_t seq)
+{
+	return -10 - (int)(seq % 90);
+}
+
+/* the sequence number is in the transmitter address */
+static uint32_t ta_seq(const struct uwifi_packet* p)
+{
+	uint32_t seq;
+
+	memcpy(&seq, p->wlan_ta + 2, sizeof(seq));
+	return seq;
+}
+
+/* callback buffer as the SDK passes it, the rest of @buf is garbage */
+static void make_cb(uint8_t* buf, uint32_t seq, uint16_t len)
+{
+	struct RxControl* rxc = (struct RxControl*)buf;
+	uint8_t* wh;
+
+	memset(buf, 0xee, CB_MAX);
+	memset(rxc, 0, sizeof(struct RxControl));
+	rxc->rssi = rec_rssi(seq);
+	rxc->channel = 6;
+	if (len == 12)
+		return;
+
+	if (len == sizeof(struct sniffer_buf2)) {
+		struct sniffer_buf2* sb2 = (struct sniffer_buf2*)buf;
+		wh = sb2->buf;
+		memset(wh, 0, sizeof(sb2->buf));
+		sb2->cnt = 1;
+		sb2->len = sizeof(sb2->buf);
+		wh[0] = 0x80;			/* beacon */
+		memset(wh + 4, 0xff, WLAN_MAC_LEN);
+		wh[16] = 0x02;			/* BSSID */
+	} else {
+		struct sniffer_buf* sb = (struct sniffer_buf*)buf;
+		wh = sb->buf;
+		memset(wh, 0, sizeof(sb->buf));
+		sb->cnt = (len - 50) / 10;
+		sb->lenseq[0].length = 1500;
+		wh[0] = 0x88;			/* QoS data */
+		wh[1] = 0x01;			/* to DS */
+		wh[4] = 0x02;			/* BSSID */
+		wh[16] = 0x04;			/* DA */
+	}
+	wh[10] = 0x02;				/* TA */
+	memcpy(wh + 12, &seq, sizeof(seq));
+}
+
+static void check_pkt(const struct uwifi_packet* p, bool parsed, uint32_t seq)
+{
+	CHECK(parsed);
+	CHECK_EQ(ta_seq(p), seq);
+	CHECK_EQ(p->phy_signal, rec_rssi(seq));
+	if (rec_len(seq) == 128) {
+		CHECK_EQ(p->wlan_type, WLAN_FRAME_BEACON);
+		CHECK_EQ(p->wlan_len, HDR_MGMT);
+	} else {
+		CHECK_EQ(p->wlan_type, WLAN_FRAME_QDATA);
+		CHECK_EQ(p->wlan_len, HDR_DATA);
+	}
+}
+
+static void test_clamp(void)
+{
+	static uint8_t buf[CB_MAX];
+	struct uwifi_packet pkt;
+	bool parsed;
+	uint32_t seq;
+
+	/* long data callbacks fill the ring, one more is dropped */
+	for (seq = 2; seq < 2 + UWIFI_ESP_RING_SLOTS + 1; seq++) {
+		make_cb(buf, seq, LEN_LONG);
+		uwifi_esp_rx_cb(buf, LEN_LONG);
+	}
+	CHECK_EQ(uwifi_esp_ring_drops(), 1);
+
+	/* the first slot is written again while the next is still queued */
+	CHECK(uwifi_esp_ring_parse(&pkt, &parsed, NULL));
+	CHECK(parsed);
+	CHECK_EQ(ta_seq(&pkt), 2);
+	CHECK_EQ(pkt.wlan_type, WLAN_FRAME_QDATA);
+	CHECK_EQ(pkt.wlan_len, HDR_DATA);
+	make_cb(buf, 1000, LEN_LONG);
+	uwifi_esp_rx_cb(buf, LEN_LONG);
+
+	for (seq = 3; seq < 2 + UWIFI_ESP_RING_SLOTS; seq++) {
+		CHECK(uwifi_esp_ring_parse(&pkt, &parsed, NULL));
+		CHECK(parsed);
+		CHECK_EQ(ta_seq(&pkt), seq);
+		CHECK_EQ(pkt.phy_signal, rec_rssi(seq));
+		CHECK_EQ(pkt.wlan_type, WLAN_FRAME_QDATA);
+		CHECK_EQ(pkt.wlan_len, HDR_DATA);
+	}
+	CHECK(uwifi_esp_ring_parse(&pkt, &parsed, NULL));
+	CHECK(parsed);
+	CHECK_EQ(ta_seq(&pkt), 1000);
+	CHECK(!uwifi_esp_ring_parse(&pkt, &parsed, NULL));
+
+	/* management callbacks are exactly one slot, the short ones have
+	 * nothing to parse */
+	make_cb(buf, 1, 128);
+	uwifi_esp_rx_cb(buf, 128);
+	make_cb(buf, 4, 12);
+	uwifi_esp_rx_cb(buf, 12);
+	CHECK(uwifi_esp_ring_parse(&pkt, &parsed, NULL));
+	check_pkt(&pkt, parsed, 1);
+	CHECK(uwifi_esp_ring_parse(&pkt, &parsed, NULL));
+	CHECK(!parsed);
+	CHECK(!uwifi_esp_ring_parse(&pkt, &parsed, NULL));
+}
+
+static void* producer(void* arg)
+{
+	uint8_t buf[CB_MAX];
+
+	(void)arg;
+	for (uint32_t seq = 0; seq < NUM_RECORDS; seq++) {
+		/* frames arrive in bursts */
+		if (seq % 32 == 0)
+			sched_yield();
+
+		make_cb(buf, seq, rec_len(seq));
+		uwifi_esp_rx_cb(buf, rec_len(seq));
+	}
+	__atomic_store_n(&producer_done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void test_threads(void)
+{
+	struct uwifi_packet pkt;
+	uint32_t received = 0, short_cbs = 0, seq, last = 0, drops;
+	bool parsed, done, first = true;
+	int err = check_errors;
+	pthread_t thr;
+
+	CHECK(uwifi_esp_ring_init());
+	pthread_create(&thr, NULL, producer, NULL);
+
+	while (1) {
+		/* empty after the producer is done: all frames were seen */
+		done = __atomic_load_n(&producer_done, __ATOMIC_ACQUIRE);
+		memset(&pkt, 0, sizeof(pkt));
+		if (!uwifi_esp_ring_parse(&pkt, &parsed, NULL)) {
+			if (done)
+				break;
+			sched_yield();
+			continue;
+		}
+		received++;
+
+		/* nothing to check in short ones */
+		if (!parsed && pkt.wlan_type == 0) {
+			short_cbs++;
+			continue;
+		}
+		seq = ta_seq(&pkt);
+		CHECK(first || seq > last);
+		check_pkt(&pkt, parsed, seq);
+		if (check_errors > err + 10)
+			break;
+		first = false;
+		last = seq;
+	}
+	pthread_join(thr, NULL);
+
+	drops = uwifi_esp_ring_drops();
+	printf("received %u (%u short) dropped %u\n", received, short_cbs, drops);
+	CHECK_EQ(received + drops, NUM_RECORDS);
+}
+
+int main(void)
+{
+	CHECK(uwifi_esp_ring_init());
+	test_clamp();
+	test_threads();
+	return check_result();
+}
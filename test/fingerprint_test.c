@@ -0,0 +1,110 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/*
+ * Host test of the grouping of randomized MACs: a device probes with two
+ * locally administered MACs which have the same fingerprint and an AP
+ * answers both. Requests and responses have to be accounted to one node
+ * for the device, while an unknown randomized MAC still gets its own.
+ */
+
+#include <string.h>
+
+#include "wlan_parser.h"
+#include "node.h"
+#include "fingerprint.h"
+#include "check.h"
+
+#define FP	0x1234abcd
+
+static struct cc_list_head nodes;
+static struct uwifi_fp_table fps;
+
+static const unsigned char mac_a[WLAN_MAC_LEN] = { 0xda, 0xa1, 0x19, 0x01, 0x02, 0x03 };
+static const unsigned char mac_b[WLAN_MAC_LEN] = { 0x6e, 0x44, 0x05, 0x71, 0x8c, 0x2f };
+static const unsigned char mac_c[WLAN_MAC_LEN] = { 0x2a, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static const unsigned char mac_ap[WLAN_MAC_LEN] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+
+static struct uwifi_node* probe_req(const unsigned char* mac)
+{
+	struct uwifi_packet p;
+
+	memset(&p, 0, sizeof(p));
+	p.wlan_type = WLAN_FRAME_PROBE_REQ;
+	p.wlan_mode = WLAN_MODE_PROBE;
+	p.wlan_fingerprint = FP;
+	memcpy(p.wlan_ta, mac, WLAN_MAC_LEN);
+	memset(p.wlan_ra, 0xff, WLAN_MAC_LEN);
+	uwifi_fingerprint_group(&fps, &p);
+	return uwifi_node_update(&p, &nodes);
+}
+
+static struct uwifi_node* probe_resp(const unsigned char* mac)
+{
+	struct uwifi_packet p;
+
+	memset(&p, 0, sizeof(p));
+	p.wlan_type = WLAN_FRAME_PROBE_RESP;
+	p.wlan_mode = WLAN_MODE_AP;
+	memcpy(p.wlan_ta, mac_ap, WLAN_MAC_LEN);
+	memcpy(p.wlan_bssid, mac_ap, WLAN_MAC_LEN);
+	memcpy(p.wlan_ra, mac, WLAN_MAC_LEN);
+	uwifi_node_update(&p, &nodes);
+	uwifi_fingerprint_group_receiver(&fps, &p);
+	return uwifi_node_update_receiver(&p, &nodes);
+}
+
+static int node_count(void)
+{
+	struct uwifi_node* n;
+	int num = 0;
+
+	cc_list_for_each(&nodes, n, list)
+		num++;
+	return num;
+}
+
+int main(void)
+{
+	struct uwifi_node* dev;
+	const struct uwifi_fp_entry* e;
+
+	cc_list_head_init(&nodes);
+	uwifi_fingerprint_init(&fps, 60);
+
+	/* first MAC: the device is known by it */
+	dev = probe_req(mac_a);
+	CHECK(dev != NULL);
+	CHECK(probe_resp(mac_a) == dev);
+
+	/* second MAC, request and response */
+	test_time_usec += 1000000;
+	CHECK(probe_req(mac_b) == dev);
+	CHECK(probe_resp(mac_b) == dev);
+	CHECK_EQ(node_count(), 2);
+	CHECK_EQ(dev->pkt_count, 2);
+	CHECK_EQ(dev->rx_pkt_count, 2);
+
+	e = uwifi_fingerprint_find(&fps, FP);
+	CHECK(e != NULL && e->num_macs == 2);
+	CHECK(e != NULL && memcmp(e->mac, mac_a, WLAN_MAC_LEN) == 0);
+	CHECK(e != NULL && memcmp(e->last_mac, mac_b, WLAN_MAC_LEN) == 0);
+
+	/* a randomized MAC no device probed with is a node of its own */
+	CHECK(probe_resp(mac_c) != dev);
+	CHECK_EQ(node_count(), 3);
+
+	/* after the device expired the MAC is not mapped any more */
+	test_time_usec += 61000000;
+	CHECK(probe_resp(mac_b) != dev);
+	CHECK_EQ(node_count(), 4);
+
+	uwifi_nodes_free(&nodes);
+	return check_result();
+}
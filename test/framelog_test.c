@@ -0,0 +1,240 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/*
+ * Host test of the frame log: frames are written and read back, a full
+ * block of UWIFI_FRAMELOG_BLOCK records and a partial one whose columns
+ * are moved together, compressed from repetitive frames and stored raw
+ * from random ones. Corrupt and truncated blocks have to be rejected.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "wlan_parser.h"
+#include "framelog.h"
+#include "check.h"
+
+#define NUM		(UWIFI_FRAMELOG_BLOCK + 100)
+#define BUF_LEN		(4 * (UWIFI_FRAMELOG_HDR_LEN + UWIFI_LZ_BOUND(UWIFI_FRAMELOG_RAW_LEN)))
+
+static struct uwifi_framelog_writer w;
+static struct uwifi_framelog_block blk;
+static struct uwifi_packet pkts[NUM];
+static uint8_t buf[BUF_LEN];
+static size_t buf_len;
+static int num_blocks;
+
+static bool flush_cb(const uint8_t* data, size_t len, void* ctx)
+{
+	(void)ctx;
+	if (buf_len + len > BUF_LEN)
+		return false;
+	memcpy(buf + buf_len, data, len);
+	buf_len += len;
+	num_blocks++;
+	return true;
+}
+
+/* every field different, from a few stations like real traffic or random */
+static void make_packets(bool random)
+{
+	uint64_t t = 1000000000ULL;
+
+	memset(pkts, 0, sizeof(pkts));
+	for (int i = 0; i < NUM; i++) {
+		struct uwifi_packet* p = &pkts[i];
+		int sta = i % 5;
+
+		t += random ? (uint64_t)rand() << 33 ^ (uint64_t)rand() << 2 ^ rand()
+			    : 100000 + i % 7U;
+		p->pkt_time = t;
+		for (int j = 0; j < WLAN_MAC_LEN; j++) {
+			p->wlan_ta[j] = random ? rand() : 0x10 + sta + j;
+			p->wlan_ra[j] = random ? rand() : 0x20 + j;
+		}
+		p->wlan_type = random ? rand() & 0xffff : WLAN_FRAME_QDATA;
+		p->phy_signal = random ? (int8_t)rand() : -40 - sta;
+		p->phy_rate = random ? rand() & 0xffff : 540;
+		p->wlan_len = random ? rand() & 0xffff : 1500 - sta;
+		p->phy_freq = random ? rand() & 0xffff : 2412 + 5 * sta;
+		p->wlan_retry = random ? rand() & 1 : i % 11 == 0;
+		if (random ? rand() & 1 : i % 13 == 0)
+			p->phy_flags |= PHY_FLAG_BADFCS;
+	}
+}
+
+static void check_rec(const struct uwifi_framelog_rec* r, const struct uwifi_packet* p)
+{
+	uint8_t flags = (p->wlan_retry ? UWIFI_FRAMELOG_F_RETRY : 0) |
+			(p->phy_flags & PHY_FLAG_BADFCS ? UWIFI_FRAMELOG_F_BADFCS : 0);
+
+	CHECK_EQ(r->time, p->pkt_time);
+	CHECK(memcmp(r->ta, p->wlan_ta, WLAN_MAC_LEN) == 0);
+	CHECK(memcmp(r->ra, p->wlan_ra, WLAN_MAC_LEN) == 0);
+	CHECK_EQ(r->type, p->wlan_type);
+	CHECK_EQ(r->signal, p->phy_signal);
+	CHECK_EQ(r->rate, p->phy_rate);
+	CHECK_EQ(r->len, p->wlan_len);
+	CHECK_EQ(r->freq, p->phy_freq);
+	CHECK_EQ(r->flags, flags);
+}
+
+/* write all packets, a full and a partial block, and read them back,
+ * @expect_lz: 1 compressed, 0 raw, -1 either */
+static void round_trip(bool random, bool compress, int expect_lz)
+{
+	struct uwifi_framelog_rec r;
+	size_t pos = 0;
+	int i = 0, ret, err = check_errors;
+
+	make_packets(random);
+	buf_len = num_blocks = 0;
+	uwifi_framelog_init(&w, compress, flush_cb, NULL);
+	for (int j = 0; j < NUM; j++)
+		CHECK(uwifi_framelog_add(&w, &pkts[j]));
+	CHECK_EQ(num_blocks, 1);
+	CHECK(uwifi_framelog_flush(&w));
+	CHECK_EQ(num_blocks, 2);
+	CHECK(uwifi_framelog_flush(&w));
+	CHECK_EQ(num_blocks, 2);
+
+	printf("%-6s %-5s %zu bytes for %d records, raw %d\n",
+	       random ? "random" : "repeat", compress ? "lz" : "raw", buf_len,
+	       NUM, NUM * UWIFI_FRAMELOG_REC_LEN);
+
+	while (pos < buf_len) {
+		ret = uwifi_framelog_read(buf + pos, buf_len - pos, &blk);
+		CHECK(ret > 0);
+		if (ret <= 0)
+			return;
+		if (expect_lz >= 0)
+			CHECK_EQ((buf[pos + 5] & UWIFI_FRAMELOG_LZ) != 0, expect_lz);
+		CHECK_EQ(blk.num, pos == 0 ? UWIFI_FRAMELOG_BLOCK : NUM - UWIFI_FRAMELOG_BLOCK);
+		for (unsigned int j = 0; j < blk.num; j++, i++) {
+			uwifi_framelog_get(&blk, j, &r);
+			check_rec(&r, &pkts[i]);
+			if (check_errors > err) {
+				printf("record %d wrong\n", i);
+				return;
+			}
+		}
+		pos += ret;
+	}
+	CHECK_EQ(i, NUM);
+}
+
+static int read_block(const uint8_t* b, size_t len)
+{
+	return uwifi_framelog_read(b, len, &blk);
+}
+
+/* the random records of the last round trip do not compress and are
+ * stored raw although LZ is on */
+static void test_small(void)
+{
+	struct uwifi_framelog_rec r;
+
+	buf_len = num_blocks = 0;
+	uwifi_framelog_init(&w, true, flush_cb, NULL);
+	for (int i = 0; i < 3; i++)
+		CHECK(uwifi_framelog_add(&w, &pkts[i]));
+	CHECK(uwifi_framelog_flush(&w));
+	CHECK_EQ(num_blocks, 1);
+	CHECK_EQ(buf[5] & UWIFI_FRAMELOG_LZ, 0);
+	CHECK_EQ(read_block(buf, buf_len), (int)buf_len);
+	CHECK_EQ(blk.num, 3);
+	for (unsigned int i = 0; i < blk.num; i++) {
+		uwifi_framelog_get(&blk, i, &r);
+		check_rec(&r, &pkts[i]);
+	}
+}
+
+/* the partial block is the second one */
+static uint8_t* second_block(void)
+{
+	uint8_t* b = buf;
+
+	b += UWIFI_FRAMELOG_HDR_LEN + (b[8] | b[9] << 8 | b[10] << 16);
+	return b;
+}
+
+static void put_len(uint8_t* b, uint32_t len)
+{
+	b[8] = len;
+	b[9] = len >> 8;
+	b[10] = len >> 16;
+	b[11] = len >> 24;
+}
+
+static void test_corrupt(void)
+{
+	uint8_t* b;
+	size_t len;
+	uint32_t data_len;
+
+	/* compressed */
+	round_trip(false, true, 1);
+	b = second_block();
+	len = buf + buf_len - b;
+	data_len = len - UWIFI_FRAMELOG_HDR_LEN;
+	CHECK_EQ(read_block(b, len), (int)len);
+
+	/* truncated: not complete yet */
+	CHECK_EQ(read_block(b, UWIFI_FRAMELOG_HDR_LEN - 1), 0);
+	CHECK_EQ(read_block(b, len - 1), 0);
+
+	/* data cut short */
+	put_len(b, data_len - 1);
+	CHECK_EQ(read_block(b, len), -1);
+	put_len(b, data_len);
+
+	/* more records than the data has */
+	b[6]++;
+	CHECK_EQ(read_block(b, len), -1);
+	b[6]--;
+
+	/* garbage data */
+	memset(b + UWIFI_FRAMELOG_HDR_LEN, 0xff, data_len);
+	CHECK_EQ(read_block(b, len), -1);
+
+	/* header */
+	b = buf;
+	b[0] = 'X';
+	CHECK_EQ(read_block(b, buf_len), -1);
+	b[0] = 'U';
+	b[4] = UWIFI_FRAMELOG_VERSION + 1;
+	CHECK_EQ(read_block(b, buf_len), -1);
+	b[4] = UWIFI_FRAMELOG_VERSION;
+	b[6] = b[7] = 0;
+	CHECK_EQ(read_block(b, buf_len), -1);
+	b[6] = (UWIFI_FRAMELOG_BLOCK + 1) & 0xff;
+	b[7] = (UWIFI_FRAMELOG_BLOCK + 1) >> 8;
+	CHECK_EQ(read_block(b, buf_len), -1);
+	put_len(b, UWIFI_LZ_BOUND(UWIFI_FRAMELOG_RAW_LEN) + 1);
+	CHECK_EQ(read_block(b, buf_len), -1);
+
+	/* raw: the length has to match the records */
+	round_trip(false, false, 0);
+	b = second_block();
+	len = buf + buf_len - b;
+	b[6]--;
+	CHECK_EQ(read_block(b, len), -1);
+}
+
+int main(void)
+{
+	srand(1);
+	round_trip(false, true, 1);
+	round_trip(false, false, 0);
+	round_trip(true, true, -1);
+	test_small();
+	test_corrupt();
+	return check_result();
+}
@@ -0,0 +1,138 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/*
+ * Host test of the interference estimator: an AP which was only seen as
+ * the receiver of its stations, or whose statistics were just reset by
+ * uwifi_nodes_reduce(), has no signal average and must not be weighted.
+ * Once its beacons are received its weight is bounded by its power.
+ */
+
+#include <string.h>
+
+#include "wlan_parser.h"
+#include "node.h"
+#include "ssid.h"
+#include "interference.h"
+#include "check.h"
+
+#define CHAN		6
+#define AP_SIGNAL	-60
+#define AP_POWER	10000	/* -60 dBm, 1 is -100 dBm */
+
+static void mac_of(unsigned char* mac, int id)
+{
+	memset(mac, 0, WLAN_MAC_LEN);
+	mac[5] = id;
+}
+
+/* data frame of the station to the AP */
+static void sta_packet(struct uwifi_interference* est, struct cc_list_head* nodes)
+{
+	struct uwifi_packet p;
+	struct uwifi_node* n;
+
+	memset(&p, 0, sizeof(p));
+	p.wlan_type = WLAN_FRAME_QDATA;
+	p.wlan_mode = WLAN_MODE_STA;
+	mac_of(p.wlan_ta, 2);
+	mac_of(p.wlan_ra, 1);
+	mac_of(p.wlan_bssid, 1);
+	p.wlan_channel = CHAN;
+	p.wlan_len = 1000;
+	p.phy_rate = 60;
+	p.phy_signal = -30;
+
+	n = uwifi_node_update(&p, nodes);
+	uwifi_node_update_receiver(&p, nodes);
+	uwifi_nodes_find_ap(n, nodes);
+	uwifi_interference_update(est, n, &p);
+}
+
+static void ap_beacon(struct uwifi_interference* est, struct cc_list_head* nodes)
+{
+	struct uwifi_packet p;
+	struct uwifi_node* n;
+
+	memset(&p, 0, sizeof(p));
+	p.wlan_type = WLAN_FRAME_BEACON;
+	p.wlan_mode = WLAN_MODE_AP;
+	mac_of(p.wlan_ta, 1);
+	mac_of(p.wlan_bssid, 1);
+	p.wlan_channel = CHAN;
+	p.wlan_len = 200;
+	p.phy_rate = 10;
+	p.phy_signal = AP_SIGNAL;
+
+	n = uwifi_node_update(&p, nodes);
+	uwifi_interference_update(est, n, &p);
+}
+
+int main(void)
+{
+	static struct uwifi_interference est, shard_est;
+	struct cc_list_head nodes, global, shard;
+	struct uwifi_ssid_table ssids;
+	uint64_t s;
+
+	cc_list_head_init(&nodes);
+	cc_list_head_init(&global);
+	cc_list_head_init(&shard);
+	uwifi_ssid_table_init(&ssids);
+	CHECK(uwifi_interference_init(&est, &nodes, 0));
+	CHECK(uwifi_interference_init(&shard_est, &shard, 0));
+
+	/* the AP is only known as receiver */
+	for (int i = 0; i < 5; i++) {
+		sta_packet(&est, &nodes);
+		test_time_usec += UWIFI_INTF_WINDOW / 2;
+	}
+	s = uwifi_interference_score(&est, CHAN, CHAN_WIDTH_20, false);
+	printf("rx only:   score %llu\n", (unsigned long long)s);
+	CHECK_EQ(s, 0);
+
+	/* its beacons give it a weight up to its power */
+	for (int i = 0; i < 5; i++) {
+		ap_beacon(&est, &nodes);
+		sta_packet(&est, &nodes);
+		test_time_usec += UWIFI_INTF_WINDOW / 2;
+	}
+	s = uwifi_interference_score(&est, CHAN, CHAN_WIDTH_20, false);
+	printf("beacons:   score %llu\n", (unsigned long long)s);
+	CHECK(s > 0 && s <= AP_POWER);
+	CHECK_EQ(uwifi_interference_score(&est, CHAN - 2, CHAN_WIDTH_20, false),
+		 s * 69 >> 8);
+	CHECK_EQ(uwifi_interference_score(&est, CHAN + 5, CHAN_WIDTH_20, false), 0);
+
+	/* a shard after the reduce has no signal of the AP until its next
+	 * beacon */
+	for (int i = 0; i < 3; i++) {
+		ap_beacon(&shard_est, &shard);
+		sta_packet(&shard_est, &shard);
+		test_time_usec += UWIFI_INTF_WINDOW / 2;
+	}
+	CHECK(uwifi_interference_score(&shard_est, CHAN, CHAN_WIDTH_20, false) > 0);
+	uwifi_nodes_reduce(&global, &ssids, &shard);
+	for (int i = 0; i < 3; i++) {
+		sta_packet(&shard_est, &shard);
+		test_time_usec += UWIFI_INTF_WINDOW / 2;
+	}
+	s = uwifi_interference_score(&shard_est, CHAN, CHAN_WIDTH_20, false);
+	printf("reduced:   score %llu\n", (unsigned long long)s);
+	CHECK_EQ(s, 0);
+
+	uwifi_nodes_free(&shard);
+	CHECK_EQ(uwifi_interference_score(&shard_est, CHAN, CHAN_WIDTH_20, false), 0);
+	uwifi_nodes_free(&nodes);
+	CHECK_EQ(uwifi_interference_score(&est, CHAN, CHAN_WIDTH_20, false), 0);
+	uwifi_nodes_free(&global);
+	uwifi_interference_free(&shard_est);
+	uwifi_interference_free(&est);
+	return check_result();
+}
@@ -0,0 +1,169 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/*
+ * Host test of the device inventory, built with the static node pool so
+ * nodes are also replaced when the pool is full: nodes are added and
+ * changed, an AP expires while its clients stay and its BSS entry is
+ * reused, a second node list with its own inventory is freed and nodes
+ * are evicted. After each step the histograms have to match the nodes.
+ */
+
+#include <string.h>
+
+#include "wlan_parser.h"
+#include "node.h"
+#include "inventory.h"
+#include "check.h"
+
+#if !UWIFI_STATIC_TABLES || UWIFI_MAX_NODES != 8
+#error "build with -DUWIFI_STATIC_TABLES=1 -DUWIFI_MAX_NODES=8"
+#endif
+
+static struct cc_list_head nodes;
+static struct uwifi_inventory inv;
+
+static void mac_of(unsigned char* mac, int id)
+{
+	memset(mac, 0, WLAN_MAC_LEN);
+	mac[0] = 0x02;
+	mac[5] = id;
+}
+
+static struct uwifi_node* node_packet(struct cc_list_head* list,
+				      struct uwifi_inventory* in, int id, int ap)
+{
+	struct uwifi_packet p;
+	struct uwifi_node* n;
+
+	memset(&p, 0, sizeof(p));
+	mac_of(p.wlan_ta, id);
+	mac_of(p.wlan_bssid, ap);
+	p.wlan_channel = 36;
+	p.wlan_chan_width = CHAN_WIDTH_20;
+	if (id == ap) {
+		p.wlan_type = WLAN_FRAME_BEACON;
+		p.wlan_mode = WLAN_MODE_AP;
+		p.wlan_rsn = 1;
+		p.wlan_tsf = 1;
+	} else {
+		p.wlan_type = WLAN_FRAME_QDATA;
+		p.wlan_mode = WLAN_MODE_STA;
+	}
+
+	n = uwifi_node_update(&p, list);
+	if (n == NULL)
+		return NULL;
+	uwifi_nodes_find_ap(n, list);
+	uwifi_inventory_update(in, n);
+	return n;
+}
+
+/* the histograms have to count each node once */
+static void check_totals(const char* step)
+{
+	struct uwifi_node* n;
+	unsigned int aps = 0, clients = 0, bss = 0;
+
+	cc_list_for_each(&nodes, n, list) {
+		if (n->wlan_mode & WLAN_MODE_AP)
+			aps++;
+		else
+			clients++;
+	}
+	for (int i = 0; i < UWIFI_INV_MAX_BSS; i++)
+		bss += inv.bss[i].hist.total;
+
+	printf("%-8s aps %u clients %u in bss %u\n", step, aps, clients, bss);
+	CHECK_EQ(inv.aps.total, aps);
+	CHECK_EQ(inv.clients.total, clients);
+	CHECK_EQ(inv.clients.sec[UWIFI_INV_SEC_RSN] +
+		 inv.clients.sec[UWIFI_INV_SEC_OPEN], clients);
+	CHECK(bss <= clients);
+}
+
+int main(void)
+{
+	struct cc_list_head other;
+	struct uwifi_inventory other_inv;
+	struct uwifi_node *ap, *ap2, *sta, *n;
+	uint32_t last_timeout = 0;
+
+	cc_list_head_init(&nodes);
+	cc_list_head_init(&other);
+	CHECK(uwifi_inventory_init(&inv, &nodes));
+	CHECK(uwifi_inventory_init(&other_inv, &other));
+
+	/* add: an AP with three clients */
+	ap = node_packet(&nodes, &inv, 1, 1);
+	for (int i = 2; i <= 4; i++)
+		sta = node_packet(&nodes, &inv, i, 1);
+	check_totals("add");
+	CHECK(uwifi_inventory_bss(&inv, ap) != NULL);
+	CHECK_EQ(uwifi_inventory_bss(&inv, ap)->total, 3);
+	CHECK_EQ(inv.clients.sec[UWIFI_INV_SEC_RSN], 3);
+	CHECK_EQ(inv.aps.band[UWIFI_INV_BAND_5GHZ], 1);
+
+	/* change: one client turns out to be 2x2 AC */
+	sta->wlan_std = IEEE80211_AC;
+	sta->wlan_rx_streams = 2;
+	uwifi_inventory_update(&inv, sta);
+	check_totals("change");
+	CHECK_EQ(inv.clients.std_nss[IEEE80211_AC][2], 1);
+	CHECK_EQ(uwifi_inventory_bss(&inv, ap)->std_nss[IEEE80211_AC][2], 1);
+	CHECK_EQ(uwifi_inventory_bss(&inv, ap)->total, 3);
+
+	/* expiry: only the AP times out and frees its BSS entry */
+	test_time_usec += 10000000;
+	cc_list_for_each(&nodes, n, list)
+		if (n != ap)
+			n->last_seen = test_time_usec;
+	uwifi_nodes_timeout(&nodes, 5, &last_timeout);
+	check_totals("expire");
+	CHECK_EQ(inv.bss_used, 0);
+
+	/* a new AP gets the same entry; the clients of the old one were
+	 * counted with the previous generation and must not touch it */
+	ap2 = node_packet(&nodes, &inv, 5, 5);
+	CHECK_EQ(ap2->inv.bss, sta->inv.bss);
+	CHECK(ap2->inv.gen != sta->inv.gen);
+	test_time_usec += 10000000;
+	ap2->last_seen = test_time_usec;
+	uwifi_nodes_timeout(&nodes, 5, &last_timeout);
+	check_totals("reuse");
+	CHECK_EQ(uwifi_inventory_bss(&inv, ap2)->total, 0);
+
+	/* nodes of another list are not counted in this inventory */
+	test_time_usec += 1000;
+	node_packet(&other, &other_inv, 100, 100);
+	node_packet(&other, &other_inv, 101, 100);
+	check_totals("other");
+	CHECK_EQ(other_inv.aps.total, 1);
+	CHECK_EQ(other_inv.clients.total, 1);
+	uwifi_nodes_free(&other);
+	check_totals("free");
+	CHECK_EQ(other_inv.aps.total, 0);
+	CHECK_EQ(other_inv.clients.total, 0);
+
+	/* eviction: more nodes than the pool holds */
+	for (int i = 10; i < 10 + 2 * UWIFI_MAX_NODES; i++) {
+		test_time_usec += 1000;
+		node_packet(&nodes, &inv, i, i % 3 ? 5 : i);
+	}
+	check_totals("evict");
+	CHECK_EQ(inv.aps.total + inv.clients.total, UWIFI_MAX_NODES);
+
+	uwifi_nodes_free(&nodes);
+	CHECK_EQ(inv.aps.total, 0);
+	CHECK_EQ(inv.clients.total, 0);
+	CHECK_EQ(inv.bss_used, 0);
+	uwifi_inventory_free(&other_inv);
+	uwifi_inventory_free(&inv);
+	return check_result();
+}
@@ -0,0 +1,129 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/*
+ * Host test of the nodes with static tables, like on the ESP: the pool is
+ * used up and reused after a timeout, the node not seen for the longest
+ * time is replaced when it is full, and counters saturate instead of
+ * wrapping, also when they are merged.
+ */
+
+#include <string.h>
+
+#include "wlan_parser.h"
+#include "node.h"
+#include "check.h"
+
+#if !UWIFI_STATIC_TABLES || UWIFI_MAX_NODES != 4
+#error "build with -DUWIFI_STATIC_TABLES=1 -DUWIFI_MAX_NODES=4"
+#endif
+
+/* size of struct uwifi_node before the optional state, on 64 bit */
+#define NODE_SIZE_MAX	248
+
+static struct cc_list_head nodes;
+
+static struct uwifi_node* node_packet(int id)
+{
+	struct uwifi_packet p;
+
+	memset(&p, 0, sizeof(p));
+	p.wlan_type = WLAN_FRAME_QDATA;
+	p.wlan_mode = WLAN_MODE_STA;
+	p.wlan_ta[0] = 0x02;
+	p.wlan_ta[5] = id;
+	p.phy_signal = -50;
+	return uwifi_node_update(&p, &nodes);
+}
+
+static struct uwifi_node* node_find(int id)
+{
+	struct uwifi_node* n;
+
+	cc_list_for_each(&nodes, n, list)
+		if (n->wlan_src[5] == id)
+			return n;
+	return NULL;
+}
+
+static int node_count(void)
+{
+	struct uwifi_node* n;
+	int num = 0;
+
+	cc_list_for_each(&nodes, n, list)
+		num++;
+	return num;
+}
+
+int main(void)
+{
+	struct uwifi_node *a, *b, *n;
+	uint32_t last_timeout = 0;
+
+	printf("node size %zu\n", sizeof(struct uwifi_node));
+	if (sizeof(void*) == 8)
+		CHECK(sizeof(struct uwifi_node) <= NODE_SIZE_MAX);
+
+	cc_list_head_init(&nodes);
+
+	/* pool: every node is a different entry */
+	for (int i = 1; i <= UWIFI_MAX_NODES; i++) {
+		test_time_usec += 1000;
+		n = node_packet(i);
+		CHECK(n != NULL);
+		CHECK(n != node_find(i - 1));
+	}
+	CHECK_EQ(node_count(), UWIFI_MAX_NODES);
+
+	/* LRU: node 1 is seen again, so node 2 is the oldest */
+	test_time_usec += 1000;
+	a = node_packet(1);
+	test_time_usec += 1000;
+	n = node_packet(10);
+	CHECK(n != NULL);
+	CHECK_EQ(node_count(), UWIFI_MAX_NODES);
+	CHECK(node_find(1) == a);
+	CHECK(node_find(2) == NULL);
+	CHECK(node_find(3) != NULL);
+	CHECK(node_find(10) == n);
+
+	/* a known node does not replace any */
+	test_time_usec += 1000;
+	CHECK(node_packet(3) == node_find(3));
+	CHECK(node_find(4) != NULL);
+
+	/* timeout returns all entries to the pool */
+	test_time_usec += 10000000;
+	uwifi_nodes_timeout(&nodes, 5, &last_timeout);
+	CHECK_EQ(node_count(), 0);
+	for (int i = 20; i < 20 + UWIFI_MAX_NODES; i++)
+		CHECK(node_packet(i) != NULL);
+	CHECK_EQ(node_count(), UWIFI_MAX_NODES);
+
+	/* saturating counters */
+	a = node_find(20);
+	a->pkt_count = UINT16_MAX - 1;
+	for (int i = 0; i < 3; i++)
+		node_packet(20);
+	CHECK_EQ(a->pkt_count, UINT16_MAX);
+	CHECK_EQ(a->phy_sig_count, 4);
+
+	b = node_find(21);
+	a->pkt_count = 40000;
+	b->pkt_count = 40000;
+	b->rx_pkt_count = 1;
+	uwifi_node_merge(a, NULL, b);
+	CHECK_EQ(a->pkt_count, UINT16_MAX);
+	CHECK_EQ(a->rx_pkt_count, 1);
+
+	uwifi_nodes_free(&nodes);
+	CHECK_EQ(node_count(), 0);
+	return check_result();
+}
@@ -0,0 +1,225 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/*
+ * Host test of the fixed-point statistics against floating point: mean and
+ * variance, also merged from parts, the time decayed average with samples
+ * out of order, and quantiles of the sketch, also merged, halved and made
+ * from a latency histogram of the counters.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+#include "counters.h"
+#include "check.h"
+
+#define NUM	10000
+
+static int32_t vals[NUM];
+
+static int cmp_int(const void* a, const void* b)
+{
+	return *(const int32_t*)a - *(const int32_t*)b;
+}
+
+/* within @permille of @ref */
+static int near(double v, double ref, double permille)
+{
+	return fabs(v - ref) <= fabs(ref) * permille / 1000 + 1;
+}
+
+static void test_stat(void)
+{
+	struct uwifi_stat all, a, b;
+	double sum = 0, m2 = 0, mean;
+
+	uwifi_stat_init(&all);
+	uwifi_stat_init(&a);
+	uwifi_stat_init(&b);
+	for (int i = 0; i < NUM; i++) {
+		/* signal like values */
+		vals[i] = -40 - rand() % 50;
+		sum += vals[i];
+		uwifi_stat_add(&all, vals[i]);
+		uwifi_stat_add(i < NUM / 3 ? &a : &b, vals[i]);
+	}
+	mean = sum / NUM;
+	for (int i = 0; i < NUM; i++)
+		m2 += (vals[i] - mean) * (vals[i] - mean);
+
+	printf("stat:   mean %d var %.2f (%.2f) stddev %.2f\n",
+	       uwifi_stat_mean(&all), uwifi_stat_var_q8(&all) / 256.0,
+	       m2 / (NUM - 1), uwifi_stat_stddev_q8(&all) / 256.0);
+	CHECK_EQ(all.count, NUM);
+	CHECK(fabs(all.mean / 256.0 - mean) < 0.01);
+	CHECK(near(uwifi_stat_var_q8(&all) / 256.0, m2 / (NUM - 1), 5));
+	CHECK(near(uwifi_stat_stddev_q8(&all) / 256.0, sqrt(m2 / (NUM - 1)), 5));
+
+	/* merged parts are the same as all samples */
+	uwifi_stat_merge(&a, &b);
+	CHECK_EQ(a.count, NUM);
+	CHECK_EQ(a.min, all.min);
+	CHECK_EQ(a.max, all.max);
+	CHECK(fabs((a.mean - all.mean) / 256.0) < 0.01);
+	CHECK(near(uwifi_stat_var_q8(&a), uwifi_stat_var_q8(&all), 5));
+
+	/* merging into and from empty */
+	uwifi_stat_init(&b);
+	uwifi_stat_merge(&b, &all);
+	CHECK(memcmp(&b, &all, sizeof(b)) == 0);
+	uwifi_stat_init(&b);
+	uwifi_stat_merge(&all, &b);
+	CHECK_EQ(all.count, NUM);
+	CHECK_EQ(uwifi_stat_var_q8(&b), 0);
+}
+
+static void test_tewma(void)
+{
+	struct uwifi_tewma t, u;
+
+	uwifi_tewma_init(&t, 1000);
+	CHECK_EQ(uwifi_tewma_read(&t), 0);
+
+	/* a burst does not outweigh a later sample by its number */
+	for (int i = 0; i < 100; i++)
+		uwifi_tewma_add(&t, -80, 1000);
+	uwifi_tewma_add(&t, -40, 1000 + 3000);
+	printf("tewma:  burst then later %d\n", uwifi_tewma_read(&t));
+	CHECK(uwifi_tewma_read(&t) > -75);
+
+	/* samples at the same time have equal weight */
+	uwifi_tewma_init(&t, 1000);
+	uwifi_tewma_add(&t, -80, 5000);
+	uwifi_tewma_add(&t, -40, 5000);
+	CHECK_EQ(uwifi_tewma_read(&t), -60);
+
+	/* one time constant later the old weight is 1/e */
+	uwifi_tewma_init(&t, 1000);
+	uwifi_tewma_add(&t, 0, 0);
+	uwifi_tewma_add(&t, 1000, 1000);
+	CHECK(near(uwifi_tewma_read(&t), 1000 / (1 + exp(-1)), 5));
+
+	/* an older sample does not decay the newer ones */
+	uwifi_tewma_init(&t, 1000);
+	uwifi_tewma_add(&t, -50, 10000);
+	uwifi_tewma_add(&t, -70, 9000);
+	CHECK_EQ(uwifi_tewma_read(&t), -60);
+	CHECK_EQ(t.last, 10000);
+
+	/* time wraps */
+	uwifi_tewma_init(&t, 1000);
+	uwifi_tewma_add(&t, 0, UINT32_MAX - 499);
+	uwifi_tewma_add(&t, 1000, 500);
+	CHECK(near(uwifi_tewma_read(&t), 1000 / (1 + exp(-1)), 5));
+
+	/* merge decays the older one to the later time */
+	uwifi_tewma_init(&t, 1000);
+	uwifi_tewma_init(&u, 1000);
+	uwifi_tewma_add(&t, 0, 0);
+	uwifi_tewma_add(&u, 1000, 1000);
+	uwifi_tewma_merge(&t, &u);
+	CHECK(near(uwifi_tewma_read(&t), 1000 / (1 + exp(-1)), 5));
+	CHECK_EQ(t.last, 1000);
+	uwifi_tewma_init(&u, 1000);
+	uwifi_tewma_merge(&u, &t);
+	CHECK_EQ(uwifi_tewma_read(&u), uwifi_tewma_read(&t));
+
+	/* weight is limited */
+	uwifi_tewma_init(&t, 1000000);
+	for (int i = 0; i < 5000; i++)
+		uwifi_tewma_add(&t, -50, i);
+	CHECK(t.weight <= UWIFI_TEWMA_MAX_WEIGHT << 16);
+	CHECK_EQ(uwifi_tewma_read(&t), -50);
+}
+
+/* the sketch is within one bucket, 12.5% */
+static void check_quantiles(const struct uwifi_sketch* s, const uint32_t* sorted,
+			    int num, const char* name)
+{
+	static const unsigned int q[] = { 10, 500, 900, 990, 1000 };
+
+	for (unsigned int i = 0; i < sizeof(q) / sizeof(q[0]); i++) {
+		uint32_t ref = sorted[(num * q[i] + 999) / 1000 - 1];
+		uint32_t v = uwifi_sketch_quantile(s, q[i]);
+		if (q[i] == 500)
+			printf("sketch: %s median %u (%u)\n", name, v, ref);
+		CHECK(near(v, ref, 125));
+	}
+}
+
+static void test_sketch(void)
+{
+	static uint32_t lat[NUM];
+	static struct uwifi_sketch s, a, b;
+	struct uwifi_hist h;
+
+	uwifi_sketch_init(&s);
+	uwifi_sketch_init(&a);
+	uwifi_sketch_init(&b);
+	CHECK_EQ(uwifi_sketch_quantile(&s, 500), 0);
+
+	/* latency like, log-normal */
+	for (int i = 0; i < NUM; i++) {
+		lat[i] = exp(7 + 1.5 * ((rand() % 2001) - 1000) / 1000.0);
+		uwifi_sketch_add(&s, lat[i]);
+		uwifi_sketch_add(i % 2 ? &a : &b, lat[i]);
+	}
+	qsort(lat, NUM, sizeof(lat[0]), cmp_int);
+	CHECK_EQ(s.count, NUM);
+	check_quantiles(&s, lat, NUM, "added");
+
+	uwifi_sketch_merge(&a, &b);
+	CHECK(memcmp(&a, &s, sizeof(a)) == 0);
+
+	/* more samples than a bucket holds halve all counts */
+	for (int r = 0; r < 200; r++)
+		for (int i = 0; i < NUM; i++)
+			uwifi_sketch_add(&s, lat[i]);
+	CHECK(s.shift > 0);
+	check_quantiles(&s, lat, NUM, "halved");
+
+	/* merge of sketches which were halved a different number of times */
+	uwifi_sketch_merge(&b, &s);
+	CHECK_EQ(b.shift, s.shift);
+	check_quantiles(&b, lat, NUM, "merged");
+
+	/* values of the lowest buckets are exact */
+	uwifi_sketch_init(&a);
+	for (uint32_t v = 0; v < UWIFI_SKETCH_SUB; v++)
+		uwifi_sketch_add(&a, v);
+	CHECK_EQ(uwifi_sketch_quantile(&a, 500), UWIFI_SKETCH_SUB / 2 - 1);
+	uwifi_sketch_add(&a, UINT32_MAX);
+	CHECK(uwifi_sketch_quantile(&a, 1000) >= 1U << 31);
+
+	/* latency histograms of the counters have the same buckets */
+	memset(&h, 0, sizeof(h));
+	for (int r = 0; r < 200; r++) {
+		for (int i = 0; i < NUM; i++) {
+			h.buckets[uwifi_hist_bucket(lat[i])]++;
+			h.count++;
+		}
+	}
+	uwifi_hist_sketch(&h, &a);
+	CHECK(a.shift > 0);
+	check_quantiles(&a, lat, NUM, "hist");
+	CHECK_EQ(uwifi_hist_percentile(&h, 500),
+		 uwifi_sketch_bucket_low(uwifi_sketch_bucket(uwifi_sketch_quantile(&a, 500))));
+}
+
+int main(void)
+{
+	srand(1);
+	test_stat();
+	test_tewma();
+	test_sketch();
+	return check_result();
+}
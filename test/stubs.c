@@ -0,0 +1,49 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/*
+ * What the application and platform provide to the library, for the host
+ * tests: no log output and a clock which only moves when the test says so.
+ */
+
+#include <stdbool.h>
+
+#include "check.h"
+#include "ifctrl.h"
+#include "log.h"
+#include "platform.h"
+
+int check_errors;
+uint32_t test_time_usec = 1000000;
+
+void __attribute__((format(printf, 2, 3)))
+log_out(enum loglevel ll, const char* fmt, ...)
+{
+	(void)ll;
+	(void)fmt;
+}
+
+uint32_t plat_time_usec(void)
+{
+	return test_time_usec;
+}
+
+/* channel.c is only linked for the width names */
+bool ifctrl_iwset_freq(const char* const interface, unsigned int freq,
+		       enum uwifi_chan_width width, unsigned int center1)
+{
+	(void)interface; (void)freq; (void)width; (void)center1;
+	return false;
+}
+
+bool ifctrl_iwget_freqlist(struct uwifi_interface* intf)
+{
+	(void)intf;
+	return false;
+}
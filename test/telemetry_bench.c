@@ -0,0 +1,213 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/*
+ * Host benchmark of the telemetry encoding against the JSON output: a set of
+ * APs and stations is updated with synthesized packets, after each round
+ * the changes are encoded (and decoded) as telemetry messages of MTU size
+ * and all nodes and ESSIDs are written as JSON records, like a periodic
+ * status report would. Reports throughput and bytes per node update.
+ *
+ *	make -C test bench
+ *	./telemetry_bench [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wlan_parser.h"
+#include "node.h"
+#include "essid.h"
+#include "ssid.h"
+#include "ifctrl.h"
+#include "json.h"
+#include "log.h"
+#include "telemetry.h"
+
+#define NUM_APS		8
+#define STAS_PER_AP	5
+#define NUM_NODES	(NUM_APS * (STAS_PER_AP + 1))
+#define MSG_LEN		1400
+#define JSON_BUF	4096
+
+static struct uwifi_ssid_table ssids;
+static struct cc_list_head nodes;
+static struct cc_list_head essids;
+
+/* provided by the application */
+void __attribute__((format(printf, 2, 3)))
+log_out(enum loglevel ll, const char* fmt, ...)
+{
+	(void)ll;
+	(void)fmt;
+}
+
+/* channel.c is only linked for the width names */
+bool ifctrl_iwset_freq(const char* const interface, unsigned int freq,
+		       enum uwifi_chan_width width, unsigned int center1)
+{
+	(void)interface; (void)freq; (void)width; (void)center1;
+	return false;
+}
+
+bool ifctrl_iwget_freqlist(struct uwifi_interface* intf)
+{
+	(void)intf;
+	return false;
+}
+
+static uint64_t now_nsec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void mac_of(unsigned char* mac, int i)
+{
+	memset(mac, 0, WLAN_MAC_LEN);
+	mac[0] = 0x02;
+	mac[4] = i >> 8;
+	mac[5] = i;
+}
+
+/* beacon of AP @ap or data frame of a station of it */
+static void node_packet(int i, uint32_t round)
+{
+	static const char* names[] = { "office", "guest", "lab", "printer" };
+	struct uwifi_packet p;
+	struct uwifi_node* n;
+	int ap = i / (STAS_PER_AP + 1);
+	const char* name = names[ap % 4];
+
+	memset(&p, 0, sizeof(p));
+	mac_of(p.wlan_bssid, ap * (STAS_PER_AP + 1));
+	mac_of(p.wlan_ta, i);
+	p.phy_signal = -40 - (int)((i * 7 + round) % 45);
+	p.phy_rate = 60;
+	p.wlan_len = 100 + (round % 1400);
+	p.pkt_time = (uint64_t)round * 100000;
+
+	if (i % (STAS_PER_AP + 1) == 0) {
+		p.wlan_type = WLAN_FRAME_BEACON;
+		p.wlan_mode = WLAN_MODE_AP;
+		p.wlan_channel = 1 + (ap % 3) * 5;
+		p.wlan_rsn = ap % 4 != 1;
+		p.wlan_essid = (const unsigned char*)name;
+		p.wlan_essid_len = strlen(name);
+		p.wlan_essid_id = uwifi_ssid_intern(&ssids, name, p.wlan_essid_len);
+		p.wlan_tsf = round;
+		p.wlan_bintval = 100;
+	} else {
+		p.wlan_type = WLAN_FRAME_QDATA;
+		p.wlan_mode = WLAN_MODE_STA;
+		p.wlan_wep = 1;
+		p.wlan_retry = round % 8 == 0;
+		p.wlan_seqno = round;
+	}
+	p.wlan_chan_width = CHAN_WIDTH_20;
+
+	n = uwifi_node_update(&p, &nodes);
+	if (n == NULL)
+		return;
+	uwifi_nodes_find_ap(n, &nodes);
+	uwifi_essids_update(&essids, &ssids, &p, n);
+}
+
+static bool json_count(const char* buf, size_t len, void* ctx)
+{
+	(void)buf;
+	*(size_t*)ctx += len;
+	return true;
+}
+
+static void dec_count(const struct uwifi_telem_rec* rec, void* ctx)
+{
+	(void)rec;
+	(*(unsigned long*)ctx)++;
+}
+
+int main(int argc, char** argv)
+{
+	static struct uwifi_telem_enc enc;
+	static struct uwifi_telem_dec dec;
+	unsigned char msg[MSG_LEN];
+	char jbuf[JSON_BUF];
+	struct uwifi_json_out jout;
+	struct uwifi_node* n;
+	struct essid_info* e;
+	unsigned long rounds = argc > 1 ? strtoul(argv[1], NULL, 10) : 20000;
+	unsigned long updates = 0, msgs = 0, recs = 0;
+	size_t telem_bytes = 0, json_bytes = 0;
+	uint64_t t_enc = 0, t_dec = 0, t_json = 0, t;
+	int len, flags;
+
+	uwifi_ssid_table_init(&ssids);
+	cc_list_head_init(&nodes);
+	cc_list_head_init(&essids);
+	uwifi_telem_enc_init(&enc);
+	uwifi_telem_dec_init(&dec);
+	uwifi_json_init(&jout, jbuf, sizeof(jbuf), json_count, &json_bytes);
+
+	for (unsigned long r = 0; r < rounds; r++) {
+		/* every node is seen in each round */
+		for (int i = 0; i < NUM_NODES; i++)
+			node_packet(i, r);
+		updates += NUM_NODES;
+
+		if (r % 1000 == 0)
+			uwifi_telem_enc_reset(&enc);
+
+		do {
+			t = now_nsec();
+			len = uwifi_telem_encode(&enc, &nodes, &essids, msg, sizeof(msg));
+			t_enc += now_nsec() - t;
+			if (len < 0) {
+				printf("encode failed\n");
+				return 1;
+			}
+			telem_bytes += len;
+			msgs++;
+
+			t = now_nsec();
+			flags = uwifi_telem_decode(&dec, msg, len, dec_count, &recs);
+			t_dec += now_nsec() - t;
+			if (flags < 0) {
+				printf("decode failed\n");
+				return 1;
+			}
+		} while (flags & UWIFI_TELEM_FLAG_MORE);
+
+		t = now_nsec();
+		cc_list_for_each(&nodes, n, list)
+			uwifi_json_node(&jout, n);
+		cc_list_for_each(&essids, e, list)
+			uwifi_json_essid(&jout, e);
+		uwifi_json_flush(&jout);
+		t_json += now_nsec() - t;
+	}
+
+	printf("%lu rounds of %d nodes, %lu messages, %lu records\n",
+	       rounds, NUM_NODES, msgs, recs);
+	printf("telemetry encode: %8.1f ns/node update %8.1f MB/s\n",
+	       (double)t_enc / updates, telem_bytes * 1000.0 / t_enc);
+	printf("telemetry decode: %8.1f ns/node update %8.1f MB/s\n",
+	       (double)t_dec / updates, telem_bytes * 1000.0 / t_dec);
+	printf("json encode:      %8.1f ns/node update %8.1f MB/s\n",
+	       (double)t_json / updates, json_bytes * 1000.0 / t_json);
+	printf("bytes/node update: telemetry %.1f json %.1f (%.1f%%)\n",
+	       (double)telem_bytes / updates, (double)json_bytes / updates,
+	       100.0 * telem_bytes / json_bytes);
+
+	uwifi_essids_free(&essids);
+	uwifi_nodes_free(&nodes);
+	return 0;
+}
@@ -0,0 +1,468 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+/*
+ * Host test of the telemetry encoding, built with small dictionaries and
+ * decoded into the state an application would keep. After each step the
+ * decoded values have to be the values of the nodes, ESSIDs and channels:
+ * nodes are added and changed, an ESSID goes away and its slot is reused,
+ * a BSSID takes the MAC slot of a node, and after a lost message a reset
+ * restores the full state.
+ */
+
+#include <string.h>
+
+#include "wlan_parser.h"
+#include "node.h"
+#include "essid.h"
+#include "telemetry.h"
+#include "check.h"
+
+#if UWIFI_TELEM_MAX_MACS != 8 || UWIFI_TELEM_MAX_ESSIDS != 4
+#error "build with -DUWIFI_TELEM_MAX_MACS=8 -DUWIFI_TELEM_MAX_ESSIDS=4"
+#endif
+
+#define BUF_LEN		128	/* a few records per message */
+#define MAX_MIRROR	32
+
+static struct cc_list_head nodes;
+static struct cc_list_head essids;
+static struct uwifi_ssid_table ssids;
+static struct uwifi_telem_enc enc;
+static struct uwifi_telem_dec dec;
+static uint32_t last_timeout;
+static uint16_t seqno;
+
+/* the state of the application on the other side */
+static struct mirror_node {
+	bool			used;
+	unsigned char		mac[WLAN_MAC_LEN];
+	struct uwifi_telem_node	v;
+} mnodes[MAX_MIRROR];
+static struct uwifi_telem_essid messids[UWIFI_TELEM_MAX_ESSIDS];
+static bool messid_used[UWIFI_TELEM_MAX_ESSIDS];
+static struct uwifi_telem_chan mchans[MAX_MIRROR];
+static int num_mchans;
+static int num_dels;	/* of nodes which still exist */
+
+static void mac_of(unsigned char* mac, int id)
+{
+	memset(mac, 0, WLAN_MAC_LEN);
+	mac[0] = 0x02;
+	mac[5] = id;
+}
+
+static struct uwifi_node* node_find(int id)
+{
+	unsigned char mac[WLAN_MAC_LEN];
+	struct uwifi_node* n;
+
+	mac_of(mac, id);
+	cc_list_for_each(&nodes, n, list)
+		if (memcmp(n->wlan_src, mac, WLAN_MAC_LEN) == 0)
+			return n;
+	return NULL;
+}
+
+static void ap_beacon(int id, const char* essid, int chan, int sig)
+{
+	struct uwifi_packet p;
+	struct uwifi_node* n;
+
+	memset(&p, 0, sizeof(p));
+	p.wlan_type = WLAN_FRAME_BEACON;
+	p.wlan_mode = WLAN_MODE_AP;
+	mac_of(p.wlan_ta, id);
+	mac_of(p.wlan_bssid, id);
+	memset(p.wlan_ra, 0xff, WLAN_MAC_LEN);
+	p.wlan_essid = (const unsigned char*)essid;
+	p.wlan_essid_len = strlen(essid);
+	p.wlan_channel = chan;
+	p.wlan_chan_width = CHAN_WIDTH_20;
+	p.wlan_ht40plus = chan > 14;
+	p.wlan_rsn = 1;
+	p.phy_signal = sig;
+
+	n = uwifi_node_update(&p, &nodes);
+	uwifi_essids_update(&essids, &ssids, &p, n);
+}
+
+static void sta_data(int id, int bssid, int chan, int sig, bool retry)
+{
+	struct uwifi_packet p;
+	struct uwifi_node* n;
+
+	memset(&p, 0, sizeof(p));
+	p.wlan_type = WLAN_FRAME_QDATA;
+	p.wlan_mode = WLAN_MODE_STA;
+	mac_of(p.wlan_ta, id);
+	mac_of(p.wlan_ra, bssid);
+	mac_of(p.wlan_bssid, bssid);
+	p.wlan_channel = chan;
+	p.wlan_seqno = retry ? seqno : ++seqno;
+	p.wlan_retry = retry;
+	p.phy_signal = sig;
+
+	n = uwifi_node_update(&p, &nodes);
+	uwifi_nodes_find_ap(n, &nodes);
+}
+
+static void expire(int id)
+{
+	struct uwifi_node* n = node_find(id);
+
+	n->last_seen = test_time_usec - 20000000;
+	last_timeout = n->last_seen;
+	uwifi_nodes_timeout(&nodes, 10, &last_timeout);
+}
+
+static struct mirror_node* mirror_find(const unsigned char* mac, bool add)
+{
+	struct mirror_node* free = NULL;
+
+	for (int i = 0; i < MAX_MIRROR; i++) {
+		if (!mnodes[i].used) {
+			if (free == NULL)
+				free = &mnodes[i];
+		} else if (memcmp(mnodes[i].mac, mac, WLAN_MAC_LEN) == 0) {
+			return &mnodes[i];
+		}
+	}
+	if (!add || free == NULL)
+		return NULL;
+	free->used = true;
+	memcpy(free->mac, mac, WLAN_MAC_LEN);
+	return free;
+}
+
+static void mirror_node(const struct uwifi_telem_rec* r)
+{
+	struct mirror_node* m = mirror_find(r->mac, true);
+	const struct uwifi_telem_node* v = &r->node;
+
+	CHECK(m != NULL);
+	if (m == NULL)
+		return;
+	if (r->is_new) {
+		memset(&m->v, 0, sizeof(m->v));
+		m->v.essid = -1;
+	}
+	if (r->fields & UWIFI_TELEM_F_PKTS)	m->v.pkts += v->pkts;
+	if (r->fields & UWIFI_TELEM_F_RETRIES)	m->v.retries += v->retries;
+	if (r->fields & UWIFI_TELEM_F_SIG)	m->v.sig = v->sig;
+	if (r->fields & UWIFI_TELEM_F_SIG_AVG)	m->v.sig_avg = v->sig_avg;
+	if (r->fields & UWIFI_TELEM_F_SIG_MAX)	m->v.sig_max = v->sig_max;
+	if (r->fields & UWIFI_TELEM_F_MODE)	m->v.mode = v->mode;
+	if (r->fields & UWIFI_TELEM_F_CHANNEL)	m->v.channel = v->channel;
+	if (r->fields & UWIFI_TELEM_F_STD)	m->v.std = v->std;
+	if (r->fields & UWIFI_TELEM_F_WIDTH)	m->v.width = v->width;
+	if (r->fields & UWIFI_TELEM_F_FLAGS)	m->v.flags = v->flags;
+	if (r->fields & UWIFI_TELEM_F_BSSID)
+		memcpy(m->v.bssid, v->bssid, WLAN_MAC_LEN);
+	if (r->fields & UWIFI_TELEM_F_ESSID)	m->v.essid = v->essid;
+}
+
+static void mirror_chan(const struct uwifi_telem_chan* c)
+{
+	int i;
+
+	for (i = 0; i < num_mchans; i++)
+		if (mchans[i].channel == c->channel)
+			break;
+	if (c->num_nodes == 0 && c->num_aps == 0) {
+		if (i < num_mchans)
+			mchans[i] = mchans[--num_mchans];
+	} else {
+		if (i == num_mchans)
+			num_mchans++;
+		mchans[i] = *c;
+	}
+}
+
+static void apply(const struct uwifi_telem_rec* r, void* ctx)
+{
+	struct mirror_node* m;
+	(void)ctx;
+
+	switch (r->type) {
+	case UWIFI_TELEM_NODE:
+		mirror_node(r);
+		break;
+	case UWIFI_TELEM_NODE_DEL:
+		m = mirror_find(r->mac, false);
+		if (m != NULL)
+			m->used = false;
+		if (node_find(r->mac[5]) != NULL)
+			num_dels++;
+		break;
+	case UWIFI_TELEM_ESSID:
+		if (r->is_new)
+			messids[r->slot] = r->essid;
+		messids[r->slot].num_nodes = r->essid.num_nodes;
+		messids[r->slot].split = r->essid.split;
+		messid_used[r->slot] = true;
+		break;
+	case UWIFI_TELEM_ESSID_DEL:
+		messid_used[r->slot] = false;
+		break;
+	case UWIFI_TELEM_CHAN:
+		mirror_chan(&r->chan);
+		break;
+	}
+}
+
+/* encode until everything is sent, the first message may get lost */
+static void round_trip(bool lose)
+{
+	unsigned char buf[BUF_LEN];
+	int len, num = 0;
+
+	do {
+		len = uwifi_telem_encode(&enc, &nodes, &essids, buf, sizeof(buf));
+		CHECK(len > 0);
+		if (len <= 0)
+			return;
+		if (!lose || num > 0)
+			CHECK_EQ(uwifi_telem_decode(&dec, buf, len, apply, NULL), buf[1]);
+		num++;
+	} while (buf[1] & UWIFI_TELEM_FLAG_MORE && num < 100);
+}
+
+static int enc_mac_slot(const unsigned char* mac)
+{
+	for (int i = 0; i < UWIFI_TELEM_MAX_MACS; i++)
+		if (enc.macs[i].used && enc.macs[i].is_node &&
+		    memcmp(enc.macs[i].mac, mac, WLAN_MAC_LEN) == 0)
+			return i;
+	return -1;
+}
+
+static int enc_essid_slot(const struct uwifi_ssid* s)
+{
+	for (int i = 0; i < UWIFI_TELEM_MAX_ESSIDS; i++)
+		if (enc.essids[i].used && enc.essids[i].last.essid_len == s->len &&
+		    memcmp(enc.essids[i].last.essid, s->ssid, s->len) == 0)
+			return i;
+	return -1;
+}
+
+static void check_node(const struct uwifi_node* n, const struct mirror_node* m)
+{
+	uint8_t flags = (n->wlan_wep ? UWIFI_TELEM_NF_WEP : 0) |
+			(n->wlan_wpa ? UWIFI_TELEM_NF_WPA : 0) |
+			(n->wlan_rsn ? UWIFI_TELEM_NF_RSN : 0) |
+			(n->wlan_ht40plus ? UWIFI_TELEM_NF_HT40PLUS : 0) |
+			(n->rx_only ? UWIFI_TELEM_NF_RX_ONLY : 0);
+
+	CHECK_EQ(m->v.pkts, n->pkt_count);
+	CHECK_EQ(m->v.retries, n->wlan_retries_all);
+	CHECK_EQ(m->v.sig, n->phy_sig_last);
+	CHECK_EQ(m->v.sig_avg, -(int)ewma_read(&n->phy_sig_avg));
+	CHECK_EQ(m->v.sig_max, n->phy_sig_max);
+	CHECK_EQ(m->v.mode, n->wlan_mode);
+	CHECK_EQ(m->v.channel, n->wlan_channel);
+	CHECK_EQ(m->v.std, n->wlan_std);
+	CHECK_EQ(m->v.width, n->wlan_chan_width);
+	CHECK_EQ(m->v.flags, flags);
+	CHECK(memcmp(m->v.bssid, n->wlan_bssid, WLAN_MAC_LEN) == 0);
+	if (n->essid == NULL) {
+		CHECK_EQ(m->v.essid, -1);
+		return;
+	}
+	const struct uwifi_ssid* s = uwifi_essid_ssid(n->essid);
+	CHECK(m->v.essid >= 0 && messid_used[m->v.essid]);
+	if (m->v.essid >= 0)
+		CHECK(messids[m->v.essid].essid_len == s->len &&
+		      memcmp(messids[m->v.essid].essid, s->ssid, s->len) == 0);
+}
+
+/* the application knows the nodes the encoder has sent and nothing else,
+ * returns the number of nodes it does not know */
+static int check_state(const char* step)
+{
+	struct uwifi_telem_chan ch[MAX_MIRROR];
+	struct uwifi_node* n;
+	struct essid_info* e;
+	int num = 0, sent = 0, mirrored = 0, num_essids = 0, num_ch = 0;
+
+	cc_list_for_each(&nodes, n, list) {
+		struct mirror_node* m = mirror_find(n->wlan_src, false);
+		num++;
+		if (enc_mac_slot(n->wlan_src) < 0) {
+			CHECK(m == NULL);
+			continue;
+		}
+		sent++;
+		CHECK(m != NULL);
+		if (m != NULL)
+			check_node(n, m);
+
+		int i;
+		for (i = 0; i < num_ch; i++)
+			if (ch[i].channel == n->wlan_channel)
+				break;
+		if (i == num_ch) {
+			ch[num_ch].channel = n->wlan_channel;
+			ch[num_ch].num_nodes = ch[num_ch].num_aps = 0;
+			num_ch++;
+		}
+		ch[i].num_nodes++;
+		if (n->wlan_mode & WLAN_MODE_AP)
+			ch[i].num_aps++;
+	}
+	for (int i = 0; i < MAX_MIRROR; i++)
+		if (mnodes[i].used)
+			mirrored++;
+
+	cc_list_for_each(&essids, e, list) {
+		int i = enc_essid_slot(uwifi_essid_ssid(e));
+		num_essids++;
+		CHECK(i >= 0 && messid_used[i]);
+		if (i < 0)
+			continue;
+		CHECK_EQ(messids[i].num_nodes, e->num_nodes);
+		CHECK_EQ(messids[i].split, e->split > 0);
+	}
+	for (int i = 0; i < UWIFI_TELEM_MAX_ESSIDS; i++)
+		if (messid_used[i])
+			num_essids--;
+
+	printf("%-8s nodes %d sent %d mirrored %d chans %d lost %u\n",
+	       step, num, sent, mirrored, num_mchans, dec.lost);
+	CHECK_EQ(mirrored, sent);
+	CHECK_EQ(num_essids, 0);
+
+	/* channels are counted over all nodes, they have to be sent */
+	if (sent < num)
+		return num - sent;
+	CHECK_EQ(num_mchans, num_ch);
+	for (int i = 0; i < num_ch; i++) {
+		int j;
+		for (j = 0; j < num_mchans; j++)
+			if (mchans[j].channel == ch[i].channel)
+				break;
+		CHECK(j < num_mchans);
+		if (j == num_mchans)
+			continue;
+		CHECK_EQ(mchans[j].num_nodes, ch[i].num_nodes);
+		CHECK_EQ(mchans[j].num_aps, ch[i].num_aps);
+	}
+	return 0;
+}
+
+int main(void)
+{
+	struct uwifi_node* n;
+	const struct uwifi_ssid* s;
+	int slot;
+
+	test_time_usec = 100000000;
+	cc_list_head_init(&nodes);
+	cc_list_head_init(&essids);
+	uwifi_ssid_table_init(&ssids);
+	uwifi_telem_enc_init(&enc);
+	uwifi_telem_dec_init(&dec);
+
+	/* add: two APs and their stations */
+	ap_beacon(1, "office", 6, -50);
+	ap_beacon(2, "lab", 36, -70);
+	sta_data(10, 1, 6, -40, false);
+	sta_data(11, 1, 6, -60, false);
+	sta_data(12, 2, 36, -80, false);
+	round_trip(false);
+	check_state("add");
+	CHECK_EQ(num_mchans, 2);
+
+	/* change: counters are sent as differences */
+	test_time_usec += 1000;
+	sta_data(10, 1, 6, -45, false);
+	sta_data(10, 1, 6, -47, true);
+	sta_data(10, 1, 6, -48, true);
+	ap_beacon(2, "lab", 40, -65);
+	ap_beacon(1, "office", 6, -52);
+	round_trip(false);
+	check_state("change");
+	CHECK_EQ(node_find(10)->wlan_retries_all, 2);
+
+	/* ESSID slot reuse: one ESSID goes away while a new one comes, its
+	 * slot and the MAC slot of its AP have to be reused */
+	ap_beacon(3, "guest", 11, -75);
+	ap_beacon(4, "printer", 1, -55);
+	round_trip(false);
+	check_state("essids");
+	s = uwifi_essid_ssid(node_find(3)->essid);
+	slot = enc_essid_slot(s);
+	CHECK(slot >= 0);
+	test_time_usec += 1000;
+	expire(3);
+	ap_beacon(5, "cafe", 11, -58);
+	round_trip(false);
+	check_state("reuse");
+	s = uwifi_essid_ssid(node_find(5)->essid);
+	CHECK_EQ(enc_essid_slot(s), slot);
+	CHECK_EQ(num_dels, 0);
+
+	/* the BSSID of a new station takes the MAC slot of the first node,
+	 * which is deleted and comes back with the next message. There are
+	 * more nodes and BSSIDs than slots now, so one node is always
+	 * missing but all others have to be right */
+	test_time_usec += 1000;
+	sta_data(20, 30, 11, -66, false);
+	round_trip(false);
+	CHECK_EQ(check_state("evict"), 1);
+	CHECK_EQ(num_dels, 1);
+	CHECK(mirror_find(node_find(1)->wlan_src, false) == NULL);
+	test_time_usec += 1000;
+	round_trip(false);
+	CHECK_EQ(check_state("back"), 1);
+	CHECK(num_dels > 1);
+	for (int i = 0; i < 5; i++) {
+		test_time_usec += 1000;
+		sta_data(20, 30, 11, -60 - i, false);
+		sta_data(11, 1, 6, -60 + i, i % 2);
+		round_trip(false);
+		CHECK_EQ(check_state("churn"), 1);
+	}
+
+	/* a lost message: a deleted station and a channel change are missed
+	 * and the records of nodes with unknown slots are skipped ... */
+	test_time_usec += 1000;
+	expire(20);
+	round_trip(false);
+	check_state("expire");
+	test_time_usec += 1000;
+	expire(11);
+	ap_beacon(4, "printer", 3, -55);
+	round_trip(true);
+	test_time_usec += 1000;
+	sta_data(10, 1, 6, -41, false);
+	sta_data(12, 2, 40, -79, false);
+	round_trip(false);
+	CHECK_EQ(dec.lost, 1);
+	CHECK(mirror_find(node_find(10)->wlan_src, false)->v.pkts < node_find(10)->pkt_count);
+
+	/* ... until a reset sends the full state */
+	uwifi_telem_enc_reset(&enc);
+	round_trip(false);
+	check_state("reset");
+	cc_list_for_each(&nodes, n, list)
+		CHECK(enc_mac_slot(n->wlan_src) >= 0);
+
+	/* all nodes and ESSIDs gone */
+	test_time_usec += 20000000;
+	uwifi_nodes_timeout(&nodes, 10, &last_timeout);
+	round_trip(false);
+	check_state("timeout");
+	CHECK(cc_list_empty(&essids));
+	CHECK_EQ(num_mchans, 0);
+
+	uwifi_nodes_free(&nodes);
+	uwifi_essids_free(&essids);
+	return check_result();
+}
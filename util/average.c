@@ -7,6 +7,8 @@
  * Version 3. See the file COPYING for more details.
  */
 
+#include <stdint.h>
+
 #include "average.h"
 #include "platform.h"
 #include "util.h"
@@ -60,3 +62,35 @@ struct ewma *ewma_add(struct ewma *avg, unsigned long val)
 		(val << avg->factor);
 	return avg;
 }
+
+/**
+ * ewma_merge() - Merge two EWMAs
+ * @avg: Average structure, the result is stored here
+ * @other: Average of @n samples which are newer than the ones in @avg, with
+ *	the same factor and weight
+ * @n: Number of samples in @other
+ *
+ * The result is approximately what @avg would be if the samples of @other
+ * were added to it: the old average decays as if @n samples were added and
+ * the rest of the weight goes to @other. This is used to fold averages of
+ * different threads together.
+ */
+void ewma_merge(struct ewma *avg, const struct ewma *other, unsigned long n)
+{
+	uint32_t keep = 1 << 16;	/* weight of old average, Q16 */
+
+	if (other->internal == 0 || n == 0)
+		return;
+	if (avg->internal == 0) {
+		avg->internal = other->internal;
+		return;
+	}
+
+	for (; n > 0 && keep >= (1UL << avg->weight); n--)
+		keep -= keep >> avg->weight;
+	if (n > 0)
+		keep = 0;
+
+	avg->internal = ((uint64_t)avg->internal * keep +
+			 (uint64_t)other->internal * ((1 << 16) - keep)) >> 16;
+}
@@ -0,0 +1,216 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "counters.h"
+#include "platform.h"
+#include "util.h"
+
+static const char* counter_names[UWIFI_CNT_MAX] = {
+	[UWIFI_CNT_FRAMES_RX]		= "frames_rx",
+	[UWIFI_CNT_FRAMES_PARSED]	= "frames_parsed",
+	[UWIFI_CNT_FRAMES_BADFCS]	= "frames_badfcs",
+	[UWIFI_CNT_FRAMES_MALFORMED]	= "frames_malformed",
+	[UWIFI_CNT_NODES_CREATED]	= "nodes_created",
+	[UWIFI_CNT_NODES_EXPIRED]	= "nodes_expired",
+	[UWIFI_CNT_NODES_EVICTED]	= "nodes_evicted",
+	[UWIFI_CNT_NODES_ALLOC_FAIL]	= "nodes_alloc_fail",
+	[UWIFI_CNT_ESSIDS_CREATED]	= "essids_created",
+	[UWIFI_CNT_ESSIDS_DELETED]	= "essids_deleted",
+	[UWIFI_CNT_CHAN_SWITCHES]	= "chan_switches",
+	[UWIFI_CNT_CHAN_SWITCH_FAIL]	= "chan_switch_fail",
+	[UWIFI_CNT_INJECTED]		= "injected",
+	[UWIFI_CNT_INJECT_FAIL]		= "inject_fail",
+};
+
+static const char* hist_names[UWIFI_HIST_MAX] = {
+	[UWIFI_HIST_PARSE]		= "parse_nsec",
+	[UWIFI_HIST_NODE_LOOKUP]	= "node_lookup_nsec",
+	[UWIFI_HIST_CHAN_SWITCH]	= "chan_switch_nsec",
+};
+
+__thread struct uwifi_counters* uwifi_counters_ctx;
+struct uwifi_counters uwifi_counters_default;
+
+/* registered contexts, slot 0 is the default context */
+static struct uwifi_counters* counters_ctx[UWIFI_COUNTERS_MAX_CTX] = {
+	&uwifi_counters_default
+};
+
+/* sum of unregistered contexts, so the totals don't go back */
+static struct uwifi_counters_snapshot counters_retired;
+
+/* held by snapshot and unregister, never by the writers */
+static bool counters_lock;
+
+static void counters_lock_take(void)
+{
+	while (__atomic_test_and_set(&counters_lock, __ATOMIC_ACQUIRE))
+		;
+}
+
+static void counters_lock_give(void)
+{
+	__atomic_clear(&counters_lock, __ATOMIC_RELEASE);
+}
+
+const char* uwifi_counter_name(enum uwifi_counter c)
+{
+	return c < UWIFI_CNT_MAX ? counter_names[c] : NULL;
+}
+
+const char* uwifi_hist_name(enum uwifi_histogram h)
+{
+	return h < UWIFI_HIST_MAX ? hist_names[h] : NULL;
+}
+
+uint64_t uwifi_counters_time(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+	return (uint64_t)plat_time_usec() * 1000;
+#endif
+}
+
+uint64_t uwifi_hist_bucket_low(unsigned int idx)
+{
+	return uwifi_sketch_bucket_low(idx);
+}
+
+uint64_t uwifi_hist_percentile(const struct uwifi_hist* h, unsigned int permille)
+{
+	uint64_t sum = 0;
+
+	if (h->count == 0)
+		return 0;
+
+	/* rank of the sample we are looking for, rounded up */
+	uint64_t rank = (h->count * permille + 999) / 1000;
+	if (rank == 0)
+		rank = 1;
+
+	for (unsigned int i = 0; i < UWIFI_HIST_BUCKETS; i++) {
+		sum += h->buckets[i];
+		if (sum >= rank)
+			return uwifi_hist_bucket_low(i);
+	}
+	return uwifi_hist_bucket_low(UWIFI_HIST_BUCKETS - 1);
+}
+
+void uwifi_hist_sketch(const struct uwifi_hist* h, struct uwifi_sketch* s)
+{
+	uint32_t max = 0;
+	unsigned int d = 0;
+
+	for (unsigned int i = 0; i < UWIFI_HIST_BUCKETS; i++)
+		max = MAX(max, h->buckets[i]);
+	/* halve like the sketch does when a bucket would overflow */
+	while ((((uint64_t)max + (1U << d) - 1) >> d) > UINT16_MAX)
+		d++;
+
+	uwifi_sketch_init(s);
+	s->shift = d;
+	for (unsigned int i = 0; i < UWIFI_HIST_BUCKETS; i++) {
+		s->buckets[i] = ((uint64_t)h->buckets[i] + (1U << d) - 1) >> d;
+		s->count += s->buckets[i];
+	}
+}
+
+bool uwifi_counters_register(struct uwifi_counters* ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+
+	for (int i = 1; i < UWIFI_COUNTERS_MAX_CTX; i++) {
+		struct uwifi_counters* exp = NULL;
+		if (__atomic_compare_exchange_n(&counters_ctx[i], &exp, ctx, false,
+						__ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+			uwifi_counters_ctx = ctx;
+			return true;
+		}
+	}
+	return false; /* thread will use the default context */
+}
+
+/* copy one context, retrying while the owner is writing */
+static void counters_read(struct uwifi_counters* c, struct uwifi_counters_snapshot* s)
+{
+	uint32_t seq1, seq2;
+
+	do {
+		seq1 = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+		for (int i = 0; i < UWIFI_CNT_MAX; i++)
+			s->cnt[i] = __atomic_load_n(&c->cnt[i], __ATOMIC_RELAXED);
+		for (int i = 0; i < UWIFI_HIST_MAX; i++) {
+			struct uwifi_hist* h = &c->hist[i];
+			s->hist[i].count = __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+			s->hist[i].sum = __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+			for (int j = 0; j < UWIFI_HIST_BUCKETS; j++)
+				s->hist[i].buckets[j] =
+					__atomic_load_n(&h->buckets[j], __ATOMIC_RELAXED);
+		}
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq2 = __atomic_load_n(&c->seq, __ATOMIC_RELAXED);
+	} while ((seq1 & 1) || seq1 != seq2);
+}
+
+static void snapshot_add(struct uwifi_counters_snapshot* s,
+			 const struct uwifi_counters_snapshot* a)
+{
+	for (int i = 0; i < UWIFI_CNT_MAX; i++)
+		s->cnt[i] += a->cnt[i];
+	for (int i = 0; i < UWIFI_HIST_MAX; i++) {
+		s->hist[i].count += a->hist[i].count;
+		s->hist[i].sum += a->hist[i].sum;
+		for (int j = 0; j < UWIFI_HIST_BUCKETS; j++)
+			s->hist[i].buckets[j] += a->hist[i].buckets[j];
+	}
+}
+
+void uwifi_counters_unregister(struct uwifi_counters* ctx)
+{
+	struct uwifi_counters_snapshot tmp;
+
+	counters_lock_take();
+	for (int i = 1; i < UWIFI_COUNTERS_MAX_CTX; i++) {
+		if (counters_ctx[i] != ctx)
+			continue;
+		__atomic_store_n(&counters_ctx[i], NULL, __ATOMIC_RELEASE);
+		counters_read(ctx, &tmp);
+		snapshot_add(&counters_retired, &tmp);
+	}
+	counters_lock_give();
+
+	if (uwifi_counters_ctx == ctx)
+		uwifi_counters_ctx = NULL;
+}
+
+void uwifi_counters_snapshot(struct uwifi_counters_snapshot* s)
+{
+	struct uwifi_counters_snapshot tmp;
+
+	memset(s, 0, sizeof(*s));
+
+	counters_lock_take();
+	for (int n = 0; n < UWIFI_COUNTERS_MAX_CTX; n++) {
+		struct uwifi_counters* c = __atomic_load_n(&counters_ctx[n],
+							   __ATOMIC_ACQUIRE);
+		if (c == NULL)
+			continue;
+
+		counters_read(c, &tmp);
+		snapshot_add(s, &tmp);
+	}
+	snapshot_add(s, &counters_retired);
+	counters_lock_give();
+}
@@ -0,0 +1,171 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lz.h"
+
+/*
+ * LZ4 block format: a sequence is a token byte (high nibble literal length,
+ * low nibble match length - 4, 15 meaning more length bytes follow), the
+ * literals, a 16 bit little endian offset and the extra match length bytes.
+ * The last sequence has only literals. The last 5 bytes are always
+ * literals and the last match has to start 12 bytes before the end.
+ */
+
+#define MIN_MATCH	4
+#define LAST_LITERALS	5
+#define MF_LIMIT	12
+
+static inline uint32_t read32(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline unsigned int lz_hash(uint32_t v)
+{
+	return (v * 2654435761U) >> (32 - UWIFI_LZ_HASH_BITS);
+}
+
+static uint8_t* put_len(uint8_t* op, size_t n)
+{
+	for (; n >= 255; n -= 255)
+		*op++ = 255;
+	*op++ = n;
+	return op;
+}
+
+/* returns NULL if the sequence does not fit */
+static uint8_t* put_seq(uint8_t* op, uint8_t* oend, const uint8_t* lit,
+			size_t lit_len, unsigned int offset, size_t mlen)
+{
+	size_t need = 1 + lit_len + lit_len / 255 + 1 + (mlen ? 2 + mlen / 255 + 1 : 0);
+	if ((size_t)(oend - op) < need)
+		return NULL;
+
+	uint8_t* token = op++;
+	*token = (lit_len >= 15 ? 15 : lit_len) << 4;
+	if (lit_len >= 15)
+		op = put_len(op, lit_len - 15);
+	memcpy(op, lit, lit_len);
+	op += lit_len;
+
+	if (mlen == 0) /* last sequence */
+		return op;
+
+	*op++ = offset & 0xff;
+	*op++ = offset >> 8;
+	mlen -= MIN_MATCH;
+	*token |= mlen >= 15 ? 15 : mlen;
+	if (mlen >= 15)
+		op = put_len(op, mlen - 15);
+	return op;
+}
+
+size_t uwifi_lz_compress(const uint8_t* src, size_t len, uint8_t* dst,
+			 size_t dst_len, uint16_t* table)
+{
+	uint8_t* op = dst;
+	uint8_t* oend = dst + dst_len;
+	size_t i = 0, anchor = 0;
+
+	if (len > UWIFI_LZ_MAX_INPUT)
+		return 0;
+
+	/* table holds position + 1, 0 is empty */
+	memset(table, 0, UWIFI_LZ_HASH_SIZE * sizeof(uint16_t));
+
+	while (len > MF_LIMIT && i < len - MF_LIMIT) {
+		uint32_t v = read32(src + i);
+		unsigned int h = lz_hash(v);
+		size_t ref = table[h];
+		table[h] = i + 1;
+
+		if (ref == 0 || read32(src + ref - 1) != v) {
+			i++;
+			continue;
+		}
+		ref--;
+
+		size_t mlen = MIN_MATCH;
+		while (i + mlen < len - LAST_LITERALS && src[ref + mlen] == src[i + mlen])
+			mlen++;
+
+		op = put_seq(op, oend, src + anchor, i - anchor, i - ref, mlen);
+		if (op == NULL)
+			return 0;
+		i += mlen;
+		anchor = i;
+	}
+
+	op = put_seq(op, oend, src + anchor, len - anchor, 0, 0);
+	if (op == NULL)
+		return 0;
+	return op - dst;
+}
+
+/* read extra length bytes, returns false at end of input */
+static bool get_len(const uint8_t** ip, const uint8_t* iend, size_t* n)
+{
+	uint8_t b;
+	do {
+		if (*ip >= iend)
+			return false;
+		b = *(*ip)++;
+		*n += b;
+	} while (b == 255);
+	return true;
+}
+
+int uwifi_lz_decompress(const uint8_t* src, size_t len, uint8_t* dst,
+			size_t dst_len)
+{
+	const uint8_t* ip = src;
+	const uint8_t* iend = src + len;
+	uint8_t* op = dst;
+	uint8_t* oend = dst + dst_len;
+
+	while (ip < iend) {
+		uint8_t token = *ip++;
+		size_t lit = token >> 4;
+		if (lit == 15 && !get_len(&ip, iend, &lit))
+			return -1;
+		if ((size_t)(iend - ip) < lit || (size_t)(oend - op) < lit)
+			return -1;
+		memcpy(op, ip, lit);
+		ip += lit;
+		op += lit;
+
+		if (ip == iend) /* last sequence */
+			break;
+
+		if (iend - ip < 2)
+			return -1;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - dst))
+			return -1;
+
+		size_t mlen = token & 0xf;
+		if (mlen == 15 && !get_len(&ip, iend, &mlen))
+			return -1;
+		mlen += MIN_MATCH;
+		if ((size_t)(oend - op) < mlen)
+			return -1;
+
+		/* byte by byte, source and destination may overlap */
+		const uint8_t* m = op - offset;
+		while (mlen--)
+			*op++ = *m++;
+	}
+	return op - dst;
+}
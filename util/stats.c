@@ -0,0 +1,338 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <string.h>
+
+#include "stats.h"
+
+/* a * b / c without overflow of the intermediate product, b and c < 2^32 */
+static uint64_t muldiv(uint64_t a, uint64_t b, uint64_t c)
+{
+	return (a / c) * b + (a % c) * b / c;
+}
+
+/* rounded a / b for b > 0, truncating would bias the mean */
+static inline int64_t div_round(int64_t a, int64_t b)
+{
+	return (a + (a >= 0 ? b / 2 : -b / 2)) / b;
+}
+
+static inline uint64_t add_sat(uint64_t a, uint64_t b)
+{
+	return a + b < a ? UINT64_MAX : a + b;
+}
+
+static uint32_t isqrt64(uint64_t v)
+{
+	uint64_t r = 0;
+	uint64_t bit = (uint64_t)1 << 62;
+
+	while (bit > v)
+		bit >>= 2;
+	while (bit) {
+		if (v >= r + bit) {
+			v -= r + bit;
+			r = (r >> 1) + bit;
+		} else {
+			r >>= 1;
+		}
+		bit >>= 2;
+	}
+	return r;
+}
+
+/*** min/max/mean/variance ***/
+
+void uwifi_stat_init(struct uwifi_stat* s)
+{
+	memset(s, 0, sizeof(*s));
+}
+
+void uwifi_stat_add(struct uwifi_stat* s, int32_t v)
+{
+	int64_t x = (int64_t)v * 256;
+
+	if (s->count == 0) {
+		s->count = 1;
+		s->min = s->max = v;
+		s->sum = v;
+		s->mean = x;
+		s->m2 = 0;
+		return;
+	}
+
+	s->count++;
+	if (v < s->min)
+		s->min = v;
+	if (v > s->max)
+		s->max = v;
+
+	int64_t d = x - s->mean;
+	s->sum += v;
+	s->mean = div_round(s->sum * 256, s->count);
+	/* d and (x - new mean) always have the same sign */
+	s->m2 = add_sat(s->m2, (d * (x - s->mean)) >> 8);
+}
+
+void uwifi_stat_merge(struct uwifi_stat* a, const struct uwifi_stat* b)
+{
+	if (b->count == 0)
+		return;
+	if (a->count == 0) {
+		*a = *b;
+		return;
+	}
+
+	uint64_t n = (uint64_t)a->count + b->count;
+	int64_t d = b->mean - a->mean;
+	uint64_t d2 = ((uint64_t)(d < 0 ? -d : d) * (uint64_t)(d < 0 ? -d : d)) >> 8;
+
+	/* parallel variant of Welford (Chan et al.), the correction term is
+	 * at most d2 * n / 4 */
+	uint64_t c = muldiv(d2, a->count, n);
+	c = c > UINT64_MAX / b->count ? UINT64_MAX : c * b->count;
+	a->sum += b->sum;
+	a->mean = div_round(a->sum * 256, n);
+	a->m2 = add_sat(add_sat(a->m2, b->m2), c);
+	a->count = n;
+	if (b->min < a->min)
+		a->min = b->min;
+	if (b->max > a->max)
+		a->max = b->max;
+}
+
+int32_t uwifi_stat_mean(const struct uwifi_stat* s)
+{
+	return (s->mean + (s->mean >= 0 ? 128 : -128)) / 256;
+}
+
+uint64_t uwifi_stat_var_q8(const struct uwifi_stat* s)
+{
+	if (s->count < 2)
+		return 0;
+	return s->m2 / (s->count - 1);
+}
+
+uint32_t uwifi_stat_stddev_q8(const struct uwifi_stat* s)
+{
+	return isqrt64(uwifi_stat_var_q8(s) << 8);
+}
+
+/*** time decayed EWMA ***/
+
+/* exp(-k) for whole time constants, Q16 */
+static const uint32_t decay_int[12] = {
+	65536, 24109, 8869, 3263, 1200, 442, 162, 60, 22, 8, 3, 1
+};
+
+/* exp(-i/32) within one time constant, Q16 */
+static const uint32_t decay_frac[33] = {
+	65536, 63520, 61565, 59671, 57835, 56056, 54331, 52660,
+	51039, 49469, 47947, 46472, 45042, 43656, 42313, 41011,
+	39750, 38527, 37341, 36192, 35079, 34000, 32954, 31940,
+	30957, 30005, 29081, 28187, 27319, 26479, 25664, 24875,
+	24109
+};
+
+/* exp(-dt/tau), the part of the old weight which is kept, Q16 */
+static uint32_t tewma_keep(uint32_t dt, uint32_t tau)
+{
+	if (tau == 0)
+		return 0;
+
+	/* elapsed time in 1/1024 time constants */
+	uint64_t x = ((uint64_t)dt << 10) / tau;
+	unsigned int k = x >> 10;
+	if (k >= 12)
+		return 0;
+
+	/* interpolate between table entries */
+	unsigned int f = (x >> 5) & 31;
+	unsigned int r = x & 31;
+	uint32_t fr = decay_frac[f] - (((decay_frac[f] - decay_frac[f + 1]) * r) >> 5);
+	return ((uint64_t)decay_int[k] * fr) >> 16;
+}
+
+/* a * k >> 16 for Q16 @k without overflow */
+static int64_t mul_q16(int64_t a, uint32_t k)
+{
+	uint64_t u = a < 0 ? -(uint64_t)a : (uint64_t)a;
+	u = (u >> 16) * k + (((u & 0xffff) * k) >> 16);
+	return a < 0 ? -(int64_t)u : (int64_t)u;
+}
+
+void uwifi_tewma_init(struct uwifi_tewma* t, uint32_t tau)
+{
+	t->sum = 0;
+	t->weight = 0;
+	t->last = 0;
+	t->tau = tau;
+}
+
+static void tewma_decay(struct uwifi_tewma* t, uint32_t dt)
+{
+	uint32_t keep = tewma_keep(dt, t->tau);
+	t->sum = mul_q16(t->sum, keep);
+	t->weight = ((uint64_t)t->weight * keep) >> 16;
+}
+
+/* halving keeps the average but limits the influence of old samples */
+static void tewma_limit(struct uwifi_tewma* t)
+{
+	while (t->weight > UWIFI_TEWMA_MAX_WEIGHT << 16) {
+		t->sum /= 2;
+		t->weight /= 2;
+	}
+}
+
+void uwifi_tewma_add(struct uwifi_tewma* t, int32_t v, uint32_t time)
+{
+	/* time may wrap, so compare the difference */
+	int32_t dt = time - t->last;
+
+	if (t->weight == 0) {
+		t->last = time;
+	} else if (dt > 0) {
+		tewma_decay(t, dt);
+		t->last = time;
+	}
+	/* a sample older than the last one is added without decay */
+
+	t->sum += (int64_t)v * 65536;
+	t->weight += 1 << 16;
+	tewma_limit(t);
+}
+
+void uwifi_tewma_merge(struct uwifi_tewma* a, const struct uwifi_tewma* b)
+{
+	struct uwifi_tewma o = *b;
+
+	if (b->weight == 0)
+		return;
+	if (a->weight == 0) {
+		*a = *b;
+		return;
+	}
+
+	/* time may wrap, so compare the difference */
+	if ((int32_t)(o.last - a->last) > 0) {
+		tewma_decay(a, o.last - a->last);
+		a->last = o.last;
+	} else {
+		tewma_decay(&o, a->last - o.last);
+	}
+
+	a->sum += o.sum;
+	a->weight += o.weight;
+	tewma_limit(a);
+}
+
+int32_t uwifi_tewma_read(const struct uwifi_tewma* t)
+{
+	if (t->weight == 0)
+		return 0;
+	int64_t half = t->sum >= 0 ? t->weight / 2 : -(int64_t)(t->weight / 2);
+	return (t->sum + half) / (int64_t)t->weight;
+}
+
+/*** quantile sketch ***/
+
+uint64_t uwifi_sketch_bucket_low(unsigned int i)
+{
+	if (i < UWIFI_SKETCH_SUB)
+		return i;
+	unsigned int msb = i / UWIFI_SKETCH_SUB + UWIFI_SKETCH_SUB_BITS - 1;
+	return ((uint64_t)1 << msb) |
+		((uint64_t)(i % UWIFI_SKETCH_SUB) << (msb - UWIFI_SKETCH_SUB_BITS));
+}
+
+/* halve counts, rounding up so buckets do not become empty */
+static void sketch_halve(struct uwifi_sketch* s)
+{
+	s->count = 0;
+	for (int i = 0; i < UWIFI_SKETCH_BUCKETS; i++) {
+		s->buckets[i] = (s->buckets[i] + 1) >> 1;
+		s->count += s->buckets[i];
+	}
+	s->shift++;
+}
+
+void uwifi_sketch_init(struct uwifi_sketch* s)
+{
+	memset(s, 0, sizeof(*s));
+}
+
+void uwifi_sketch_add(struct uwifi_sketch* s, uint32_t v)
+{
+	unsigned int b = uwifi_sketch_bucket(v);
+
+	if (s->buckets[b] == UINT16_MAX)
+		sketch_halve(s);
+	s->buckets[b]++;
+	s->count++;
+}
+
+/* bucket of @b scaled down by @d halvings */
+static inline uint32_t sketch_scaled(const struct uwifi_sketch* b, int i, unsigned int d)
+{
+	if (d >= 16)
+		return b->buckets[i] ? 1 : 0;
+	return (b->buckets[i] + (1U << d) - 1) >> d;
+}
+
+void uwifi_sketch_merge(struct uwifi_sketch* a, const struct uwifi_sketch* b)
+{
+	bool fits;
+
+	while (a->shift < b->shift)
+		sketch_halve(a);
+
+	do {
+		unsigned int d = a->shift - b->shift;
+		fits = true;
+		for (int i = 0; i < UWIFI_SKETCH_BUCKETS; i++) {
+			if (a->buckets[i] + sketch_scaled(b, i, d) > UINT16_MAX) {
+				fits = false;
+				sketch_halve(a);
+				break;
+			}
+		}
+	} while (!fits);
+
+	unsigned int d = a->shift - b->shift;
+	for (int i = 0; i < UWIFI_SKETCH_BUCKETS; i++) {
+		uint32_t v = sketch_scaled(b, i, d);
+		a->buckets[i] += v;
+		a->count += v;
+	}
+}
+
+uint32_t uwifi_sketch_quantile(const struct uwifi_sketch* s, unsigned int permille)
+{
+	uint64_t sum = 0;
+
+	if (s->count == 0)
+		return 0;
+
+	uint64_t rank = ((uint64_t)s->count * permille + 999) / 1000;
+	if (rank == 0)
+		rank = 1;
+
+	for (unsigned int i = 0; i < UWIFI_SKETCH_BUCKETS; i++) {
+		sum += s->buckets[i];
+		if (sum >= rank) {
+			/* middle of the bucket */
+			uint64_t lo = uwifi_sketch_bucket_low(i);
+			uint64_t hi = i + 1 < UWIFI_SKETCH_BUCKETS ?
+				uwifi_sketch_bucket_low(i + 1) : (uint64_t)1 << 32;
+			return lo + (hi - lo - 1) / 2;
+		}
+	}
+	return UINT32_MAX;
+}
@@ -0,0 +1,124 @@
+/*
+ * libuwifi - Userspace Wifi Library
+ *
+ * Copyright (C) 2005-2016 Bruno Randolf (br1@einfach.org)
+ *
+ * This source code is licensed under the GNU Lesser General Public License,
+ * Version 3. See the file COPYING for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+#include "ring.h"
+#include "platform.h"
+
+struct trace_record {
+	uint32_t	time;		/* plat_time_usec() */
+	uint8_t		ss;
+	uint8_t		ll;
+	uint8_t		nargs;
+	const char*	fmt;
+	int		args[UWIFI_TRACE_MAX_ARGS];
+};
+
+static const char* trace_ss_names[UWIFI_TR_MAX] = {
+	[UWIFI_TR_WLAN]		= "wlan",
+	[UWIFI_TR_RADIOTAP]	= "rtap",
+	[UWIFI_TR_NODE]		= "node",
+	[UWIFI_TR_ESSID]	= "essid",
+	[UWIFI_TR_CHANNEL]	= "chan",
+};
+
+uint8_t uwifi_trace_level[UWIFI_TR_MAX] = {
+	[0 ... UWIFI_TR_MAX - 1] = LL_INFO
+};
+
+static struct uwifi_ring trace_ring;
+static struct trace_record* trace_buf;
+
+bool uwifi_trace_init(unsigned int num_records)
+{
+	trace_buf = malloc(num_records * sizeof(struct trace_record));
+	if (trace_buf == NULL)
+		return false;
+
+	if (!uwifi_ring_init(&trace_ring, trace_buf, sizeof(struct trace_record),
+			     num_records)) {
+		LOG_ERR("trace: number of records has to be a power of two");
+		uwifi_trace_free();
+		return false;
+	}
+	return true;
+}
+
+void uwifi_trace_free(void)
+{
+	/* stop recording before freeing the buffer */
+	for (int i = 0; i < UWIFI_TR_MAX; i++)
+		uwifi_trace_level[i] = 0;
+	free(trace_buf);
+	trace_buf = NULL;
+}
+
+void uwifi_trace_set_level(enum uwifi_trace_subsys ss, enum loglevel ll)
+{
+	if (ss < UWIFI_TR_MAX)
+		uwifi_trace_level[ss] = ll;
+}
+
+void uwifi_trace_rec(enum uwifi_trace_subsys ss, enum loglevel ll,
+		     const char* fmt, const int* args, unsigned int nargs)
+{
+	if (trace_buf == NULL)
+		return;
+
+	struct trace_record* r = uwifi_ring_produce_begin(&trace_ring);
+	if (r == NULL)
+		return; /* full, counted as drop */
+
+	if (nargs > UWIFI_TRACE_MAX_ARGS)
+		nargs = UWIFI_TRACE_MAX_ARGS;
+
+	r->time = plat_time_usec();
+	r->ss = ss;
+	r->ll = ll;
+	r->nargs = nargs;
+	r->fmt = fmt;
+	for (unsigned int i = 0; i < nargs; i++)
+		r->args[i] = args[i];
+	uwifi_ring_produce_commit(&trace_ring);
+}
+
+unsigned int uwifi_trace_drain(unsigned int max)
+{
+	struct trace_record* r;
+	unsigned int count = 0;
+	char msg[256];
+	int a[UWIFI_TRACE_MAX_ARGS];
+
+	if (trace_buf == NULL)
+		return 0;
+
+	while (count < max && (r = uwifi_ring_consume_begin(&trace_ring)) != NULL) {
+		for (int i = 0; i < UWIFI_TRACE_MAX_ARGS; i++)
+			a[i] = i < r->nargs ? r->args[i] : 0;
+
+		/* unused arguments are ignored by printf */
+		snprintf(msg, sizeof(msg), r->fmt,
+			 a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+
+		log_out(r->ll, "[%u.%06u %s] %s", r->time / 1000000,
+			r->time % 1000000, trace_ss_names[r->ss], msg);
+
+		uwifi_ring_consume_commit(&trace_ring);
+		count++;
+	}
+	return count;
+}
+
+uint32_t uwifi_trace_drops(void)
+{
+	return uwifi_ring_drops(&trace_ring);
+}
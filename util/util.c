@@ -54,6 +54,44 @@ int ilog2(int x)
 	return n;
 }
 
+/* length of the valid UTF-8 sequence at @s, 0 if invalid */
+int utf8_valid_len(const unsigned char* s, size_t len)
+{
+	unsigned int n;
+	uint32_t c;
+
+	if (len == 0)
+		return 0;
+	if (s[0] < 0x80)
+		return 1;
+	else if ((s[0] & 0xe0) == 0xc0) {
+		n = 2;
+		c = s[0] & 0x1f;
+	} else if ((s[0] & 0xf0) == 0xe0) {
+		n = 3;
+		c = s[0] & 0x0f;
+	} else if ((s[0] & 0xf8) == 0xf0) {
+		n = 4;
+		c = s[0] & 0x07;
+	} else
+		return 0;
+
+	if (len < n)
+		return 0;
+	for (unsigned int i = 1; i < n; i++) {
+		if ((s[i] & 0xc0) != 0x80)
+			return 0;
+		c = (c << 6) | (s[i] & 0x3f);
+	}
+
+	/* overlong, surrogates and beyond Unicode */
+	if ((n == 2 && c < 0x80) || (n == 3 && c < 0x800) ||
+	    (n == 4 && c < 0x10000) || (c >= 0xd800 && c <= 0xdfff) ||
+	    c > 0x10ffff)
+		return 0;
+	return n;
+}
+
 /* VERSION is defined by Makefile from git describe */
 #ifndef VERSION
 #define VERSION "unknown"